@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "aggregateproof.h"
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string.h>
+
+namespace {
+
+void putU32(std::vector<unsigned char>& out, uint32_t v)
+{
+    out.push_back((v >> 24) & 0xFF);
+    out.push_back((v >> 16) & 0xFF);
+    out.push_back((v >> 8) & 0xFF);
+    out.push_back(v & 0xFF);
+}
+
+class Reader
+{
+public:
+    Reader(const unsigned char* in, size_t len) : in(in), left(len) { }
+
+    const unsigned char* take(size_t n)
+    {
+        if (n > left) {
+            throw std::invalid_argument("truncated aggregate proof");
+        }
+        const unsigned char* res = in;
+        in += n;
+        left -= n;
+        return res;
+    }
+
+    uint32_t getU32()
+    {
+        const unsigned char* p = take(4);
+        return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+    }
+
+    template <size_t N>
+    void get(std::array<unsigned char, N>& a)
+    {
+        memcpy(a.data(), take(N), N);
+    }
+
+    bool atEnd() const
+    {
+        return left == 0;
+    }
+
+private:
+    const unsigned char* in;
+    size_t left;
+};
+
+}
+
+const unsigned char AggregateProof::VERSION;
+
+AggregateProof::ref_t AggregateProof::addPk(const ChameleonHash::pk_t& pk)
+{
+    pks.push_back(pk);
+    return pks.size() - 1;
+}
+
+void AggregateProof::addItem(const ChameleonHash::digest_t& digest, const ChameleonHash::rand_t& r, ref_t pkRef)
+{
+    if (pkRef >= pks.size()) {
+        throw std::invalid_argument("unknown public key reference");
+    }
+    digests.push_back(digest);
+    rs.push_back(r);
+    pkRefs.push_back(pkRef);
+}
+
+size_t AggregateProof::size() const
+{
+    return digests.size();
+}
+
+void AggregateProof::serialize(std::vector<unsigned char>& out) const
+{
+    if (rs.size() != digests.size() || pkRefs.size() != digests.size()) {
+        throw std::logic_error("inconsistent aggregate proof");
+    }
+
+    out.clear();
+    out.reserve(1 + 4 + pks.size() * 66 + 4 + size() * (ChameleonHash::MESG_LEN + ChameleonHash::RAND_LEN + 4) + ChameleonHash::HASH_LEN);
+
+    out.push_back(VERSION);
+    putU32(out, pks.size());
+    for (auto& pk : pks) {
+        if (pk.size() > 0xFF) {
+            throw std::invalid_argument("not a valid public key");
+        }
+        out.push_back(pk.size());
+        out.insert(out.end(), pk.begin(), pk.end());
+    }
+    putU32(out, size());
+    for (size_t i = 0; i < size(); i++) {
+        out.insert(out.end(), digests[i].begin(), digests[i].end());
+        out.insert(out.end(), rs[i].begin(), rs[i].end());
+        putU32(out, pkRefs[i]);
+    }
+    out.insert(out.end(), hash.begin(), hash.end());
+}
+
+AggregateProof AggregateProof::parse(const unsigned char* in, size_t len)
+{
+    AggregateProof proof;
+    Reader reader(in, len);
+
+    if (*reader.take(1) != VERSION) {
+        throw std::invalid_argument("unsupported aggregate proof version");
+    }
+
+    uint32_t pkCnt = reader.getU32();
+    for (uint32_t i = 0; i < pkCnt; i++) {
+        size_t pkLen = *reader.take(1);
+        const unsigned char* pk = reader.take(pkLen);
+        proof.pks.push_back(ChameleonHash::pk_t(pk, pk + pkLen));
+    }
+
+    uint32_t cnt = reader.getU32();
+    // every item takes 68 bytes, so reject counts that cannot possibly fit before allocating
+    if (cnt > len / (ChameleonHash::MESG_LEN + ChameleonHash::RAND_LEN + 4)) {
+        throw std::invalid_argument("truncated aggregate proof");
+    }
+    proof.digests.resize(cnt);
+    proof.rs.resize(cnt);
+    proof.pkRefs.resize(cnt);
+    for (uint32_t i = 0; i < cnt; i++) {
+        reader.get(proof.digests[i]);
+        reader.get(proof.rs[i]);
+        proof.pkRefs[i] = reader.getU32();
+        if (proof.pkRefs[i] >= pkCnt) {
+            throw std::invalid_argument("unknown public key reference");
+        }
+    }
+    reader.get(proof.hash);
+
+    if (!reader.atEnd()) {
+        throw std::invalid_argument("trailing bytes after aggregate proof");
+    }
+    return proof;
+}
+
+AggregateProof AggregateProof::parse(const std::vector<unsigned char>& in)
+{
+    return parse(in.data(), in.size());
+}
+
+namespace {
+
+// The terms of one or more proofs, weighted and collected per point.
+class Combination
+{
+public:
+    Combination() {
+        secp256k1_scalar_clear(&g);
+    }
+
+    // Adds z times the items of proof minus z times its hash. Returns false, and adds nothing,
+    // if the proof is malformed.
+    bool add(const AggregateProof& proof, const secp256k1_scalar_t& z) {
+        if (proof.rs.size() != proof.digests.size() || proof.pkRefs.size() != proof.digests.size()) {
+            return false;
+        }
+        secp256k1_ge_t hashge;
+        if (!secp256k1_eckey_pubkey_parse(&hashge, proof.hash.data(), proof.hash.size())) {
+            return false;
+        }
+        std::vector<size_t> refs(proof.pks.size());
+        for (size_t i = 0; i < proof.pks.size(); i++) {
+            auto it = pkIndex.find(proof.pks[i]);
+            if (it == pkIndex.end()) {
+                secp256k1_ge_t pkge;
+                if (!secp256k1_eckey_pubkey_parse(&pkge, proof.pks[i].data(), proof.pks[i].size())) {
+                    return false;
+                }
+                it = pkIndex.insert(std::make_pair(proof.pks[i], points.size())).first;
+                points.push_back(pkge);
+                secp256k1_scalar_t zero;
+                secp256k1_scalar_clear(&zero);
+                coefs.push_back(zero);
+            }
+            refs[i] = it->second;
+        }
+        secp256k1_scalar_t gAdd, zr;
+        secp256k1_scalar_clear(&gAdd);
+        std::vector<std::pair<size_t, secp256k1_scalar_t>> pkAdd;
+        for (size_t i = 0; i < proof.digests.size(); i++) {
+            secp256k1_scalar_t ms, rs;
+            int overflow;
+            secp256k1_scalar_set_b32(&ms, proof.digests[i].data(), nullptr);
+            secp256k1_scalar_set_b32(&rs, proof.rs[i].data(), &overflow);
+            if (overflow || proof.pkRefs[i] >= refs.size()) {
+                return false;
+            }
+            secp256k1_scalar_add(&gAdd, &gAdd, &ms);
+            secp256k1_scalar_mul(&zr, &rs, &z);
+            pkAdd.push_back(std::make_pair(refs[proof.pkRefs[i]], zr));
+        }
+
+        secp256k1_scalar_mul(&gAdd, &gAdd, &z);
+        secp256k1_scalar_add(&g, &g, &gAdd);
+        for (const auto& a : pkAdd) {
+            secp256k1_scalar_add(&coefs[a.first], &coefs[a.first], &a.second);
+        }
+        secp256k1_scalar_t negz;
+        secp256k1_scalar_negate(&negz, &z);
+        points.push_back(hashge);
+        coefs.push_back(negz);
+        return true;
+    }
+
+    // sum of all terms
+    void sum(secp256k1_gej_t& res) {
+        ChameleonHash::multiExp(res, g, points.data(), coefs.data(), points.size());
+    }
+
+private:
+    secp256k1_scalar_t g;
+    std::map<ChameleonHash::pk_t, size_t> pkIndex;
+    std::vector<secp256k1_ge_t> points;
+    std::vector<secp256k1_scalar_t> coefs;
+};
+
+void randomWeight(secp256k1_scalar_t& z, std::random_device& rd)
+{
+    unsigned char b[32] = { 0 };
+    for (size_t i = 16; i < 32; i += 4) {
+        uint32_t v = rd();
+        memcpy(&b[i], &v, 4);
+    }
+    secp256k1_scalar_set_b32(&z, b, nullptr);
+}
+
+}
+
+void AggregateProof::verify(const AggregateProof* const* proofs, size_t cnt, bool* results)
+{
+    secp256k1_scalar_t one;
+    secp256k1_scalar_set_int(&one, 1);
+    Combination all;
+    std::random_device rd;
+    bool any = false;
+    for (size_t k = 0; k < cnt; k++) {
+        secp256k1_scalar_t z = one;
+        if (cnt > 1) {
+            randomWeight(z, rd);
+        }
+        results[k] = all.add(*proofs[k], z);
+        any |= results[k];
+    }
+    if (!any) {
+        return;
+    }
+
+    secp256k1_gej_t sum;
+    all.sum(sum);
+    if (secp256k1_gej_is_infinity(&sum)) {
+        return;
+    }
+    if (cnt == 1) {
+        results[0] = false;
+        return;
+    }
+    for (size_t k = 0; k < cnt; k++) {
+        if (results[k]) {
+            verify(&proofs[k], 1, &results[k]);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef AGGREGATEPROOF_H
+#define AGGREGATEPROOF_H
+
+#include "chameleonhash.h"
+
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+// An aggregate proof carries exactly what ChameleonHash::mergeV consumes: per item the
+// statement digest, the first-level randomness and a reference into a table of distinct
+// public keys, plus the aggregate hash. Items are about 68 bytes instead of a full
+// 4160-byte token and the statement.
+class AggregateProof
+{
+public:
+    static const unsigned char VERSION = 1;
+
+    typedef uint32_t ref_t;
+
+    std::vector<ChameleonHash::pk_t> pks;
+    std::vector<ChameleonHash::digest_t> digests;
+    std::vector<ChameleonHash::rand_t> rs;
+    std::vector<ref_t> pkRefs;
+    ChameleonHash::hash_t hash;
+
+    // Appends pk to the key table and returns its reference.
+    ref_t addPk(const ChameleonHash::pk_t& pk);
+    void addItem(const ChameleonHash::digest_t& digest, const ChameleonHash::rand_t& r, ref_t pkRef);
+    size_t size() const;
+
+    // Binary encoding:
+    //   version (1) || #pks (4) || { len (1) || pk }* || #items (4) || { digest (32) || r (32) || pkRef (4) }* || hash (33)
+    // All integers are big endian.
+    void serialize(std::vector<unsigned char>& out) const;
+    static AggregateProof parse(const unsigned char* in, size_t len);
+    static AggregateProof parse(const std::vector<unsigned char>& in);
+
+    // Checks that mergeV over the items of proofs[k] gives its hash, and stores the outcome in
+    // results[k]. As mergeV is linear, all proofs are checked with a single sum: the items of
+    // every proof are weighted with a random 128-bit factor, the scalars of each distinct public
+    // key and of G are added up before multiplying, and the weighted hashes are subtracted.
+    // Only if that sum is not zero are the proofs checked one by one.
+    static void verify(const AggregateProof* const* proofs, size_t cnt, bool* results);
+};
+
+#endif // AGGREGATEPROOF_H
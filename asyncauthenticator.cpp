@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "asyncauthenticator.h"
+
+#include <algorithm>
+#include <chrono>
+
+AsyncAuthenticator::AsyncAuthenticator(Authenticator& acca) : acca(acca), stopping(false), resultsLen(0)
+{
+    executor = std::thread(&AsyncAuthenticator::run, this);
+}
+
+AsyncAuthenticator::~AsyncAuthenticator()
+{
+    {
+        std::lock_guard<std::mutex> l(lock);
+        stopping = true;
+        ready.notify_one();
+    }
+    executor.join();
+}
+
+AsyncAuthenticator::op_t AsyncAuthenticator::makeOp(Type type, Authenticator::token_t* out, const Authenticator::token_t* t,
+                                                    const Authenticator::ct_t* ct, const Authenticator::st_t* st, int n,
+                                                    const AggregateProof* proof)
+{
+    op_t op;
+    op.type = type;
+    op.out = out;
+    op.t = t;
+    op.ct = ct;
+    op.st = st;
+    op.n = n;
+    op.proof = proof;
+    op.result = false;
+    return op;
+}
+
+void AsyncAuthenticator::authenticate(Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, int n, callback_t done)
+{
+    op_t op = makeOp(AUTHENTICATE, &t, nullptr, &ct, &st, n, nullptr);
+    op.done = std::move(done);
+    submit(std::move(op));
+}
+
+void AsyncAuthenticator::verify(const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, int n, callback_t done)
+{
+    op_t op = makeOp(VERIFY, nullptr, &t, &ct, &st, n, nullptr);
+    op.done = std::move(done);
+    submit(std::move(op));
+}
+
+void AsyncAuthenticator::verifys(const AggregateProof& proof, callback_t done)
+{
+    op_t op = makeOp(VERIFYS, nullptr, nullptr, nullptr, nullptr, 0, &proof);
+    op.done = std::move(done);
+    submit(std::move(op));
+}
+
+void AsyncAuthenticator::submit(op_t op)
+{
+    std::lock_guard<std::mutex> l(lock);
+    pending.push_back(std::move(op));
+    ready.notify_one();
+}
+
+void AsyncAuthenticator::run()
+{
+    std::vector<op_t> ops;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> l(lock);
+            // wait_for is inline, while wait is a symbol that libstdc++ 12 versioned anew, which
+            // would keep binaries from running against an older libstdc++. The timeout is only
+            // there for that and practically never expires.
+            while (!stopping && pending.empty()) {
+                ready.wait_for(l, std::chrono::hours(1));
+            }
+            if (pending.empty()) {
+                return;
+            }
+            ops.swap(pending);
+        }
+        process(ops);
+        ops.clear();
+    }
+}
+
+void AsyncAuthenticator::process(std::vector<op_t>& ops)
+{
+    // Operations run in submission order, e.g., a verify sees a preceding authenticate of the
+    // same token, so only runs of consecutive verifications are batched.
+    op_t* first = ops.data();
+    op_t* end = first + ops.size();
+    while (first != end) {
+        op_t* last = first + 1;
+        while (last != end && last->type == first->type) {
+            last++;
+        }
+        if (first->type == VERIFY) {
+            verifyAll(first, last);
+        } else if (first->type == VERIFYS) {
+            verifysAll(first, last);
+        } else {
+            for (op_t* op = first; op != last; op++) {
+                try {
+                    acca.authenticate(*op->out, *op->ct, *op->st, op->n);
+                    op->result = true;
+                } catch (...) {
+                    op->error = std::current_exception();
+                }
+            }
+        }
+        first = last;
+    }
+    // Callbacks may resume coroutines that destroy the arguments, so they run last.
+    for (auto& op : ops) {
+        op.done(op.result, op.error);
+    }
+}
+
+void AsyncAuthenticator::verifyAll(op_t* first, op_t* last)
+{
+    batch.reset();
+    cts.clear();
+    batched.clear();
+    for (op_t* op = first; op != last; op++) {
+        batch.add(*op->st, op->n);
+        cts.push_back(*op->ct);
+        batched.push_back(op);
+    }
+    // The tokens are copied after all items are added, as adding may change the stride.
+    for (size_t i = 0; i < batched.size(); i++) {
+        const Authenticator::token_t& t = *batched[i]->t;
+        for (size_t l = 0; l < Authenticator::DEPTH; l++) {
+            batch.chs(i)[l * batch.stride()] = t.chs[l];
+            batch.rs(i)[l * batch.stride()] = t.rs[l];
+        }
+    }
+    bool* res = resultsFor(batched.size());
+    try {
+        acca.verifyBatch(batch, cts.data(), res);
+        for (size_t i = 0; i < batched.size(); i++) {
+            batched[i]->result = res[i];
+        }
+    } catch (...) {
+        // One malformed token, e.g., with randomness out of range, must not fail the others.
+        for (op_t* op : batched) {
+            try {
+                op->result = acca.verify(*op->t, *op->ct, *op->st, op->n);
+            } catch (...) {
+                op->error = std::current_exception();
+            }
+        }
+    }
+}
+
+void AsyncAuthenticator::verifysAll(op_t* first, op_t* last)
+{
+    proofs.clear();
+    batched.clear();
+    for (op_t* op = first; op != last; op++) {
+        proofs.push_back(op->proof);
+        batched.push_back(op);
+    }
+    bool* res = resultsFor(batched.size());
+    try {
+        AggregateProof::verify(proofs.data(), proofs.size(), res);
+        for (size_t i = 0; i < batched.size(); i++) {
+            batched[i]->result = res[i];
+        }
+    } catch (...) {
+        for (op_t* op : batched) {
+            try {
+                op->result = acca.verifys(*op->proof);
+            } catch (...) {
+                op->error = std::current_exception();
+            }
+        }
+    }
+}
+
+bool* AsyncAuthenticator::resultsFor(size_t cnt)
+{
+    if (cnt > resultsLen) {
+        resultsLen = std::max(cnt, 2 * resultsLen);
+        results.reset(new bool[resultsLen]);
+    }
+    return results.get();
+}
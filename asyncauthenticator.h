@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef ASYNCAUTHENTICATOR_H
+#define ASYNCAUTHENTICATOR_H
+
+#include "authenticator.h"
+#include "aggregateproof.h"
+#include "tokenbatch.h"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define ACCA_HAVE_COROUTINES 1
+#endif
+#endif
+
+// Runs the operations of an Authenticator on an executor thread, so that callers such as
+// I/O threads do not block for the whole computation. Operations submitted while the
+// executor is busy are processed together, in submission order: each run of consecutive
+// verifications goes through a single verifyBatch, and each run of consecutive aggregate
+// proofs through a single AggregateProof::verify. If a batch throws, e.g., for a malformed token, each operation is redone on its own, so only
+// the malformed ones fail.
+//
+// Completion is signaled by a callback on the executor thread. If compiled as C++20, the
+// asyncAuthenticate, asyncVerify and asyncVerifys awaitables suspend the calling coroutine
+// instead and resume it on the executor thread; a coroutine with more to do than a few
+// instructions should move on to its own executor from there.
+class AsyncAuthenticator
+{
+public:
+    // The result of a verification, or true for an authentication, and the exception the
+    // operation threw, if any. Callbacks must not throw.
+    typedef std::function<void(bool result, std::exception_ptr error)> callback_t;
+
+    // acca is used by the executor thread only, until this is destroyed.
+    explicit AsyncAuthenticator(Authenticator& acca);
+    // Completes all submitted operations.
+    ~AsyncAuthenticator();
+
+    // The arguments must remain valid until done is called.
+    void authenticate(Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, int n, callback_t done);
+    void verify(const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, int n, callback_t done);
+    void verifys(const AggregateProof& proof, callback_t done);
+
+private:
+    enum Type { AUTHENTICATE, VERIFY, VERIFYS };
+
+    struct op_t {
+        Type type;
+        Authenticator::token_t* out;
+        const Authenticator::token_t* t;
+        const Authenticator::ct_t* ct;
+        const Authenticator::st_t* st;
+        int n;
+        const AggregateProof* proof;
+        callback_t done;
+        bool result;
+        std::exception_ptr error;
+    };
+
+    Authenticator& acca;
+    std::mutex lock;
+    std::condition_variable ready;
+    std::vector<op_t> pending;
+    bool stopping;
+
+    // owned by the executor thread
+    TokenBatch batch;
+    std::vector<Authenticator::ct_t> cts;
+    std::vector<const AggregateProof*> proofs;
+    std::vector<op_t*> batched;
+    std::unique_ptr<bool[]> results;
+    size_t resultsLen;
+
+    std::thread executor;
+
+    static op_t makeOp(Type type, Authenticator::token_t* out, const Authenticator::token_t* t, const Authenticator::ct_t* ct,
+                       const Authenticator::st_t* st, int n, const AggregateProof* proof);
+    void submit(op_t op);
+    void run();
+    void process(std::vector<op_t>& ops);
+    // Batch a run of consecutive operations of type VERIFY or VERIFYS, respectively.
+    void verifyAll(op_t* first, op_t* last);
+    void verifysAll(op_t* first, op_t* last);
+    bool* resultsFor(size_t cnt);
+
+    AsyncAuthenticator(const AsyncAuthenticator&);
+    AsyncAuthenticator& operator=(const AsyncAuthenticator&);
+
+#ifdef ACCA_HAVE_COROUTINES
+public:
+    // co_await gives the result of the operation or rethrows its exception.
+    class Awaiter
+    {
+    public:
+        bool await_ready() const noexcept {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> h) {
+            op.done = [this, h](bool result, std::exception_ptr error) {
+                this->result = result;
+                this->error = error;
+                h.resume();
+            };
+            // h may be resumed and this destroyed before submit returns.
+            AsyncAuthenticator* o = owner;
+            o->submit(std::move(op));
+        }
+        bool await_resume() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return result;
+        }
+
+    private:
+        friend class AsyncAuthenticator;
+        AsyncAuthenticator* owner;
+        op_t op;
+        bool result;
+        std::exception_ptr error;
+
+        Awaiter(AsyncAuthenticator* owner, const op_t& op) : owner(owner), op(op), result(false) {
+        }
+    };
+
+    Awaiter asyncAuthenticate(Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, int n) {
+        return Awaiter(this, makeOp(AUTHENTICATE, &t, nullptr, &ct, &st, n, nullptr));
+    }
+    Awaiter asyncVerify(const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, int n) {
+        return Awaiter(this, makeOp(VERIFY, nullptr, &t, &ct, &st, n, nullptr));
+    }
+    Awaiter asyncVerifys(const AggregateProof& proof) {
+        return Awaiter(this, makeOp(VERIFYS, nullptr, nullptr, nullptr, nullptr, 0, &proof));
+    }
+#endif
+};
+
+#endif // ASYNCAUTHENTICATOR_H
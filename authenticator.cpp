@@ -25,175 +25,401 @@
  */
 
 #include "authenticator.h"
+#include "aggregateproof.h"
 #include "chameleonhash.h"
+#include "instrument.h"
 #include "node.h"
 #include "prf.h"
+#include "probes.h"
+#include "tokenbatch.h"
 
+#include <algorithm>
+#include <bitset>
 #include <exception>
+#include <stdexcept>
+#include <map>
 #include <assert.h>
 
-Authenticator::Authenticator(const Authenticator::dsk_t& dsk, const Authenticator::dw_t& dw, int n) : dsk(dsk), ch(dsk, dw, n), _n(n), hasSecretKey_(true) {
-    Prf prf(dsk, true);
+template <size_t CT_LEN_>
+BasicAuthenticator<CT_LEN_>::BasicAuthenticator(const dsk_t& dsk, const dw_t& dw, int n, Suite suite, Derivation derivation)
+    : dsk(dsk), suite(suite), derivation(derivation), ch(dsk, dw, n), _n(n), hasSecretKey_(true) {
+    Prf prf(dsk, true, suite, derivation);
     ChameleonHash::digest_t x;
     ChameleonHash::rand_t r;
 
     ChameleonHash::hash_t left, right;
-    Node node = Node::leftChildOfRoot();
+    Node<CT_LEN> node = Node<CT_LEN>::leftChildOfRoot();
 
-    prf.getX(x, node);
-    prf.getR(r, node);
+    prf.getXR(x, r, node);
     ch.ch(left, x, r, n);
 
     node.moveToSibling();
 
-    prf.getX(x, node);
-    prf.getR(r, node);
+    prf.getXR(x, r, node);
     ch.ch(right, x, r, n);
 
-    ChameleonHash::digest(rootDigest, left, right);
+    ChameleonHash::digest(rootDigest, left, right, suite);
 }
 
-Authenticator::Authenticator(const Authenticator::dpk_t& dpk, const Authenticator::dw_t& dw) : rootDigest(dpk.rootDigest), ch(dpk.chpk, dw), hasSecretKey_(false) { }
+template <size_t CT_LEN_>
+BasicAuthenticator<CT_LEN_>::BasicAuthenticator(const dpk_t& dpk, const dw_t& dw)
+    : rootDigest(dpk.rootDigest), suite(dpk.suite), derivation(dpk.derivation), ch(dpk.chpk, dw), hasSecretKey_(false) {
+    if (!isValidSuite(suite)) {
+        throw std::invalid_argument("unknown suite");
+    }
+    if (!isValidDerivation(derivation)) {
+        throw std::invalid_argument("unknown derivation mode");
+    }
+}
 
 
-void Authenticator::authenticate(token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, int n)
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::authenticate(token_t& t, const ct_t& ct, const st_t& st, int n)
 {
+    ACCA_PROBE2(authenticate_entry, CT_LEN, n);
+    ChameleonHash::digest_t stX;
+    ChameleonHash::digest(stX, st);
+    authenticateDigest(t.rs.data(), t.chs.data(), 1, ct, stX, n);
+    ACCA_PROBE2(authenticate_return, CT_LEN, n);
+}
+
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::authenticateDigest(ChameleonHash::rand_t* rs, ChameleonHash::hash_t* chs, size_t stride, const ct_t& ct, const ChameleonHash::digest_t& stX, int n)
+{
+    ACCA_PHASE(PHASE_AUTHENTICATE);
     if (!hasSecretKey_) {
         throw std::logic_error("cannot authenticate without secret key");
     }
-    Prf prf(dsk, true);
-    ChameleonHash::digest_t prfX, subTreeX, sibX;
-    ChameleonHash::rand_t prfR, subTreeR, sibR;
+    Prf prf(dsk, true, suite, derivation);
+    ChameleonHash::digest_t subTreeX = stX;
+    ChameleonHash::rand_t subTreeR;
     ChameleonHash::hash_t chash, sibchash;
 
-    Node node(ct);
-    ChameleonHash::digest(subTreeX, st);
-    auto rOut = t.rs.begin();
-    auto chOut = t.chs.begin();
+    // The nodes on the path and their siblings do not depend on the statement, so all 2 * DEPTH
+    // PRF evaluations are done upfront in one batch. Entry 2i is the node on level i of the path
+    // (counted from the leaf), entry 2i + 1 is its sibling.
+    // All encodings have the same length, which depends on the derivation mode.
+    unsigned char encs[2 * DEPTH * Node<CT_LEN>::BYTES_LEN];
+    bool siblingIsLeft[DEPTH];
+    size_t len = 0;
+
+    Node<CT_LEN> node(ct);
+    for (size_t i = 0; i < DEPTH; i++) {
+        len = prf.encode(encs + 2 * i * len, node);
+        node.moveToSibling();
+        prf.encode(encs + (2 * i + 1) * len, node);
+        siblingIsLeft[i] = node.isLeftChild();
+        node.moveToParent();
+    }
+    assert(node.isRoot());
+
+    Prf::out_t prfX[2 * DEPTH], prfR[2 * DEPTH];
+    prf.getXR(prfX, prfR, encs, len, 2 * DEPTH);
 
-    bool first = true;
-    while (!node.isRoot()) {
-        prf.getX(prfX, node);
-        prf.getR(prfR, node);
-        ch.ch(chash, prfX, prfR, this->_n);
-        ch.collision(prfX, prfR, this->_n, subTreeX, subTreeR, n);
+    // The number of levels is a compile-time constant, so the compiler is free to unroll.
+    for (size_t i = 0; i < DEPTH; i++) {
+        ch.ch(chash, prfX[2 * i], prfR[2 * i], this->_n);
+        ch.collision(prfX[2 * i], prfR[2 * i], this->_n, subTreeX, subTreeR, n);
 
-        if (first) {
-            ChameleonHash::randomOracle(chash, chash, subTreeR);
-            first = false;
+        if (i == 0) {
+            ChameleonHash::randomOracle(chash, chash, subTreeR, suite);
         }
 
-        node.moveToSibling();
+        ch.ch(sibchash, prfX[2 * i + 1], prfR[2 * i + 1], this->_n);
+
+        rs[i * stride] = subTreeR;
+        chs[i * stride] = sibchash;
+
+        if (siblingIsLeft[i]) {
+            ChameleonHash::digest(subTreeX, sibchash, chash, suite);
+        }
+        else {
+            ChameleonHash::digest(subTreeX, chash, sibchash, suite);
+        }
+    }
+    assert(subTreeX == rootDigest);
+}
 
-        prf.getX(sibX, node);
-        prf.getR(sibR, node);
-        ch.ch(sibchash, sibX, sibR, this->_n);
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::authenticates(altMessage& t, int cnt, const ct_t& ct, int n[], ChameleonHash::hash_t& res)
+{
+	authenticates(t.token.data(), t.ms.data(), n, cnt, ct, res);
+}
 
-        *(rOut++) = subTreeR;
-        *(chOut++) = sibchash;
+template <size_t CT_LEN_>
+bool BasicAuthenticator<CT_LEN_>::verifys(const altMessage& t, int cnt, const ct_t& ct, int n[], const std::vector<ChameleonHash::pk_t>& pk, dw_t w, ChameleonHash::hash_t& res)
+{
+	return verifys(t.token.data(), t.ms.data(), pk.data(), cnt, res);
+}
 
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::authenticates(token_t* t, const st_t* ms, const int* n, size_t cnt, const ct_t& ct, ChameleonHash::hash_t& res)
+{
+    ACCA_PROBE2(authenticates_entry, CT_LEN, cnt);
+    ChameleonHash::mergeA_t acc;
+    ChameleonHash::mergeAInitialize(acc);
+    for (size_t i = 0; i < cnt; i++) {
+        authenticate(t[i], ct, ms[i], n[i]);
+        ChameleonHash::digest_t X;
+        ChameleonHash::digest(X, ms[i]);
+        ch.mergeAAdd(acc, X, t[i].rs[0], n[i]);
+    }
+    ChameleonHash::mergeAFinalize(res, acc);
+    ACCA_PROBE2(authenticates_return, CT_LEN, cnt);
+}
 
-        if (node.isLeftChild()) {
-            ChameleonHash::digest(subTreeX, sibchash, chash);
+template <size_t CT_LEN_>
+bool BasicAuthenticator<CT_LEN_>::verifys(const token_t* t, const st_t* ms, const ChameleonHash::pk_t* pk, size_t cnt, const ChameleonHash::hash_t& res)
+{
+    ACCA_PHASE(PHASE_VERIFY);
+    ACCA_PROBE2(verifys_entry, CT_LEN, cnt);
+    ChameleonHash::mergeV_t acc;
+    ChameleonHash::mergeVInitialize(acc);
+    for (size_t i = 0; i < cnt; i++) {
+        ChameleonHash::digest_t X;
+        ChameleonHash::digest(X, ms[i]);
+        ChameleonHash::mergeVAdd(acc, X, t[i].rs[0], pk[i]);
+    }
+    ChameleonHash::hash_t hash;
+    ChameleonHash::mergeVFinalize(hash, acc);
+    bool ok = (hash == res);
+    ACCA_PROBE3(verifys_return, CT_LEN, cnt, ok);
+    return ok;
+}
+
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::authenticates(BasicTokenBatch<CT_LEN>& batch, const ct_t& ct, ChameleonHash::hash_t& res)
+{
+    ACCA_PROBE2(authenticates_entry, CT_LEN, batch.size());
+    ChameleonHash::digest_t X[BATCH_CHUNK];
+    ChameleonHash::mergeA_t acc;
+    ChameleonHash::mergeAInitialize(acc);
+    for (size_t done = 0; done < batch.size(); done += BATCH_CHUNK) {
+        size_t cnt = std::min(BATCH_CHUNK, batch.size() - done);
+        digestStatements(X, batch, done, cnt);
+        for (size_t j = 0; j < cnt; j++) {
+            size_t i = done + j;
+            authenticateDigest(batch.rs(i), batch.chs(i), batch.stride(), ct, X[j], batch.n(i));
+            ch.mergeAAdd(acc, X[j], *batch.rs(i), batch.n(i));
         }
-        else {
-            ChameleonHash::digest(subTreeX, chash, sibchash);
+    }
+    ChameleonHash::mergeAFinalize(res, acc);
+    ACCA_PROBE2(authenticates_return, CT_LEN, batch.size());
+}
+
+template <size_t CT_LEN_>
+bool BasicAuthenticator<CT_LEN_>::verifys(const BasicTokenBatch<CT_LEN>& batch, const ChameleonHash::pk_t* pk, const ChameleonHash::hash_t& res)
+{
+    ACCA_PHASE(PHASE_VERIFY);
+    ACCA_PROBE2(verifys_entry, CT_LEN, batch.size());
+    ChameleonHash::digest_t X[BATCH_CHUNK];
+    ChameleonHash::mergeV_t acc;
+    ChameleonHash::mergeVInitialize(acc);
+    for (size_t done = 0; done < batch.size(); done += BATCH_CHUNK) {
+        size_t cnt = std::min(BATCH_CHUNK, batch.size() - done);
+        digestStatements(X, batch, done, cnt);
+        for (size_t j = 0; j < cnt; j++) {
+            ChameleonHash::mergeVAdd(acc, X[j], *batch.rs(done + j), pk[done + j]);
         }
+    }
+    ChameleonHash::hash_t hash;
+    ChameleonHash::mergeVFinalize(hash, acc);
+    bool ok = (hash == res);
+    ACCA_PROBE3(verifys_return, CT_LEN, batch.size(), ok);
+    return ok;
+}
 
-        node.moveToParent();
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::verifyBatch(const BasicTokenBatch<CT_LEN>& batch, const ct_t* ct, bool* results)
+{
+    ACCA_PHASE(PHASE_VERIFY);
+    ACCA_PROBE2(verify_batch_entry, CT_LEN, batch.size());
+    size_t valid = 0;
+    chunk_t chunk;
+    const size_t chunkLen = std::min(BATCH_CHUNK, std::max<size_t>(1, Plan::current().verifyChunk));
+    for (size_t done = 0; done < batch.size(); done += chunkLen) {
+        chunk.first = done;
+        chunk.cnt = std::min(chunkLen, batch.size() - done);
+        verifyChunkStatements(chunk, batch, ct);
+        verifyChunkLevels(chunk, batch);
+        valid += verifyChunkRoot(chunk, results);
     }
-    assert(subTreeX == rootDigest);
+    ACCA_PROBE3(verify_batch_return, CT_LEN, batch.size(), valid);
 }
 
-void Authenticator::authenticates(altMessage& t, int cnt, const ct_t& ct, int n[], ChameleonHash::hash_t& res)
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::verifyChunkStatements(chunk_t& chunk, const BasicTokenBatch<CT_LEN>& batch, const ct_t* ct)
 {
-	for (int i = 0; i < cnt; i++) {
-		authenticate(t.token[i], ct, t.ms[i], n[i]);
-	}
-	std::vector< ChameleonHash::rand_t> r;
-	for (int i = 0; i < cnt; i++) {
-		r.push_back(*t.token[i].rs.begin());
-	}
-	std::vector< ChameleonHash::digest_t> ms;
-	for (int i = 0; i < cnt; i++) {
-		ChameleonHash::digest_t X;
-		ChameleonHash::digest(X, t.ms[i]);
-		ms.push_back(X);
-	}
-	ch.mergeA(res, ms, r, n, cnt);
+    digestStatements(chunk.X.data(), batch, chunk.first, chunk.cnt);
+    for (size_t j = 0; j < chunk.cnt; j++) {
+        Node<CT_LEN> node(ct[chunk.first + j]);
+        for (size_t i = 0; i < DEPTH; i++) {
+            chunk.isLeft[j][i] = node.isLeftChild();
+            node.moveToParent();
+        }
+    }
 }
 
-bool Authenticator::verifys(const altMessage& t, int cnt, const ct_t& ct, int n[],std::vector<ChameleonHash::pk_t> pk, dw_t w, ChameleonHash::hash_t& res)
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::verifyChunkLevels(chunk_t& chunk, const BasicTokenBatch<CT_LEN>& batch)
 {
-	/*for (int i = 0; i < cnt; i++) {
-		ChameleonHash ch_t(pk[i], w);
-		this->ch = ch_t;
-		if (!verifyWithLog(t.token[i], ct, t.ms[i], nullptr, n[i])) return false;
-	}*/
-	std::vector<ChameleonHash::rand_t> r;
-	for (int i = 0; i < cnt; i++) {
-		r.push_back(*t.token[i].rs.begin());
-	}
-	std::vector<ChameleonHash::digest_t> ms;
-	for (int i = 0; i < cnt; i++) {
-		ChameleonHash::digest_t X;
-		ChameleonHash::digest(X, t.ms[i]);
-		ms.push_back(X);
-	}
-	ChameleonHash::hash_t hash;
-	ch.mergeV(hash, ms, r, pk, cnt);
-	return (hash == res);
+    ChameleonHash::digest_t* subTreeX = chunk.X.data();
+    ChameleonHash::hash_t chash[BATCH_CHUNK];
+    const ChameleonHash::hash_t* in1[BATCH_CHUNK];
+    const ChameleonHash::hash_t* in2[BATCH_CHUNK];
+    const ChameleonHash::rand_t* r[BATCH_CHUNK];
+    int n[BATCH_CHUNK];
+    size_t cnt = chunk.cnt;
+
+    // Walk all items up the tree together, so that the hashes of one level can be batched.
+    for (size_t i = 0; i < DEPTH; i++) {
+        for (size_t j = 0; j < cnt; j++) {
+            size_t k = chunk.first + j;
+            r[j] = &batch.rs(k)[i * batch.stride()];
+            n[j] = batch.n(k);
+            in1[j] = &chash[j];
+        }
+        ch.ch(chash, subTreeX, r, n, cnt);
+        if (i == 0) {
+            ChameleonHash::randomOracle(chash, in1, r, cnt, suite);
+        }
+        for (size_t j = 0; j < cnt; j++) {
+            const ChameleonHash::hash_t* sibchash = &batch.chs(chunk.first + j)[i * batch.stride()];
+            if (chunk.isLeft[j][i]) {
+                in1[j] = &chash[j];
+                in2[j] = sibchash;
+            }
+            else {
+                in1[j] = sibchash;
+                in2[j] = &chash[j];
+            }
+        }
+        ChameleonHash::digest(subTreeX, in1, in2, cnt, suite);
+    }
 }
 
-bool Authenticator::verify(const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, int n)
+template <size_t CT_LEN_>
+size_t BasicAuthenticator<CT_LEN_>::verifyChunkRoot(const chunk_t& chunk, bool* results) const
 {
-    return verifyWithLog(t, ct, st, nullptr, n);
+    size_t valid = 0;
+    for (size_t j = 0; j < chunk.cnt; j++) {
+        results[chunk.first + j] = (chunk.X[j] == rootDigest);
+        valid += results[chunk.first + j];
+    }
+    return valid;
 }
 
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::digestStatements(ChameleonHash::digest_t* X, const BasicTokenBatch<CT_LEN>& batch, size_t first, size_t cnt)
+{
+    const unsigned char* st[BATCH_CHUNK];
+    size_t len[BATCH_CHUNK];
+    for (size_t j = 0; j < cnt; j++) {
+        st[j] = batch.statement(first + j);
+        len[j] = batch.statementLen(first + j);
+    }
+    ChameleonHash::digest(X, st, len, cnt);
+}
 
-bool Authenticator::verifyWithLog(const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st, log_t* log, int n)
+template <size_t CT_LEN_>
+bool BasicAuthenticator<CT_LEN_>::verify(const BasicTokenBatch<CT_LEN>& batch, size_t i, const ct_t& ct)
 {
-    ChameleonHash::digest_t subTreeX;
+    ACCA_PROBE2(verify_entry, CT_LEN, batch.n(i));
+    ChameleonHash::digest_t X;
+    ChameleonHash::digest(X, batch.statement(i), batch.statementLen(i));
+    bool ok = verifyDigest(batch.rs(i), batch.chs(i), batch.stride(), ct, X, nullptr, batch.n(i));
+    ACCA_PROBE3(verify_return, CT_LEN, batch.n(i), ok);
+    return ok;
+}
+
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::aggregate(AggregateProof& proof, const altMessage& t, int cnt, const std::vector<ChameleonHash::pk_t>& pk, const ChameleonHash::hash_t& res)
+{
+    proof = AggregateProof();
+    // items of the same signer share one entry in the key table
+    std::map<ChameleonHash::pk_t, AggregateProof::ref_t> refs;
+    for (int i = 0; i < cnt; i++) {
+        auto ref = refs.find(pk[i]);
+        if (ref == refs.end()) {
+            ref = refs.insert(std::make_pair(pk[i], proof.addPk(pk[i]))).first;
+        }
+        ChameleonHash::digest_t X;
+        ChameleonHash::digest(X, t.ms[i]);
+        proof.addItem(X, *t.token[i].rs.begin(), ref->second);
+    }
+    proof.hash = res;
+}
+
+template <size_t CT_LEN_>
+bool BasicAuthenticator<CT_LEN_>::verifys(const AggregateProof& proof)
+{
+    ACCA_PROBE2(verifys_entry, CT_LEN, proof.digests.size());
+    ChameleonHash::hash_t hash;
+    ch.mergeV(hash, proof.digests, proof.rs, proof.pks, proof.pkRefs);
+    bool ok = (hash == proof.hash);
+    ACCA_PROBE3(verifys_return, CT_LEN, proof.digests.size(), ok);
+    return ok;
+}
+
+template <size_t CT_LEN_>
+bool BasicAuthenticator<CT_LEN_>::verify(const token_t& t, const ct_t& ct, const st_t& st, int n)
+{
+    ACCA_PROBE2(verify_entry, CT_LEN, n);
+    bool ok = verifyWithLog(t, ct, st, nullptr, n);
+    ACCA_PROBE3(verify_return, CT_LEN, n, ok);
+    return ok;
+}
+
+
+template <size_t CT_LEN_>
+bool BasicAuthenticator<CT_LEN_>::verifyWithLog(const token_t& t, const ct_t& ct, const st_t& st, log_t* log, int n)
+{
+    ChameleonHash::digest_t stX;
+    ChameleonHash::digest(stX, st);
+    return verifyDigest(t.rs.data(), t.chs.data(), 1, ct, stX, log, n);
+}
+
+template <size_t CT_LEN_>
+bool BasicAuthenticator<CT_LEN_>::verifyDigest(const ChameleonHash::rand_t* rs, const ChameleonHash::hash_t* chs, size_t stride, const ct_t& ct, const ChameleonHash::digest_t& stX, log_t* log, int n)
+{
+    ACCA_PHASE(PHASE_VERIFY);
+    ChameleonHash::digest_t subTreeX = stX;
     ChameleonHash::hash_t chash;
 
-    Node node(ct);
-    ChameleonHash::digest(subTreeX, st);
-    auto rIt = t.rs.begin();
-    auto sibchashIt = t.chs.begin();
+    Node<CT_LEN> node(ct);
 
-    bool first = true;
-    while (!node.isRoot()) { // stop after the hash in the root
-        ch.ch(chash, subTreeX, *rIt, n);
+    for (size_t i = 0; i < DEPTH; i++) { // stop after the hash in the root
+        const ChameleonHash::rand_t& r = rs[i * stride];
+        const ChameleonHash::hash_t& sibchash = chs[i * stride];
+        ch.ch(chash, subTreeX, r, n);
 
         if (log) {
-            log->chs.push_back(chash);
-            log->xs.push_back(subTreeX);
+            log->chs[i] = chash;
+            log->xs[i] = subTreeX;
         }
 
-        if (first) {
-            ChameleonHash::randomOracle(chash, chash, *rIt);
-            first = false;
+        if (i == 0) {
+            ChameleonHash::randomOracle(chash, chash, r, suite);
         }
 
         // compute hash of the parent of node
         if (node.isLeftChild()) {
-            ChameleonHash::digest(subTreeX, chash, *sibchashIt);
+            ChameleonHash::digest(subTreeX, chash, sibchash, suite);
         }
         else {
-            ChameleonHash::digest(subTreeX, *sibchashIt, chash);
+            ChameleonHash::digest(subTreeX, sibchash, chash, suite);
         }
 
-        rIt++;
-        sibchashIt++;
         node.moveToParent();
     }
-    assert(sibchashIt == t.chs.end());
-    assert(rIt == t.rs.end());
+    assert(node.isRoot());
     return (subTreeX == rootDigest);
 }
 
-void Authenticator::extract(const Authenticator::token_t& t1, const Authenticator::token_t& t2, const Authenticator::ct_t& ct, const Authenticator::st_t& st1, const Authenticator::st_t& st2, int n1, int n2)
+template <size_t CT_LEN_>
+void BasicAuthenticator<CT_LEN_>::extract(const token_t& t1, const token_t& t2, const ct_t& ct, const st_t& st1, const st_t& st2, int n1, int n2)
 {
+    ACCA_PROBE3(extract_entry, CT_LEN, n1, n2);
     log_t log1, log2;
     if (!verifyWithLog(t1, ct, st1, &log1, n1)) {
         throw std::invalid_argument("t1 does not verify");
@@ -202,7 +428,7 @@ void Authenticator::extract(const Authenticator::token_t& t1, const Authenticato
         throw std::invalid_argument("t2 does not verify");
     }
 
-    for (int i = 0; i < DEPTH; i++) {
+    for (size_t i = 0; i < DEPTH; i++) {
         // check for collision
         if ((log1.xs[i] != log2.xs[i] || t1.rs[i] != t2.rs[i]) && log1.chs[i] == log2.chs[i]) {
             ch.extract(log1.xs[i], t1.rs[i], n1, log2.xs[i], t2.rs[i], n2);
@@ -212,18 +438,26 @@ void Authenticator::extract(const Authenticator::token_t& t1, const Authenticato
         }
         hasSecretKey_ = true;
     }
+    ACCA_PROBE4(extract_return, CT_LEN, n1, n2, hasSecretKey_);
 }
 
 
-Authenticator::dpk_t Authenticator::getDpk()
+template <size_t CT_LEN_>
+typename BasicAuthenticator<CT_LEN_>::dpk_t BasicAuthenticator<CT_LEN_>::getDpk()
 {
     dpk_t dpk;
     dpk.chpk = ch.getPk(true);
     dpk.rootDigest = rootDigest;
+    dpk.suite = suite;
+    dpk.derivation = derivation;
     return dpk;
 }
 
-Authenticator::dsk_t Authenticator::getDsk()
+template <size_t CT_LEN_>
+typename BasicAuthenticator<CT_LEN_>::dsk_t BasicAuthenticator<CT_LEN_>::getDsk()
 {
     return ch.getSk();
 }
+
+#define ACCA_INSTANTIATE_AUTHENTICATOR(CT_LEN) template class BasicAuthenticator<CT_LEN>;
+ACCA_FOR_EACH_CT_LEN(ACCA_INSTANTIATE_AUTHENTICATOR)
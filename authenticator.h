@@ -29,19 +29,26 @@
 
 #include "chameleonhash.h"
 #include "prf.h"
+#include "suite.h"
 
-class Authenticator
+#include <bitset>
+
+class AggregateProof;
+template <size_t CT_LEN> class BasicTokenBatch;
+
+template <size_t CT_LEN_>
+class BasicAuthenticator
 {
 public:
-    // Length of context in bytes. This is configurable via the ACCA_CT_LEN variable in cmake.
-    static const size_t CT_LEN = ACCA_CT_LEN;
+    // Length of context in bytes.
+    static constexpr size_t CT_LEN = CT_LEN_;
 
     // Depth is number of non-root levels.
-    static const size_t DEPTH = CT_LEN * 8;
+    static constexpr size_t DEPTH = CT_LEN * 8;
 
-    // Authentication tokens are 4160 bytes long. By compressing the sign bytes into bit vectors,
-    // we could additionally save 60 bits.
-    static const size_t TOKEN_LEN = DEPTH * (ChameleonHash::HASH_LEN + ChameleonHash::RAND_LEN);
+    // Authentication tokens are DEPTH * 65 bytes long, e.g., 4160 bytes for 8-byte contexts.
+    // By compressing the sign bytes into bit vectors, we could additionally save DEPTH - 4 bits.
+    static constexpr size_t TOKEN_LEN = DEPTH * (ChameleonHash::HASH_LEN + ChameleonHash::RAND_LEN);
 
     typedef std::array<unsigned char, CT_LEN> ct_t;
     typedef std::vector<unsigned char> st_t;
@@ -51,6 +58,9 @@ public:
     struct dpk_t {
         ChameleonHash::pk_t chpk;
         ChameleonHash::digest_t rootDigest;
+        // the defaults of the constructor, for dpks from before these options
+        Suite suite = SUITE_SHA256;
+        Derivation derivation = DERIVE_SEPARATE;
     };
 
     struct token_t {
@@ -63,33 +73,88 @@ public:
 		std::vector<st_t> ms;
 	};
 
-    Authenticator(const Authenticator::dsk_t& dsk, const Authenticator::dw_t& dw, int n);
-    Authenticator(const Authenticator::dpk_t& dpk, const Authenticator::dw_t& dw);
+    BasicAuthenticator(const dsk_t& dsk, const dw_t& dw, int n, Suite suite = SUITE_SHA256, Derivation derivation = DERIVE_SEPARATE);
+    BasicAuthenticator(const dpk_t& dpk, const dw_t& dw);
 
     void authenticate(token_t& t, const ct_t& ct, const st_t& st, int n);
 	void authenticates(altMessage& t, int cnt, const ct_t& ct, int n[], ChameleonHash::hash_t& res);
-	bool verifys(const altMessage& t, int cnt, const ct_t& ct, int n[], std::vector<ChameleonHash:: pk_t> pk, dw_t w, ChameleonHash::hash_t& res);
+	bool verifys(const altMessage& t, int cnt, const ct_t& ct, int n[], const std::vector<ChameleonHash:: pk_t>& pk, dw_t w, ChameleonHash::hash_t& res);
     bool verify(const token_t& t, const ct_t& ct, const st_t& st, int n);
+
+    // authenticates and verifys on caller-owned arrays of cnt items. The tokens are written to t.
+    // They neither allocate nor modify their inputs.
+    void authenticates(token_t* t, const st_t* ms, const int* n, size_t cnt, const ct_t& ct, ChameleonHash::hash_t& res);
+    bool verifys(const token_t* t, const st_t* ms, const ChameleonHash::pk_t* pk, size_t cnt, const ChameleonHash::hash_t& res);
+
+    // The same on a TokenBatch, which supplies the statements and n values and receives the tokens.
+    void authenticates(BasicTokenBatch<CT_LEN>& batch, const ct_t& ct, ChameleonHash::hash_t& res);
+    bool verifys(const BasicTokenBatch<CT_LEN>& batch, const ChameleonHash::pk_t* pk, const ChameleonHash::hash_t& res);
+    bool verify(const BasicTokenBatch<CT_LEN>& batch, size_t i, const ct_t& ct);
+    // Verifies every token in the batch, item i against context ct[i], and stores the outcome in
+    // results[i]. The items move up the tree in lockstep, which allows to batch the hashing.
+    void verifyBatch(const BasicTokenBatch<CT_LEN>& batch, const ct_t* ct, bool* results);
+
+    // Number of items whose hashes the batch operations compute together. verifyBatch and
+    // VerifyPipeline use chunks of Plan::current().verifyChunk items, up to this many.
+    static constexpr size_t BATCH_CHUNK = 64;
+
+    // The three steps of verifyBatch on a chunk of up to BATCH_CHUNK items, for callers that
+    // run them on different threads (see VerifyPipeline). Each chunk must go through the steps
+    // in order.
+    struct chunk_t {
+        // the items first, ..., first + cnt - 1 of the batch
+        size_t first;
+        size_t cnt;
+        std::array<ChameleonHash::digest_t, BATCH_CHUNK> X;
+        std::array<std::bitset<DEPTH>, BATCH_CHUNK> isLeft;
+    };
+    // Digests the statements of the chunk and reads the paths from ct[first], ....
+    static void verifyChunkStatements(chunk_t& chunk, const BasicTokenBatch<CT_LEN>& batch, const ct_t* ct);
+    // Walks the chunk up to the root.
+    void verifyChunkLevels(chunk_t& chunk, const BasicTokenBatch<CT_LEN>& batch);
+    // Stores the outcomes in results[first], ... and returns the number of valid items.
+    size_t verifyChunkRoot(const chunk_t& chunk, bool* results) const;
+
+    // Compacts the output of authenticates into an AggregateProof, where pk[i] belongs to item i.
+    static void aggregate(AggregateProof& proof, const altMessage& t, int cnt, const std::vector<ChameleonHash::pk_t>& pk, const ChameleonHash::hash_t& res);
+    bool verifys(const AggregateProof& proof);
     void extract(const token_t& t1, const token_t& t2, const ct_t& ct, const st_t& st1, const st_t& st2, int n1, int n2);
 
-    Authenticator::dpk_t getDpk();
-    Authenticator::dsk_t getDsk();
+    dpk_t getDpk();
+    dsk_t getDsk();
 
 
 private:
     dsk_t dsk;
     ChameleonHash::digest_t rootDigest;
+    Suite suite;
+    Derivation derivation;
     int _n;
 
     ChameleonHash ch;
     bool hasSecretKey_;
 
     struct log_t {
-        std::vector<ChameleonHash::hash_t> chs;
-        std::vector<ChameleonHash::digest_t> xs;
+        std::array<ChameleonHash::hash_t, DEPTH> chs;
+        std::array<ChameleonHash::digest_t, DEPTH> xs;
     };
     bool verifyWithLog(const token_t& t, const ct_t& ct, const st_t& st, log_t* log, int n);
+
+    static void digestStatements(ChameleonHash::digest_t* X, const BasicTokenBatch<CT_LEN>& batch, size_t first, size_t cnt);
+
+    // Token level i is read from or written to rs[i * stride] and chs[i * stride].
+    void authenticateDigest(ChameleonHash::rand_t* rs, ChameleonHash::hash_t* chs, size_t stride, const ct_t& ct, const ChameleonHash::digest_t& stX, int n);
+    bool verifyDigest(const ChameleonHash::rand_t* rs, const ChameleonHash::hash_t* chs, size_t stride, const ct_t& ct, const ChameleonHash::digest_t& stX, log_t* log, int n);
 	
 };
 
+template <size_t CT_LEN_> constexpr size_t BasicAuthenticator<CT_LEN_>::CT_LEN;
+template <size_t CT_LEN_> constexpr size_t BasicAuthenticator<CT_LEN_>::DEPTH;
+template <size_t CT_LEN_> constexpr size_t BasicAuthenticator<CT_LEN_>::TOKEN_LEN;
+template <size_t CT_LEN_> constexpr size_t BasicAuthenticator<CT_LEN_>::BATCH_CHUNK;
+
+// BasicAuthenticator is instantiated for the context lengths in ACCA_FOR_EACH_CT_LEN (see node.h).
+// The default length is configurable via the ACCA_CT_LEN variable in cmake.
+typedef BasicAuthenticator<ACCA_CT_LEN> Authenticator;
+
 #endif // AUTHENTICATOR_H
@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Google Benchmark cases for the public operations, for tracking performance across releases.
+// Every case reports ops/s, ns/op and the peak RSS of the process. Cases that take a batch
+// size count one op per item, and all cases can run on several threads, each with its own
+// objects.
+//
+// With --perf_counters, every case also reports cycles, instructions, L1d, LLC and dTLB misses
+// per op from perf_event_open. Where perf is not permitted, e.g. in a container with
+// perf_event_paranoid > 2 or a seccomp filter, the counters are left out. With
+// --alloc_counters, every case reports the heap allocations and allocated bytes per op.
+//
+// usage: acca_bench [--perf_counters] [--alloc_counters] [--benchmark_filter=<regex>] [--benchmark_format=json] ...
+
+#include "../authenticator.h"
+#include "../node.h"
+#include "../numa.h"
+#include "../prf.h"
+#include "../tokenbatch.h"
+#include "../verifypipeline.h"
+
+#include "perfcounters.h"
+#include "../test/allocstats.h"
+
+#include <benchmark/benchmark.h>
+
+#include <sys/resource.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const ChameleonHash::sk_t SK = {{
+    0xb2, 0x19, 0x77, 0xc8, 0xca, 0x1c, 0xbb, 0x55, 0xf0, 0xa3, 0xef, 0xfd, 0x99, 0x66, 0xe3, 0xd5,
+    0xc9, 0x58, 0x86, 0x88, 0xfa, 0x02, 0xbf, 0x7a, 0x0d, 0x2a, 0xf7, 0xb6, 0x36, 0x6f, 0x1e, 0x8f
+}};
+const ChameleonHash::W W = SK;
+const std::vector<unsigned char> ST = { 'a', 'b', 'c' };
+
+const int MAX_THREADS = std::max(1u, std::thread::hardware_concurrency());
+
+bool allocCounters = false;
+
+// Optional per-thread counters, started right before the timed loop of a case.
+struct Counters {
+    PerfCounters perf;
+    AllocStats::Scope allocs;
+};
+
+// Sets the counters every case reports, for ops operations per iteration. ns/op is an inverted
+// rate, so the console prints it with an "s" suffix; the value is in nanoseconds. The hardware
+// events of perf and the heap allocations, if enabled, are reported per op and averaged over
+// the threads.
+void report(benchmark::State& state, size_t ops, const Counters& counters)
+{
+    // before the counters map allocates
+    AllocStats::stats_t allocs = counters.allocs.get();
+    double total = (double) state.iterations() * ops;
+    state.counters["ops/s"] = benchmark::Counter(total, benchmark::Counter::kIsRate);
+    state.counters["ns/op"] = benchmark::Counter(total / 1e9, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    state.counters["peak_rss_kb"] = benchmark::Counter(usage.ru_maxrss, benchmark::Counter::kAvgThreads);
+    for (size_t i = 0; i < PerfCounters::EVENT_COUNT; i++) {
+        PerfCounters::Event event = (PerfCounters::Event) i;
+        uint64_t value;
+        if (counters.perf.read(event, value)) {
+            std::string name = std::string(PerfCounters::name(event)) + "/op";
+            state.counters[name] = benchmark::Counter(value / total, benchmark::Counter::kAvgThreads);
+        }
+    }
+    if (allocCounters) {
+        state.counters["allocs/op"] = benchmark::Counter(allocs.count / total, benchmark::Counter::kAvgThreads);
+        state.counters["alloc_bytes/op"] = benchmark::Counter(allocs.bytes / total, benchmark::Counter::kAvgThreads);
+    }
+}
+
+ChameleonHash::digest_t digestOf(size_t i)
+{
+    ChameleonHash::digest_t d;
+    ChameleonHash::mesg_t m(ST);
+    m.push_back(i);
+    ChameleonHash::digest(d, m);
+    return d;
+}
+
+ChameleonHash::rand_t randOf(size_t i)
+{
+    ChameleonHash::rand_t r;
+    ChameleonHash::digest(r, digestOf(i + 1000000).data(), ChameleonHash::MESG_LEN);
+    return r;
+}
+
+void BM_ChSk(benchmark::State& state)
+{
+    ChameleonHash ch(SK, W, 0);
+    ChameleonHash::digest_t m = digestOf(0);
+    ChameleonHash::rand_t r = randOf(0);
+    ChameleonHash::hash_t h;
+    Counters counters;
+    for (auto _ : state) {
+        ch.ch(h, m, r, 0);
+        benchmark::DoNotOptimize(h);
+    }
+    report(state, 1, counters);
+}
+
+void BM_ChPk(benchmark::State& state)
+{
+    ChameleonHash ch(ChameleonHash(SK, W, 0).getPk(true), W);
+    ChameleonHash::digest_t m = digestOf(0);
+    ChameleonHash::rand_t r = randOf(0);
+    ChameleonHash::hash_t h;
+    Counters counters;
+    for (auto _ : state) {
+        ch.ch(h, m, r, 0);
+        benchmark::DoNotOptimize(h);
+    }
+    report(state, 1, counters);
+}
+
+void BM_ChPkBatch(benchmark::State& state)
+{
+    size_t cnt = state.range(0);
+    ChameleonHash ch(ChameleonHash(SK, W, 0).getPk(true), W);
+    std::vector<ChameleonHash::digest_t> m(cnt);
+    std::vector<ChameleonHash::rand_t> r(cnt);
+    std::vector<const ChameleonHash::rand_t*> rp(cnt);
+    std::vector<int> n(cnt, 0);
+    std::vector<ChameleonHash::hash_t> h(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+        m[i] = digestOf(i);
+        r[i] = randOf(i);
+        rp[i] = &r[i];
+    }
+    Counters counters;
+    for (auto _ : state) {
+        ch.ch(h.data(), m.data(), rp.data(), n.data(), cnt);
+        benchmark::DoNotOptimize(h.data());
+    }
+    report(state, cnt, counters);
+}
+
+void BM_Collision(benchmark::State& state)
+{
+    ChameleonHash ch(SK, W, 0);
+    ChameleonHash::digest_t m1 = digestOf(0), m2 = digestOf(1);
+    ChameleonHash::rand_t r1 = randOf(0), r2;
+    Counters counters;
+    for (auto _ : state) {
+        ch.collision(m1, r1, 0, m2, r2, 0);
+        benchmark::DoNotOptimize(r2);
+    }
+    report(state, 1, counters);
+}
+
+void BM_Extract(benchmark::State& state)
+{
+    ChameleonHash ch(SK, W, 0);
+    ChameleonHash::digest_t m1 = digestOf(0), m2 = digestOf(1);
+    ChameleonHash::rand_t r1 = randOf(0), r2;
+    ch.collision(m1, r1, 0, m2, r2, 0);
+    Counters counters;
+    for (auto _ : state) {
+        ch.extract(m1, r1, 0, m2, r2, 0);
+    }
+    report(state, 1, counters);
+}
+
+void BM_MergeA(benchmark::State& state)
+{
+    size_t cnt = state.range(0);
+    ChameleonHash ch(SK, W, 0);
+    std::vector<ChameleonHash::digest_t> m(cnt);
+    std::vector<ChameleonHash::rand_t> r(cnt);
+    std::vector<int> n(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+        m[i] = digestOf(i);
+        r[i] = randOf(i);
+        n[i] = i + 1;
+    }
+    ChameleonHash::hash_t h;
+    Counters counters;
+    for (auto _ : state) {
+        ch.mergeA(h, m.data(), r.data(), n.data(), cnt);
+        benchmark::DoNotOptimize(h);
+    }
+    report(state, cnt, counters);
+}
+
+void BM_MergeV(benchmark::State& state)
+{
+    size_t cnt = state.range(0);
+    std::vector<ChameleonHash::digest_t> m(cnt);
+    std::vector<ChameleonHash::rand_t> r(cnt);
+    std::vector<ChameleonHash::pk_t> pk(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+        m[i] = digestOf(i);
+        r[i] = randOf(i);
+        pk[i] = ChameleonHash(SK, W, i + 1).getPk(true);
+    }
+    ChameleonHash::hash_t h;
+    Counters counters;
+    for (auto _ : state) {
+        ChameleonHash::mergeV(h, m.data(), r.data(), pk.data(), cnt);
+        benchmark::DoNotOptimize(h);
+    }
+    report(state, cnt, counters);
+}
+
+void BM_Prf(benchmark::State& state)
+{
+    Prf prf(SK, false);
+    unsigned char data[Node<8>::BYTES_LEN] = {};
+    Prf::out_t x, r;
+    Counters counters;
+    for (auto _ : state) {
+        prf.getXR(x, r, data, sizeof data);
+        data[0] = x[0];
+    }
+    report(state, 1, counters);
+}
+
+void BM_PrfBatch(benchmark::State& state)
+{
+    size_t cnt = state.range(0);
+    Prf prf(SK, false);
+    std::vector<unsigned char> data(cnt * Node<8>::BYTES_LEN, 1);
+    std::vector<Prf::out_t> x(cnt), r(cnt);
+    Counters counters;
+    for (auto _ : state) {
+        prf.getXR(x.data(), r.data(), data.data(), Node<8>::BYTES_LEN, cnt);
+        data[0] = x[0][0];
+    }
+    report(state, cnt, counters);
+}
+
+template <size_t CT_LEN>
+void BM_Authenticate(benchmark::State& state)
+{
+    BasicAuthenticator<CT_LEN> acca(SK, W, 0);
+    typename BasicAuthenticator<CT_LEN>::token_t t;
+    typename BasicAuthenticator<CT_LEN>::ct_t ct = {};
+    Counters counters;
+    for (auto _ : state) {
+        ct[0]++;
+        acca.authenticate(t, ct, ST, 0);
+        benchmark::DoNotOptimize(t);
+    }
+    report(state, 1, counters);
+}
+
+template <size_t CT_LEN>
+void BM_Verify(benchmark::State& state)
+{
+    BasicAuthenticator<CT_LEN> acca(SK, W, 0);
+    BasicAuthenticator<CT_LEN> verifier(acca.getDpk(), W);
+    typename BasicAuthenticator<CT_LEN>::token_t t;
+    typename BasicAuthenticator<CT_LEN>::ct_t ct = {};
+    acca.authenticate(t, ct, ST, 0);
+    Counters counters;
+    for (auto _ : state) {
+        if (!verifier.verify(t, ct, ST, 0)) {
+            state.SkipWithError("verification failed");
+            break;
+        }
+    }
+    report(state, 1, counters);
+}
+
+template <size_t CT_LEN>
+void BM_Authenticates(benchmark::State& state)
+{
+    size_t cnt = state.range(0);
+    BasicAuthenticator<CT_LEN> acca(SK, W, 0);
+    BasicTokenBatch<CT_LEN> batch(cnt, cnt * ST.size());
+    for (size_t i = 0; i < cnt; i++) {
+        batch.add(ST, 0);
+    }
+    typename BasicAuthenticator<CT_LEN>::ct_t ct = {};
+    ChameleonHash::hash_t h;
+    Counters counters;
+    for (auto _ : state) {
+        ct[0]++;
+        acca.authenticates(batch, ct, h);
+        benchmark::DoNotOptimize(h);
+    }
+    report(state, cnt, counters);
+}
+
+template <size_t CT_LEN>
+void BM_VerifyBatch(benchmark::State& state)
+{
+    size_t cnt = state.range(0);
+    BasicAuthenticator<CT_LEN> acca(SK, W, 0);
+    BasicAuthenticator<CT_LEN> verifier(acca.getDpk(), W);
+    BasicTokenBatch<CT_LEN> batch(cnt, cnt * ST.size());
+    for (size_t i = 0; i < cnt; i++) {
+        batch.add(ST, 0);
+    }
+    typename BasicAuthenticator<CT_LEN>::ct_t ct = {};
+    ChameleonHash::hash_t h;
+    acca.authenticates(batch, ct, h);
+    std::vector<typename BasicAuthenticator<CT_LEN>::ct_t> cts(cnt, ct);
+    std::unique_ptr<bool[]> results(new bool[cnt]);
+    Counters counters;
+    for (auto _ : state) {
+        verifier.verifyBatch(batch, cts.data(), results.get());
+        if (!results[cnt - 1]) {
+            state.SkipWithError("verification failed");
+            break;
+        }
+    }
+    report(state, cnt, counters);
+}
+
+// BM_VerifyBatch with the threads bound to the NUMA nodes in turn, each with its own verifier
+// and batch, so that all tables but the static ones of libsecp256k1 are on the local node.
+// On a machine with several nodes, compare with BM_VerifyBatch on as many threads.
+template <size_t CT_LEN>
+void BM_VerifyBatchNuma(benchmark::State& state)
+{
+    int node = state.thread_index() % Numa::nodes();
+    if (!Numa::bindThread(node)) {
+        state.SkipWithError("cannot bind to the node");
+        return;
+    }
+    size_t cnt = state.range(0);
+    BasicAuthenticator<CT_LEN> acca(SK, W, 0);
+    BasicAuthenticator<CT_LEN> verifier(acca.getDpk(), W);
+    BasicTokenBatch<CT_LEN> batch(cnt, cnt * ST.size());
+    for (size_t i = 0; i < cnt; i++) {
+        batch.add(ST, 0);
+    }
+    typename BasicAuthenticator<CT_LEN>::ct_t ct = {};
+    ChameleonHash::hash_t h;
+    acca.authenticates(batch, ct, h);
+    std::vector<typename BasicAuthenticator<CT_LEN>::ct_t> cts(cnt, ct);
+    std::unique_ptr<bool[]> results(new bool[cnt]);
+    Counters counters;
+    for (auto _ : state) {
+        verifier.verifyBatch(batch, cts.data(), results.get());
+        if (!results[cnt - 1]) {
+            state.SkipWithError("verification failed");
+            break;
+        }
+    }
+    report(state, cnt, counters);
+    state.counters["nodes"] = benchmark::Counter(Numa::nodes(), benchmark::Counter::kAvgThreads);
+    Numa::unbindThread();
+}
+
+// verifyBatch through a VerifyPipeline with the default layout, which runs a walker on every
+// CPU but the first. Compare with BM_VerifyBatch on as many threads.
+template <size_t CT_LEN>
+void BM_VerifyPipeline(benchmark::State& state)
+{
+    size_t cnt = state.range(0);
+    BasicAuthenticator<CT_LEN> acca(SK, W, 0);
+    BasicVerifyPipeline<CT_LEN> pipeline(acca.getDpk(), W);
+    BasicTokenBatch<CT_LEN> batch(cnt, cnt * ST.size());
+    for (size_t i = 0; i < cnt; i++) {
+        batch.add(ST, 0);
+    }
+    typename BasicAuthenticator<CT_LEN>::ct_t ct = {};
+    ChameleonHash::hash_t h;
+    acca.authenticates(batch, ct, h);
+    std::vector<typename BasicAuthenticator<CT_LEN>::ct_t> cts(cnt, ct);
+    std::unique_ptr<bool[]> results(new bool[cnt]);
+    Counters counters;
+    for (auto _ : state) {
+        pipeline.verifyBatch(batch, cts.data(), results.get());
+        if (!results[cnt - 1]) {
+            state.SkipWithError("verification failed");
+            break;
+        }
+    }
+    report(state, cnt, counters);
+}
+
+void batchSizes(benchmark::internal::Benchmark* b)
+{
+    b->RangeMultiplier(8)->Range(1, 512)->ThreadRange(1, MAX_THREADS)->UseRealTime();
+}
+
+void pipelineSizes(benchmark::internal::Benchmark* b)
+{
+    b->RangeMultiplier(8)->Range(64, 512)->UseRealTime();
+}
+
+void threads(benchmark::internal::Benchmark* b)
+{
+    b->ThreadRange(1, MAX_THREADS)->UseRealTime();
+}
+
+}
+
+BENCHMARK(BM_ChSk)->Apply(threads);
+BENCHMARK(BM_ChPk)->Apply(threads);
+BENCHMARK(BM_ChPkBatch)->Apply(batchSizes);
+BENCHMARK(BM_Collision)->Apply(threads);
+BENCHMARK(BM_Extract)->Apply(threads);
+BENCHMARK(BM_MergeA)->Apply(batchSizes);
+BENCHMARK(BM_MergeV)->Apply(batchSizes);
+BENCHMARK(BM_Prf)->Apply(threads);
+BENCHMARK(BM_PrfBatch)->Apply(batchSizes);
+
+#define ACCA_BENCHMARK_CT_LEN(CT_LEN) \
+    BENCHMARK_TEMPLATE(BM_Authenticate, CT_LEN)->Apply(threads); \
+    BENCHMARK_TEMPLATE(BM_Verify, CT_LEN)->Apply(threads); \
+    BENCHMARK_TEMPLATE(BM_Authenticates, CT_LEN)->Apply(batchSizes); \
+    BENCHMARK_TEMPLATE(BM_VerifyBatch, CT_LEN)->Apply(batchSizes); \
+    BENCHMARK_TEMPLATE(BM_VerifyBatchNuma, CT_LEN)->Apply(batchSizes); \
+    BENCHMARK_TEMPLATE(BM_VerifyPipeline, CT_LEN)->Apply(pipelineSizes);
+ACCA_FOR_EACH_CT_LEN(ACCA_BENCHMARK_CT_LEN)
+
+int main(int argc, char** argv)
+{
+    // --perf_counters and --alloc_counters are ours; the remaining flags are Google Benchmark's.
+    int n = 1;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--perf_counters") {
+            PerfCounters::setEnabled(true);
+        } else if (std::string(argv[i]) == "--alloc_counters") {
+            allocCounters = true;
+        } else {
+            argv[n++] = argv[i];
+        }
+    }
+    argc = n;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    if (PerfCounters::enabled()) {
+        // Open a set up front, so that an unusable perf is reported once and not per case.
+        PerfCounters probe;
+        if (PerfCounters::error()) {
+            std::cerr << "perf events unavailable (" << PerfCounters::error() << "), not reporting hardware counters" << std::endl;
+            PerfCounters::setEnabled(false);
+        }
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,675 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Simulation of a consortium on one machine: --signers processes, each an Authenticator with
+// its own dsk, w and n, send authenticated messages to --validators processes over Unix
+// sockets. Every validator checks every message: single messages with verify, batches of
+// --batch statements under one context with verifys, and it calls extract when a signer
+// equivocates, i.e., authenticates two statements for the same context.
+//
+// Each signer issues messages as a Poisson process at the given rate; a fraction of them are
+// batches (--batch-fraction) or equivocations (--equivocations, sent as two single messages).
+// The end-to-end latency of a message runs from its scheduled time at the signer until a
+// validator has checked it, so it contains signing, queueing in the sockets and verification.
+// For every rate in --rate, the simulation runs once and prints the delivered throughput, the
+// latency percentiles over all validators and the equivocations detected. Raising the rate
+// until the throughput stops following it shows where the deployment saturates.
+//
+// usage: acca_consortium [--signers=<n>] [--validators=<m>] [--rate=<msg/s per signer>,...]
+//                        [--duration=<s>] [--batch=<items>] [--batch-fraction=<f>]
+//                        [--equivocations=<f>] [--window=<contexts>] [--seed=<n>] [--csv]
+
+#include "../authenticator.h"
+#include "latencyhistogram.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock clock_t_;
+
+struct options_t {
+    size_t signers = 2;
+    size_t validators = 2;
+    std::vector<double> rates = { 10 };
+    double duration = 5;
+    size_t batch = 8;
+    double batchFraction = 0.1;
+    double equivocations = 0.01;
+    size_t window = 4096;
+    unsigned seed = 1;
+    bool csv = false;
+};
+
+// keys of one signer; generated before forking, so that every process knows them
+struct signerKeys_t {
+    Authenticator::dsk_t dsk;
+    Authenticator::dw_t w;
+    int n;
+    Authenticator::dpk_t dpk;
+};
+
+enum FrameType : uint32_t { SINGLE, BATCH };
+
+// Header of a message on the socket from a signer to a validator. A SINGLE payload holds ct,
+// the token and the statement. A BATCH payload holds ct and the hash res of authenticates,
+// followed by cnt items of a 32-bit statement length, the statement and the token.
+struct frame_t {
+    uint32_t type;
+    uint32_t signer;
+    uint32_t cnt;
+    uint32_t len;
+    // scheduled time of the message in nanoseconds of the steady clock
+    uint64_t due;
+};
+
+// What a child process reports to the coordinator, followed by latencyCnt latencies in ns.
+struct report_t {
+    uint64_t singles;
+    uint64_t batches;
+    uint64_t equivocations;
+    uint64_t missed;
+    uint64_t verified;
+    uint64_t items;
+    uint64_t invalid;
+    uint64_t detected;
+    uint64_t extractFailed;
+    uint64_t latencyCnt;
+};
+
+uint64_t nanos(clock_t_::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+clock_t_::time_point fromNanos(uint64_t ns)
+{
+    return clock_t_::time_point(std::chrono::duration_cast<clock_t_::duration>(std::chrono::nanoseconds(ns)));
+}
+
+void writeAll(int fd, const void* buf, size_t len)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(buf);
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            throw std::runtime_error(std::string("write: ") + strerror(errno));
+        }
+        p += w;
+        len -= w;
+    }
+}
+
+// Returns false on end of file before the first byte.
+bool readAll(int fd, void* buf, size_t len)
+{
+    unsigned char* p = static_cast<unsigned char*>(buf);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t r = read(fd, p + done, len - done);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r < 0) {
+            throw std::runtime_error(std::string("read: ") + strerror(errno));
+        }
+        if (r == 0) {
+            if (done == 0) {
+                return false;
+            }
+            throw std::runtime_error("truncated message");
+        }
+        done += r;
+    }
+    return true;
+}
+
+template <typename T>
+void append(std::vector<unsigned char>& out, const T& v)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&v);
+    out.insert(out.end(), p, p + sizeof v);
+}
+
+template <typename T>
+void take(T& v, const unsigned char*& p, const unsigned char* end)
+{
+    if ((size_t) (end - p) < sizeof v) {
+        throw std::runtime_error("malformed message");
+    }
+    memcpy(&v, p, sizeof v);
+    p += sizeof v;
+}
+
+void randomStatement(Authenticator::st_t& st, std::mt19937_64& gen)
+{
+    std::uniform_int_distribution<int> byte(0, 255), len(1, 64);
+    st.resize(len(gen));
+    for (auto& c : st) {
+        c = byte(gen);
+    }
+}
+
+void randomContext(Authenticator::ct_t& ct, std::mt19937_64& gen)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& c : ct) {
+        c = byte(gen);
+    }
+}
+
+// Sends one frame to every validator.
+void broadcast(const std::vector<int>& fds, frame_t frame, const std::vector<unsigned char>& payload)
+{
+    frame.len = payload.size();
+    for (int fd : fds) {
+        writeAll(fd, &frame, sizeof frame);
+        writeAll(fd, payload.data(), payload.size());
+    }
+}
+
+void sendSingle(const std::vector<int>& fds, Authenticator& acca, uint32_t signer, int n, uint64_t due,
+                const Authenticator::ct_t& ct, const Authenticator::st_t& st)
+{
+    Authenticator::token_t t;
+    acca.authenticate(t, ct, st, n);
+    std::vector<unsigned char> payload;
+    append(payload, ct);
+    append(payload, t);
+    payload.insert(payload.end(), st.begin(), st.end());
+    frame_t frame = { SINGLE, signer, 1, 0, due };
+    broadcast(fds, frame, payload);
+}
+
+// Issues messages from start until end and returns what was sent.
+report_t runSigner(const options_t& opt, double rate, const signerKeys_t& keys, uint32_t signer,
+                   const std::vector<int>& fds, clock_t_::time_point start, clock_t_::time_point end)
+{
+    report_t report = {};
+    Authenticator acca(keys.dsk, keys.w, keys.n);
+    std::mt19937_64 gen(opt.seed * 1000003 + signer);
+    std::exponential_distribution<double> gap(rate);
+    std::uniform_real_distribution<double> kind(0, 1);
+    Authenticator::ct_t ct;
+    Authenticator::st_t st, st2;
+    std::vector<Authenticator::token_t> t(opt.batch);
+    std::vector<Authenticator::st_t> ms(opt.batch);
+    std::vector<int> ns(opt.batch, keys.n);
+
+    clock_t_::time_point next = start;
+    for (;;) {
+        next += std::chrono::duration_cast<clock_t_::duration>(std::chrono::duration<double>(gap(gen)));
+        if (next >= end) {
+            break;
+        }
+        if (clock_t_::now() >= end) {
+            report.missed++;
+            continue;
+        }
+        std::this_thread::sleep_until(next);
+
+        randomContext(ct, gen);
+        double k = kind(gen);
+        if (k < opt.equivocations) {
+            randomStatement(st, gen);
+            randomStatement(st2, gen);
+            st2.push_back(0);
+            sendSingle(fds, acca, signer, keys.n, nanos(next), ct, st);
+            sendSingle(fds, acca, signer, keys.n, nanos(next), ct, st2);
+            report.equivocations++;
+        } else if (k < opt.equivocations + opt.batchFraction) {
+            for (auto& m : ms) {
+                randomStatement(m, gen);
+            }
+            ChameleonHash::hash_t res;
+            acca.authenticates(t.data(), ms.data(), ns.data(), opt.batch, ct, res);
+            std::vector<unsigned char> payload;
+            append(payload, ct);
+            append(payload, res);
+            for (size_t i = 0; i < opt.batch; i++) {
+                append(payload, (uint32_t) ms[i].size());
+                payload.insert(payload.end(), ms[i].begin(), ms[i].end());
+                append(payload, t[i]);
+            }
+            frame_t frame = { BATCH, signer, (uint32_t) opt.batch, 0, nanos(next) };
+            broadcast(fds, frame, payload);
+            report.batches++;
+        } else {
+            randomStatement(st, gen);
+            sendSingle(fds, acca, signer, keys.n, nanos(next), ct, st);
+            report.singles++;
+        }
+    }
+    return report;
+}
+
+// Contexts a validator has seen from one signer, to detect equivocations; the oldest are
+// forgotten beyond the window.
+struct seen_t {
+    std::map<Authenticator::ct_t, std::pair<Authenticator::st_t, Authenticator::token_t>> byCt;
+    std::deque<Authenticator::ct_t> order;
+};
+
+// Checks messages until all signers have closed their sockets.
+report_t runValidator(const options_t& opt, const std::vector<signerKeys_t>& keys, const std::vector<int>& fds,
+                      std::vector<uint64_t>& latencies)
+{
+    report_t report = {};
+    std::vector<Authenticator> verifiers;
+    for (const auto& k : keys) {
+        verifiers.emplace_back(k.dpk, k.w);
+    }
+    std::vector<seen_t> seen(keys.size());
+    std::vector<pollfd> pfds;
+    for (int fd : fds) {
+        pfds.push_back(pollfd { fd, POLLIN, 0 });
+    }
+    std::vector<unsigned char> payload;
+    Authenticator::token_t t;
+    Authenticator::ct_t ct;
+    Authenticator::st_t st;
+
+    for (size_t open = fds.size(); open > 0; ) {
+        if (poll(pfds.data(), pfds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("poll: ") + strerror(errno));
+        }
+        for (auto& pfd : pfds) {
+            if (pfd.fd < 0 || !pfd.revents) {
+                continue;
+            }
+            frame_t frame;
+            if (!readAll(pfd.fd, &frame, sizeof frame)) {
+                close(pfd.fd);
+                pfd.fd = -1;
+                open--;
+                continue;
+            }
+            payload.resize(frame.len);
+            if (!readAll(pfd.fd, payload.data(), payload.size()) && frame.len > 0) {
+                throw std::runtime_error("truncated message");
+            }
+            if (frame.signer >= keys.size()) {
+                throw std::runtime_error("unknown signer");
+            }
+            const unsigned char* p = payload.data();
+            const unsigned char* end = p + payload.size();
+            Authenticator& verifier = verifiers[frame.signer];
+            int n = keys[frame.signer].n;
+            bool ok;
+            take(ct, p, end);
+            if (frame.type == SINGLE) {
+                take(t, p, end);
+                st.assign(p, end);
+                ok = verifier.verify(t, ct, st, n);
+                seen_t& s = seen[frame.signer];
+                auto prev = s.byCt.find(ct);
+                if (ok && prev != s.byCt.end() && prev->second.first != st) {
+                    // equivocation: recover the key on a copy, the verifier stays public
+                    Authenticator scratch = verifier;
+                    try {
+                        scratch.extract(prev->second.second, t, ct, prev->second.first, st, n, n);
+                        (scratch.getDsk() == keys[frame.signer].dsk ? report.detected : report.extractFailed)++;
+                    } catch (const std::exception&) {
+                        report.extractFailed++;
+                    }
+                } else if (ok && prev == s.byCt.end()) {
+                    s.byCt[ct] = std::make_pair(st, t);
+                    s.order.push_back(ct);
+                    if (s.order.size() > opt.window) {
+                        s.byCt.erase(s.order.front());
+                        s.order.pop_front();
+                    }
+                }
+                report.singles++;
+                report.items++;
+            } else {
+                ChameleonHash::hash_t res;
+                take(res, p, end);
+                std::vector<Authenticator::token_t> ts(frame.cnt);
+                std::vector<Authenticator::st_t> ms(frame.cnt);
+                std::vector<ChameleonHash::pk_t> pks(frame.cnt, keys[frame.signer].dpk.chpk);
+                for (size_t i = 0; i < frame.cnt; i++) {
+                    uint32_t len;
+                    take(len, p, end);
+                    if ((size_t) (end - p) < len) {
+                        throw std::runtime_error("malformed message");
+                    }
+                    ms[i].assign(p, p + len);
+                    p += len;
+                    take(ts[i], p, end);
+                }
+                ok = verifier.verifys(ts.data(), ms.data(), pks.data(), frame.cnt, res);
+                report.batches++;
+                report.items += frame.cnt;
+            }
+            (ok ? report.verified : report.invalid)++;
+            latencies.push_back(nanos(clock_t_::now()) - frame.due);
+        }
+    }
+    report.latencyCnt = latencies.size();
+    return report;
+}
+
+// A forked signer or validator and its socket to the coordinator.
+struct child_t {
+    pid_t pid;
+    int fd;
+};
+
+// Runs body in a child process that keeps only the descriptors in keep and its end of a
+// socket to the coordinator. The child waits for the start and end time, runs body and
+// sends the report and latencies.
+template <typename F>
+child_t spawn(const std::vector<int>& all, const std::vector<int>& keep, F body)
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        throw std::runtime_error(std::string("socketpair: ") + strerror(errno));
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error(std::string("fork: ") + strerror(errno));
+    }
+    if (pid > 0) {
+        close(sv[1]);
+        return child_t { pid, sv[0] };
+    }
+
+    close(sv[0]);
+    for (int fd : all) {
+        if (std::find(keep.begin(), keep.end(), fd) == keep.end()) {
+            close(fd);
+        }
+    }
+    int status = 0;
+    try {
+        char ready = 1;
+        writeAll(sv[1], &ready, 1);
+        uint64_t times[2];
+        if (!readAll(sv[1], times, sizeof times)) {
+            _exit(1);
+        }
+        std::vector<uint64_t> latencies;
+        report_t report = body(fromNanos(times[0]), fromNanos(times[1]), latencies);
+        for (int fd : keep) {
+            close(fd);
+        }
+        writeAll(sv[1], &report, sizeof report);
+        writeAll(sv[1], latencies.data(), latencies.size() * sizeof latencies[0]);
+    } catch (const std::exception& e) {
+        std::cerr << "acca_consortium: " << e.what() << std::endl;
+        status = 1;
+    }
+    _exit(status);
+}
+
+// Runs the simulation once at the given rate per signer and prints the results.
+bool simulate(const options_t& opt, const std::vector<signerKeys_t>& keys, double rate)
+{
+    // sockets[i * validators + j] connects signer i (end 0) and validator j (end 1)
+    std::vector<int> all;
+    std::vector<int> sockets[2];
+    for (size_t i = 0; i < opt.signers * opt.validators; i++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+            throw std::runtime_error(std::string("socketpair: ") + strerror(errno));
+        }
+        sockets[0].push_back(sv[0]);
+        sockets[1].push_back(sv[1]);
+        all.push_back(sv[0]);
+        all.push_back(sv[1]);
+    }
+
+    std::vector<child_t> children;
+    for (size_t i = 0; i < opt.signers; i++) {
+        std::vector<int> fds(sockets[0].begin() + i * opt.validators, sockets[0].begin() + (i + 1) * opt.validators);
+        children.push_back(spawn(all, fds, [&](clock_t_::time_point start, clock_t_::time_point end, std::vector<uint64_t>&) {
+            return runSigner(opt, rate, keys[i], i, fds, start, end);
+        }));
+        all.push_back(children.back().fd);
+    }
+    for (size_t j = 0; j < opt.validators; j++) {
+        std::vector<int> fds;
+        for (size_t i = 0; i < opt.signers; i++) {
+            fds.push_back(sockets[1][i * opt.validators + j]);
+        }
+        children.push_back(spawn(all, fds, [&](clock_t_::time_point, clock_t_::time_point, std::vector<uint64_t>& latencies) {
+            return runValidator(opt, keys, fds, latencies);
+        }));
+        all.push_back(children.back().fd);
+    }
+    for (size_t i = 0; i < sockets[0].size(); i++) {
+        close(sockets[0][i]);
+        close(sockets[1][i]);
+    }
+
+    // start once every process has built its keys
+    for (const child_t& c : children) {
+        char ready;
+        if (!readAll(c.fd, &ready, 1)) {
+            throw std::runtime_error("a child process failed to start");
+        }
+    }
+    clock_t_::time_point start = clock_t_::now() + std::chrono::milliseconds(10);
+    uint64_t times[2] = { nanos(start), nanos(start + std::chrono::duration_cast<clock_t_::duration>(std::chrono::duration<double>(opt.duration))) };
+    for (const child_t& c : children) {
+        writeAll(c.fd, times, sizeof times);
+    }
+
+    report_t sent = {}, checked = {};
+    LatencyHistogram latency;
+    bool ok = true;
+    for (size_t k = 0; k < children.size(); k++) {
+        report_t r;
+        if (!readAll(children[k].fd, &r, sizeof r)) {
+            ok = false;
+        } else {
+            std::vector<uint64_t> latencies(r.latencyCnt);
+            readAll(children[k].fd, latencies.data(), latencies.size() * sizeof latencies[0]);
+            for (uint64_t ns : latencies) {
+                latency.record(ns);
+            }
+            report_t& sum = k < opt.signers ? sent : checked;
+            sum.singles += r.singles;
+            sum.batches += r.batches;
+            sum.equivocations += r.equivocations;
+            sum.missed += r.missed;
+            sum.verified += r.verified;
+            sum.items += r.items;
+            sum.invalid += r.invalid;
+            sum.detected += r.detected;
+            sum.extractFailed += r.extractFailed;
+        }
+        close(children[k].fd);
+        int status;
+        waitpid(children[k].pid, &status, 0);
+        ok &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    double elapsed = std::chrono::duration<double>(clock_t_::now() - start).count();
+
+    double offered = opt.signers * rate;
+    // messages checked per second by each validator, on average
+    double delivered = (checked.verified + checked.invalid) / elapsed / opt.validators;
+    double items = checked.items / elapsed / opt.validators;
+    if (opt.csv) {
+        printf("%zu,%zu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%llu,%llu,%.1f,%llu\n", opt.signers, opt.validators, rate,
+               offered, delivered, items, latency.percentile(0.5) / 1e3, latency.percentile(0.99) / 1e3,
+               latency.percentile(0.999) / 1e3, latency.max() / 1e3, (unsigned long long) sent.missed,
+               (unsigned long long) sent.equivocations, (double) checked.detected / opt.validators,
+               (unsigned long long) (checked.invalid + checked.extractFailed));
+    } else {
+        printf("%10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %7llu %6llu %8.1f %7llu\n", rate, offered,
+               delivered, items, latency.percentile(0.5) / 1e3, latency.percentile(0.99) / 1e3,
+               latency.percentile(0.999) / 1e3, latency.max() / 1e3, (unsigned long long) sent.missed,
+               (unsigned long long) sent.equivocations, (double) checked.detected / opt.validators,
+               (unsigned long long) (checked.invalid + checked.extractFailed));
+    }
+    fflush(stdout);
+    return ok && checked.invalid == 0 && checked.extractFailed == 0;
+}
+
+std::vector<double> parseList(const std::string& s)
+{
+    std::vector<double> list;
+    std::istringstream items(s);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        double v = strtod(item.c_str(), nullptr);
+        if (v <= 0) {
+            throw std::invalid_argument("bad rate: " + item);
+        }
+        list.push_back(v);
+    }
+    return list;
+}
+
+bool option(const char* arg, const char* name, std::string& value)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    value = arg + len + 1;
+    return true;
+}
+
+void parse(options_t& opt, int argc, char** argv)
+{
+    std::string value;
+    for (int i = 1; i < argc; i++) {
+        if (option(argv[i], "--signers", value)) {
+            opt.signers = strtoul(value.c_str(), nullptr, 10);
+        } else if (option(argv[i], "--validators", value)) {
+            opt.validators = strtoul(value.c_str(), nullptr, 10);
+        } else if (option(argv[i], "--rate", value)) {
+            opt.rates = parseList(value);
+        } else if (option(argv[i], "--duration", value)) {
+            opt.duration = strtod(value.c_str(), nullptr);
+        } else if (option(argv[i], "--batch", value)) {
+            opt.batch = strtoul(value.c_str(), nullptr, 10);
+        } else if (option(argv[i], "--batch-fraction", value)) {
+            opt.batchFraction = strtod(value.c_str(), nullptr);
+        } else if (option(argv[i], "--equivocations", value)) {
+            opt.equivocations = strtod(value.c_str(), nullptr);
+        } else if (option(argv[i], "--window", value)) {
+            opt.window = strtoul(value.c_str(), nullptr, 10);
+        } else if (option(argv[i], "--seed", value)) {
+            opt.seed = strtoul(value.c_str(), nullptr, 10);
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            opt.csv = true;
+        } else {
+            throw std::invalid_argument(std::string("unknown argument ") + argv[i]);
+        }
+    }
+    if (opt.signers == 0 || opt.validators == 0 || opt.batch == 0 || opt.duration <= 0 || opt.rates.empty()) {
+        throw std::invalid_argument("signers, validators, batch, duration and rate must be positive");
+    }
+    if (opt.batchFraction < 0 || opt.equivocations < 0 || opt.batchFraction + opt.equivocations > 1) {
+        throw std::invalid_argument("the batch and equivocation fractions must add up to at most 1");
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    options_t opt;
+    std::vector<signerKeys_t> keys;
+    try {
+        parse(opt, argc, argv);
+        std::mt19937_64 gen(opt.seed);
+        std::uniform_int_distribution<int> byte(0, 255), n(0, 15);
+        for (size_t i = 0; i < opt.signers; i++) {
+            signerKeys_t k;
+            for (auto& c : k.dsk) {
+                c = byte(gen);
+            }
+            for (auto& c : k.w) {
+                c = byte(gen);
+            }
+            // below the group order
+            k.dsk[0] &= 0x7f;
+            k.w[0] &= 0x7f;
+            k.n = n(gen);
+            k.dpk = Authenticator(k.dsk, k.w, k.n).getDpk();
+            keys.push_back(k);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "acca_consortium: " << e.what() << std::endl;
+        return 2;
+    }
+    // a validator that exits early must not kill the signers writing to it
+    signal(SIGPIPE, SIG_IGN);
+
+    if (opt.csv) {
+        printf("signers,validators,rate,offered,delivered,items,p50_us,p99_us,p999_us,max_us,missed,equivocations,detected,failed\n");
+    } else {
+        printf("%zu signers, %zu validators, %.0f s per rate, %.0f%% batches of %zu, %.1f%% equivocations\n",
+               opt.signers, opt.validators, opt.duration, opt.batchFraction * 100, opt.batch, opt.equivocations * 100);
+        printf("%10s %10s %10s %10s %10s %10s %10s %10s %7s %6s %8s %7s\n", "rate", "offered/s", "msgs/s", "items/s",
+               "p50 us", "p99 us", "p99.9 us", "max us", "missed", "equiv", "detected", "failed");
+    }
+    bool ok = true;
+    for (double rate : opt.rates) {
+        try {
+            ok &= simulate(opt, keys, rate);
+        } catch (const std::exception& e) {
+            std::cerr << "acca_consortium: " << e.what() << std::endl;
+            return 2;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "some messages did not verify or a process failed\n");
+        return 1;
+    }
+    return 0;
+}
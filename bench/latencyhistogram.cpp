@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "latencyhistogram.h"
+
+#include <algorithm>
+
+namespace {
+
+const uint64_t SUB_BUCKETS = 1ull << LatencyHistogram::SUB_BUCKET_BITS;
+const uint64_t HALF = SUB_BUCKETS / 2;
+const uint64_t MAX_VALUE = (1ull << LatencyHistogram::MAX_BITS) - 1;
+
+}
+
+LatencyHistogram::LatencyHistogram()
+    : counts((MAX_BITS - SUB_BUCKET_BITS + 2) * HALF), count_(0), max_(0), sum(0)
+{
+}
+
+size_t LatencyHistogram::index(uint64_t ns)
+{
+    // bucket 0 holds 0 to SUB_BUCKETS - 1 exactly; bucket b > 0 holds the values with the
+    // highest set bit at SUB_BUCKET_BITS - 1 + b, in steps of 2^b
+    int msb = 63 - __builtin_clzll(ns | (SUB_BUCKETS - 1));
+    int bucket = msb - (SUB_BUCKET_BITS - 1);
+    uint64_t sub = ns >> bucket;
+    return bucket == 0 ? sub : (bucket + 1) * HALF + (sub - HALF);
+}
+
+uint64_t LatencyHistogram::value(size_t i)
+{
+    if (i < SUB_BUCKETS) {
+        return i;
+    }
+    int bucket = i / HALF - 1;
+    uint64_t sub = i % HALF + HALF;
+    return ((sub + 1) << bucket) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+    ns = std::min(ns, MAX_VALUE);
+    counts[index(ns)]++;
+    count_++;
+    max_ = std::max(max_, ns);
+    sum += ns;
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += other.counts[i];
+    }
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+    sum += other.sum;
+}
+
+void LatencyHistogram::reset()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    count_ = 0;
+    max_ = 0;
+    sum = 0;
+}
+
+double LatencyHistogram::mean() const
+{
+    return count_ ? sum / count_ : 0;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const
+{
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t) (q * count_ + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(value(i), max_);
+        }
+    }
+    return max_;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Histogram of latencies in nanoseconds in the style of HdrHistogram: log-linear buckets with
+// 1024 sub-buckets per power of two, so that every recorded value and every percentile is
+// within 0.1% of the exact one. Values from 0 to about 18 minutes (2^40 ns) are tracked;
+// larger ones are clamped.
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 11;
+    static const int MAX_BITS = 40;
+
+    LatencyHistogram();
+
+    void record(uint64_t ns);
+    // Adds the counts of other, e.g., to combine the histograms of several threads.
+    void add(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const {
+        return count_;
+    }
+    uint64_t max() const {
+        return max_;
+    }
+    double mean() const;
+    // The smallest value that at least q (between 0 and 1) of the recorded values do not exceed.
+    uint64_t percentile(double q) const;
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t count_;
+    uint64_t max_;
+    double sum;
+
+    static size_t index(uint64_t ns);
+    // highest value that maps to index i
+    static uint64_t value(size_t i);
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Open-loop load generator. Requests of one operation (authenticate, verify, or verifys of
+// --batch items) arrive as a Poisson process at --rate requests per second, split evenly
+// across the threads. The latency of a request is measured from its scheduled arrival, not
+// from when a thread got to it, so queueing behind slow requests is counted instead of
+// hidden (no coordinated omission). Requests still waiting at the end of the run are
+// reported as missed.
+//
+// The requests are drawn from a corpus of (ct, st, n), either synthetic or read from a file
+// with one request per line: ct in hex (CT_LEN bytes), n, and st in hex; '#' starts a comment.
+// n selects the signer key, and every thread holds a signer and a verifier for each n.
+// For every thread count in --threads, prints the achieved throughput and latency percentiles.
+//
+// usage: acca_loadgen [--op=authenticate|verify|verifys] [--rate=<req/s>] [--duration=<s>]
+//                     [--threads=1,2,4] [--batch=<items>] [--corpus=<file>] [--seed=<n>] [--csv]
+
+#include "../authenticator.h"
+#include "latencyhistogram.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const ChameleonHash::sk_t SK = {{
+    0xb2, 0x19, 0x77, 0xc8, 0xca, 0x1c, 0xbb, 0x55, 0xf0, 0xa3, 0xef, 0xfd, 0x99, 0x66, 0xe3, 0xd5,
+    0xc9, 0x58, 0x86, 0x88, 0xfa, 0x02, 0xbf, 0x7a, 0x0d, 0x2a, 0xf7, 0xb6, 0x36, 0x6f, 0x1e, 0x8f
+}};
+const ChameleonHash::W W = SK;
+const size_t SYNTHETIC_LEN = 256;
+const int MAX_N = 16;
+
+typedef std::chrono::steady_clock clock_t_;
+
+enum Op { AUTHENTICATE, VERIFY, VERIFYS };
+
+struct request_t {
+    Authenticator::ct_t ct;
+    Authenticator::st_t st;
+    int n;
+};
+
+struct options_t {
+    Op op = VERIFY;
+    double rate = 100;
+    double duration = 10;
+    std::vector<size_t> threads = { 1 };
+    size_t batch = 16;
+    std::string corpus;
+    unsigned seed = 1;
+    bool csv = false;
+};
+
+// Requests of the chosen operation, prepared before the run. For verify, token i belongs to
+// corpus entry i. For verifys, group g holds the batch items starting at g * batch, which
+// share the context of the first of them.
+struct workload_t {
+    std::vector<request_t> corpus;
+    std::vector<Authenticator::token_t> tokens;
+    std::vector<Authenticator::st_t> ms;
+    std::vector<ChameleonHash::pk_t> pks;
+    std::vector<ChameleonHash::hash_t> res;
+    size_t requests;
+};
+
+struct result_t {
+    LatencyHistogram latency;
+    uint64_t completed = 0;
+    uint64_t missed = 0;
+    bool ok = true;
+};
+
+void fromHex(std::vector<unsigned char>& out, const std::string& hex)
+{
+    if (hex.size() % 2 != 0) {
+        throw std::invalid_argument("odd number of hex digits: " + hex);
+    }
+    out.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        char* end;
+        std::string byte = hex.substr(i, 2);
+        out.push_back((unsigned char) strtoul(byte.c_str(), &end, 16));
+        if (*end) {
+            throw std::invalid_argument("not hex: " + hex);
+        }
+    }
+}
+
+std::vector<request_t> readCorpus(const std::string& path)
+{
+    std::ifstream f(path);
+    if (!f) {
+        throw std::runtime_error("cannot read " + path);
+    }
+    std::vector<request_t> corpus;
+    std::string line;
+    while (std::getline(f, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string ct, st;
+        request_t req;
+        if (!(fields >> ct)) {
+            continue;
+        }
+        std::vector<unsigned char> bytes;
+        fromHex(bytes, ct);
+        if (bytes.size() != Authenticator::CT_LEN || !(fields >> req.n) || req.n < 0) {
+            throw std::invalid_argument("bad corpus line: " + line);
+        }
+        std::copy(bytes.begin(), bytes.end(), req.ct.begin());
+        if (fields >> st) {
+            fromHex(req.st, st);
+        }
+        corpus.push_back(req);
+    }
+    if (corpus.empty()) {
+        throw std::runtime_error(path + " holds no requests");
+    }
+    return corpus;
+}
+
+std::vector<request_t> syntheticCorpus(std::mt19937_64& gen)
+{
+    std::uniform_int_distribution<int> byte(0, 255), len(0, 64), n(0, MAX_N);
+    std::vector<request_t> corpus(SYNTHETIC_LEN);
+    for (auto& req : corpus) {
+        for (auto& c : req.ct) {
+            c = byte(gen);
+        }
+        req.st.resize(len(gen));
+        for (auto& c : req.st) {
+            c = byte(gen);
+        }
+        req.n = n(gen);
+    }
+    return corpus;
+}
+
+// signer and verifier for key n
+struct keys_t {
+    Authenticator signer;
+    Authenticator verifier;
+    explicit keys_t(int n) : signer(SK, W, n), verifier(signer.getDpk(), W) {}
+};
+
+typedef std::map<int, std::unique_ptr<keys_t>> keyring_t;
+
+void makeKeys(keyring_t& keys, const std::vector<request_t>& corpus)
+{
+    for (const auto& req : corpus) {
+        if (!keys[req.n]) {
+            keys[req.n].reset(new keys_t(req.n));
+        }
+    }
+}
+
+void prepare(workload_t& w, const options_t& opt)
+{
+    Authenticator acca(SK, W, 0);
+    if (opt.op == VERIFY) {
+        keyring_t keys;
+        makeKeys(keys, w.corpus);
+        w.tokens.resize(w.corpus.size());
+        for (size_t i = 0; i < w.corpus.size(); i++) {
+            keys[w.corpus[i].n]->signer.authenticate(w.tokens[i], w.corpus[i].ct, w.corpus[i].st, w.corpus[i].n);
+        }
+        w.requests = w.corpus.size();
+    } else if (opt.op == VERIFYS) {
+        size_t groups = std::max<size_t>(1, w.corpus.size() / opt.batch);
+        w.tokens.resize(groups * opt.batch);
+        w.ms.resize(groups * opt.batch);
+        w.pks.resize(groups * opt.batch);
+        w.res.resize(groups);
+        std::vector<int> n(opt.batch);
+        for (size_t g = 0; g < groups; g++) {
+            for (size_t j = 0; j < opt.batch; j++) {
+                const request_t& req = w.corpus[(g * opt.batch + j) % w.corpus.size()];
+                w.ms[g * opt.batch + j] = req.st;
+                n[j] = req.n;
+                w.pks[g * opt.batch + j] = ChameleonHash(SK, W, req.n).getPk(true);
+            }
+            const Authenticator::ct_t& ct = w.corpus[(g * opt.batch) % w.corpus.size()].ct;
+            acca.authenticates(&w.tokens[g * opt.batch], &w.ms[g * opt.batch], n.data(), opt.batch, ct, w.res[g]);
+        }
+        w.requests = groups;
+    } else {
+        w.requests = w.corpus.size();
+    }
+}
+
+// One thread of the run: issues the requests of a Poisson process with the given rate from
+// start until end. The times are known once all threads have set up their keys.
+void worker(result_t& result, const workload_t& w, const options_t& opt, double rate, unsigned seed,
+            std::atomic<size_t>& ready, std::shared_future<std::pair<clock_t_::time_point, clock_t_::time_point>> times)
+{
+    keyring_t keys;
+    makeKeys(keys, w.corpus);
+    Authenticator& verifier = keys.begin()->second->verifier;
+    Authenticator::token_t t;
+    ready++;
+    clock_t_::time_point start = times.get().first, end = times.get().second;
+    std::mt19937_64 gen(seed);
+    std::exponential_distribution<double> gap(rate);
+    std::uniform_int_distribution<size_t> pick(0, w.requests - 1);
+
+    clock_t_::time_point next = start;
+    for (;;) {
+        next += std::chrono::duration_cast<clock_t_::duration>(std::chrono::duration<double>(gap(gen)));
+        if (next >= end) {
+            break;
+        }
+        clock_t_::time_point now = clock_t_::now();
+        if (now >= end) {
+            // scheduled, but never started: count this one and the rest of the schedule
+            for (; next < end; next += std::chrono::duration_cast<clock_t_::duration>(std::chrono::duration<double>(gap(gen)))) {
+                result.missed++;
+            }
+            break;
+        }
+        if (now < next) {
+            std::this_thread::sleep_until(next);
+        }
+
+        size_t i = pick(gen);
+        switch (opt.op) {
+        case AUTHENTICATE:
+            keys[w.corpus[i].n]->signer.authenticate(t, w.corpus[i].ct, w.corpus[i].st, w.corpus[i].n);
+            break;
+        case VERIFY:
+            result.ok &= keys[w.corpus[i].n]->verifier.verify(w.tokens[i], w.corpus[i].ct, w.corpus[i].st, w.corpus[i].n);
+            break;
+        case VERIFYS:
+            // the public keys of the items are part of the request, so any verifier will do
+            result.ok &= verifier.verifys(&w.tokens[i * opt.batch], &w.ms[i * opt.batch], &w.pks[i * opt.batch], opt.batch, w.res[i]);
+            break;
+        }
+        result.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t_::now() - next).count());
+        result.completed++;
+    }
+}
+
+std::vector<size_t> parseList(const std::string& s)
+{
+    std::vector<size_t> list;
+    std::istringstream items(s);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t v = strtoul(item.c_str(), nullptr, 10);
+        if (v == 0) {
+            throw std::invalid_argument("bad thread count: " + item);
+        }
+        list.push_back(v);
+    }
+    return list;
+}
+
+bool option(const char* arg, const char* name, std::string& value)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    value = arg + len + 1;
+    return true;
+}
+
+void parse(options_t& opt, int argc, char** argv)
+{
+    std::string value;
+    for (int i = 1; i < argc; i++) {
+        if (option(argv[i], "--op", value)) {
+            if (value == "authenticate") {
+                opt.op = AUTHENTICATE;
+            } else if (value == "verify") {
+                opt.op = VERIFY;
+            } else if (value == "verifys") {
+                opt.op = VERIFYS;
+            } else {
+                throw std::invalid_argument("unknown operation " + value);
+            }
+        } else if (option(argv[i], "--rate", value)) {
+            opt.rate = strtod(value.c_str(), nullptr);
+        } else if (option(argv[i], "--duration", value)) {
+            opt.duration = strtod(value.c_str(), nullptr);
+        } else if (option(argv[i], "--threads", value)) {
+            opt.threads = parseList(value);
+        } else if (option(argv[i], "--batch", value)) {
+            opt.batch = std::max<size_t>(1, strtoul(value.c_str(), nullptr, 10));
+        } else if (option(argv[i], "--seed", value)) {
+            opt.seed = strtoul(value.c_str(), nullptr, 10);
+        } else if (option(argv[i], "--corpus", value)) {
+            opt.corpus = value;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            opt.csv = true;
+        } else {
+            throw std::invalid_argument(std::string("unknown argument ") + argv[i]);
+        }
+    }
+    if (opt.rate <= 0 || opt.duration <= 0 || opt.threads.empty()) {
+        throw std::invalid_argument("rate, duration and threads must be positive");
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    options_t opt;
+    workload_t w;
+    try {
+        parse(opt, argc, argv);
+        std::mt19937_64 gen(opt.seed);
+        w.corpus = opt.corpus.empty() ? syntheticCorpus(gen) : readCorpus(opt.corpus);
+        prepare(w, opt);
+    } catch (const std::exception& e) {
+        std::cerr << "acca_loadgen: " << e.what() << std::endl;
+        return 2;
+    }
+
+    const char* opName[] = { "authenticate", "verify", "verifys" };
+    if (opt.csv) {
+        printf("op,threads,target_rps,achieved_rps,completed,missed,p50_us,p90_us,p99_us,p999_us,max_us\n");
+    } else {
+        printf("%s, %zu requests in the corpus, %.0f req/s for %.0f s%s\n", opName[opt.op], w.corpus.size(),
+               opt.rate, opt.duration, opt.op == VERIFYS ? (", " + std::to_string(opt.batch) + " items per request").c_str() : "");
+        printf("%8s %12s %10s %8s %10s %10s %10s %10s %10s\n", "threads", "achieved/s", "completed", "missed",
+               "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+    }
+
+    bool ok = true;
+    for (size_t threads : opt.threads) {
+        std::vector<result_t> results(threads);
+        std::vector<std::thread> pool;
+        std::atomic<size_t> ready(0);
+        std::promise<std::pair<clock_t_::time_point, clock_t_::time_point>> times;
+        std::shared_future<std::pair<clock_t_::time_point, clock_t_::time_point>> timesFuture = times.get_future().share();
+        for (size_t i = 0; i < threads; i++) {
+            pool.emplace_back(worker, std::ref(results[i]), std::cref(w), std::cref(opt), opt.rate / threads,
+                              opt.seed + 1 + i, std::ref(ready), timesFuture);
+        }
+        while (ready < threads) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        clock_t_::time_point start = clock_t_::now() + std::chrono::milliseconds(10);
+        clock_t_::time_point end = start + std::chrono::duration_cast<clock_t_::duration>(std::chrono::duration<double>(opt.duration));
+        times.set_value(std::make_pair(start, end));
+        for (auto& t : pool) {
+            t.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::max(end, clock_t_::now()) - start).count();
+
+        result_t total;
+        for (const auto& r : results) {
+            total.latency.add(r.latency);
+            total.completed += r.completed;
+            total.missed += r.missed;
+            ok &= r.ok;
+        }
+        const LatencyHistogram& h = total.latency;
+        if (opt.csv) {
+            printf("%s,%zu,%.1f,%.1f,%llu,%llu,%.1f,%.1f,%.1f,%.1f,%.1f\n", opName[opt.op], threads, opt.rate,
+                   total.completed / elapsed, (unsigned long long) total.completed, (unsigned long long) total.missed,
+                   h.percentile(0.5) / 1e3, h.percentile(0.9) / 1e3, h.percentile(0.99) / 1e3,
+                   h.percentile(0.999) / 1e3, h.max() / 1e3);
+        } else {
+            printf("%8zu %12.1f %10llu %8llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", threads, total.completed / elapsed,
+                   (unsigned long long) total.completed, (unsigned long long) total.missed,
+                   h.percentile(0.5) / 1e3, h.percentile(0.9) / 1e3, h.percentile(0.99) / 1e3,
+                   h.percentile(0.999) / 1e3, h.max() / 1e3);
+        }
+        fflush(stdout);
+    }
+    if (!ok) {
+        fprintf(stderr, "verification failed\n");
+        return 1;
+    }
+    return 0;
+}
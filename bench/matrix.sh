@@ -0,0 +1,33 @@
+#!/bin/sh
+# Builds acca_throughput for every combination of libsecp256k1 backend and table sizes and
+# prints one CSV row per configuration.
+#
+# usage: bench/matrix.sh [build directory] [iterations]
+#
+# The combinations can be narrowed down with the environment variables WIDEMUL, WINDOWS and
+# GEN_PREC_BITS, e.g., WINDOWS="15 18" GEN_PREC_BITS=8 bench/matrix.sh.
+
+set -e
+
+SRC=$(cd "$(dirname "$0")/.." && pwd)
+OUT=${1:-"$SRC/build-matrix"}
+ITERATIONS=${2:-2000}
+WIDEMUL=${WIDEMUL:-"int128:x86_64 int128:no int64:no"}
+WINDOWS=${WINDOWS:-"4 8 15 18"}
+GEN_PREC_BITS=${GEN_PREC_BITS:-"2 4 8"}
+
+echo "widemul,window,gen_prec_bits,ch_sk_per_s,ch_pk_per_s,authenticate_per_s,verify_per_s,verify_batch_per_s"
+for backend in $WIDEMUL; do
+    widemul=${backend%:*}
+    asm=${backend#*:}
+    for window in $WINDOWS; do
+        for bits in $GEN_PREC_BITS; do
+            dir="$OUT/$widemul-$asm-w$window-g$bits"
+            cmake -S "$SRC" -B "$dir" -DCMAKE_BUILD_TYPE=release \
+                -DACCA_SECP256K1_WIDEMUL="$widemul" -DACCA_SECP256K1_ASM="$asm" \
+                -DACCA_ECMULT_WINDOW_SIZE="$window" -DACCA_ECMULT_GEN_PREC_BITS="$bits" >/dev/null
+            cmake --build "$dir" --target acca_throughput >/dev/null
+            "$dir/acca_throughput" "$ITERATIONS" --csv
+        done
+    done
+done
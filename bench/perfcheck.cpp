@@ -0,0 +1,530 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Performance regression check. Runs acca_bench several times, writes the ns/op of every case
+// and run to a JSON file together with the git revision and the CPU model, and, given a
+// baseline file from an earlier run, compares the two with a Mann-Whitney U test. A case is
+// flagged if the difference is significant at level --alpha and its median changed by more
+// than --threshold percent. The exit status is 1 if a case got slower, so the check can gate
+// changes such as updates of the vendored libsecp256k1.
+//
+// By default, only the hot paths of ChameleonHash and Authenticator run, on one thread. With
+// an alpha of 0.05, at least 4 runs are needed for any difference to be significant.
+//
+// usage: acca_perfcheck [--runs=<n>] [--baseline=<file>] [--out=<file>] [--threshold=<percent>]
+//                       [--alpha=<p>] [--filter=<regex>] [--bench=<acca_bench>] [-- <acca_bench flags>]
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define ACCA_STR_(x) #x
+#define ACCA_STR(x) ACCA_STR_(x)
+
+namespace {
+
+const char* const DEFAULT_FILTER =
+    "^BM_(ChSk|ChPk|ChPkBatch/64|MergeV/64|Extract"
+    "|Authenticate<" ACCA_STR(ACCA_CT_LEN) ">|Verify<" ACCA_STR(ACCA_CT_LEN) ">"
+    "|Authenticates<" ACCA_STR(ACCA_CT_LEN) ">/64|VerifyBatch<" ACCA_STR(ACCA_CT_LEN) ">/64)"
+    "/real_time/threads:1$";
+
+// ns/op of every run, by case name
+typedef std::map<std::string, std::vector<double>> samples_t;
+
+struct results_t {
+    std::string revision;
+    std::string cpu;
+    samples_t samples;
+};
+
+// A minimal JSON reader, enough for the output of Google Benchmark and our own files.
+struct Json {
+    enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+    Type type = NUL;
+    double number = 0;
+    std::string string;
+    std::vector<Json> array;
+    std::vector<std::pair<std::string, Json>> object;
+
+    const Json* get(const std::string& key) const {
+        for (const auto& member : object) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser
+{
+public:
+    explicit JsonParser(const std::string& in) : in(in), pos(0) {}
+
+    Json parse() {
+        Json v = value();
+        skipSpace();
+        if (pos != in.size()) {
+            fail("trailing characters");
+        }
+        return v;
+    }
+
+private:
+    const std::string& in;
+    size_t pos;
+
+    void fail(const char* what) {
+        throw std::runtime_error(std::string("invalid JSON: ") + what + " at offset " + std::to_string(pos));
+    }
+
+    void skipSpace() {
+        while (pos < in.size() && isspace((unsigned char) in[pos])) {
+            pos++;
+        }
+    }
+
+    bool consume(const char* token) {
+        size_t len = strlen(token);
+        if (in.compare(pos, len, token) != 0) {
+            return false;
+        }
+        pos += len;
+        return true;
+    }
+
+    void expect(char c) {
+        skipSpace();
+        if (pos >= in.size() || in[pos] != c) {
+            fail("unexpected character");
+        }
+        pos++;
+    }
+
+    std::string str() {
+        expect('"');
+        std::string s;
+        while (pos < in.size() && in[pos] != '"') {
+            char c = in[pos++];
+            if (c == '\\') {
+                if (pos >= in.size()) {
+                    fail("unterminated escape");
+                }
+                c = in[pos++];
+                switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u':
+                    // only used for control characters in the files we read
+                    if (pos + 4 > in.size()) {
+                        fail("unterminated escape");
+                    }
+                    c = (char) strtol(in.substr(pos, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                    break;
+                }
+            }
+            s += c;
+        }
+        expect('"');
+        return s;
+    }
+
+    Json value() {
+        Json v;
+        skipSpace();
+        if (pos >= in.size()) {
+            fail("unexpected end");
+        }
+        char c = in[pos];
+        if (c == '{') {
+            v.type = Json::OBJECT;
+            pos++;
+            skipSpace();
+            if (consume("}")) {
+                return v;
+            }
+            do {
+                skipSpace();
+                std::string key = str();
+                expect(':');
+                v.object.push_back(std::make_pair(key, value()));
+                skipSpace();
+            } while (consume(","));
+            expect('}');
+        } else if (c == '[') {
+            v.type = Json::ARRAY;
+            pos++;
+            skipSpace();
+            if (consume("]")) {
+                return v;
+            }
+            do {
+                v.array.push_back(value());
+                skipSpace();
+            } while (consume(","));
+            expect(']');
+        } else if (c == '"') {
+            v.type = Json::STRING;
+            v.string = str();
+        } else if (consume("true")) {
+            v.type = Json::BOOL;
+            v.number = 1;
+        } else if (consume("false")) {
+            v.type = Json::BOOL;
+        } else if (consume("null")) {
+            v.type = Json::NUL;
+        } else {
+            char* end;
+            v.type = Json::NUMBER;
+            v.number = strtod(in.c_str() + pos, &end);
+            if (end == in.c_str() + pos) {
+                fail("unexpected character");
+            }
+            pos = end - in.c_str();
+        }
+        return v;
+    }
+};
+
+std::string escape(const std::string& s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        if ((unsigned char) c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string shellQuote(const std::string& s)
+{
+    std::string out = "'";
+    for (char c : s) {
+        out += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return out + "'";
+}
+
+std::string readCommand(const std::string& cmd)
+{
+    FILE* f = popen(cmd.c_str(), "r");
+    if (!f) {
+        throw std::runtime_error("cannot run " + cmd);
+    }
+    std::string out;
+    char buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof buf, f)) > 0) {
+        out.append(buf, len);
+    }
+    if (pclose(f) != 0) {
+        throw std::runtime_error("failed: " + cmd);
+    }
+    return out;
+}
+
+std::string revision()
+{
+    try {
+        std::string rev = readCommand("git -C " + shellQuote(ACCA_SOURCE_DIR) + " describe --always --dirty --abbrev=12 2>/dev/null");
+        rev.erase(rev.find_last_not_of("\n") + 1);
+        return rev;
+    } catch (const std::runtime_error&) {
+        return "unknown";
+    }
+}
+
+std::string cpuModel()
+{
+    std::ifstream f("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                return line.substr(line.find_first_not_of(" \t", colon + 1));
+            }
+        }
+    }
+    return "unknown";
+}
+
+// Adds the ns/op of every case in the JSON output of one acca_bench run.
+void addRun(samples_t& samples, const std::string& out)
+{
+    Json root = JsonParser(out).parse();
+    const Json* benchmarks = root.get("benchmarks");
+    if (!benchmarks || benchmarks->type != Json::ARRAY) {
+        throw std::runtime_error("no benchmarks in the output of acca_bench");
+    }
+    for (const Json& b : benchmarks->array) {
+        const Json* name = b.get("name");
+        const Json* runType = b.get("run_type");
+        const Json* nsPerOp = b.get("ns/op");
+        if (name && nsPerOp && (!runType || runType->string == "iteration")) {
+            samples[name->string].push_back(nsPerOp->number);
+        }
+    }
+}
+
+void write(const results_t& results, const std::string& path)
+{
+    std::ofstream f(path);
+    f.precision(17);
+    f << "{\n";
+    f << "  \"revision\": \"" << escape(results.revision) << "\",\n";
+    f << "  \"cpu\": \"" << escape(results.cpu) << "\",\n";
+    f << "  \"unit\": \"ns/op\",\n";
+    f << "  \"benchmarks\": {";
+    const char* sep = "\n";
+    for (const auto& s : results.samples) {
+        f << sep << "    \"" << escape(s.first) << "\": [";
+        for (size_t i = 0; i < s.second.size(); i++) {
+            f << (i ? ", " : "") << s.second[i];
+        }
+        f << "]";
+        sep = ",\n";
+    }
+    f << "\n  }\n}\n";
+    if (!f) {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+results_t read(const std::string& path)
+{
+    std::ifstream f(path);
+    if (!f) {
+        throw std::runtime_error("cannot read " + path);
+    }
+    std::stringstream ss;
+    ss << f.rdbuf();
+    Json root = JsonParser(ss.str()).parse();
+    const Json* revision = root.get("revision");
+    const Json* cpu = root.get("cpu");
+    const Json* benchmarks = root.get("benchmarks");
+    if (!revision || !cpu || !benchmarks || benchmarks->type != Json::OBJECT) {
+        throw std::runtime_error(path + " is not an acca_perfcheck file");
+    }
+    results_t results;
+    results.revision = revision->string;
+    results.cpu = cpu->string;
+    for (const auto& b : benchmarks->object) {
+        for (const Json& v : b.second.array) {
+            results.samples[b.first].push_back(v.number);
+        }
+    }
+    return results;
+}
+
+double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// Two-sided p-value of the Mann-Whitney U test. Exact for small samples without ties,
+// otherwise from the normal approximation with tie and continuity correction.
+double mannWhitney(const std::vector<double>& a, const std::vector<double>& b)
+{
+    size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    std::vector<std::pair<double, int>> all;
+    for (double x : a) {
+        all.push_back(std::make_pair(x, 0));
+    }
+    for (double x : b) {
+        all.push_back(std::make_pair(x, 1));
+    }
+    std::sort(all.begin(), all.end());
+
+    // rank sum of a, with average ranks for ties
+    double r1 = 0, ties = 0;
+    for (size_t i = 0; i < n; ) {
+        size_t j = i;
+        while (j < n && all[j].first == all[i].first) {
+            j++;
+        }
+        double t = j - i;
+        ties += t * t * t - t;
+        for (size_t k = i; k < j; k++) {
+            if (all[k].second == 0) {
+                r1 += (i + j + 1) / 2.0;
+            }
+        }
+        i = j;
+    }
+    double u = r1 - n1 * (n1 + 1) / 2.0;
+
+    if (ties == 0 && n <= 40) {
+        // cnt[i][j][k]: orderings of i values of a and j values of b with U = k
+        size_t maxU = n1 * n2;
+        std::vector<std::vector<std::vector<double>>> cnt(n1 + 1, std::vector<std::vector<double>>(n2 + 1, std::vector<double>(maxU + 1)));
+        for (size_t i = 0; i <= n1; i++) {
+            for (size_t j = 0; j <= n2; j++) {
+                for (size_t k = 0; k <= maxU; k++) {
+                    if (i == 0 || j == 0) {
+                        cnt[i][j][k] = k == 0;
+                    } else {
+                        // the largest value is from a (beats j values of b) or from b
+                        cnt[i][j][k] = (k >= j ? cnt[i - 1][j][k - j] : 0) + cnt[i][j - 1][k];
+                    }
+                }
+            }
+        }
+        double total = 0, le = 0, ge = 0;
+        for (size_t k = 0; k <= maxU; k++) {
+            total += cnt[n1][n2][k];
+            le += k <= u ? cnt[n1][n2][k] : 0;
+            ge += k >= u ? cnt[n1][n2][k] : 0;
+        }
+        return std::min(1.0, 2 * std::min(le, ge) / total);
+    }
+
+    double mean = n1 * n2 / 2.0;
+    double var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1.0)));
+    if (var <= 0) {
+        return 1;
+    }
+    double z = (std::fabs(u - mean) - 0.5) / std::sqrt(var);
+    return std::min(1.0, std::erfc(std::max(z, 0.0) / std::sqrt(2.0)));
+}
+
+// Prints the comparison and returns the number of significant slowdowns.
+size_t compare(const results_t& base, const results_t& cur, double threshold, double alpha)
+{
+    if (base.cpu != cur.cpu) {
+        std::cerr << "warning: the baseline is from a different CPU (" << base.cpu << ")" << std::endl;
+    }
+    printf("%s -> %s\n", base.revision.c_str(), cur.revision.c_str());
+    printf("%-48s %14s %14s %9s %8s\n", "case", "base ns/op", "ns/op", "change", "p");
+    size_t slower = 0;
+    for (const auto& s : cur.samples) {
+        auto b = base.samples.find(s.first);
+        if (b == base.samples.end() || b->second.empty() || s.second.empty()) {
+            printf("%-48s %14s %14.0f\n", s.first.c_str(), "-", median(s.second));
+            continue;
+        }
+        double m0 = median(b->second), m1 = median(s.second);
+        double change = (m1 / m0 - 1) * 100;
+        double p = mannWhitney(b->second, s.second);
+        const char* flag = "";
+        if (p < alpha && std::fabs(change) > threshold) {
+            flag = change > 0 ? "  SLOWER" : "  faster";
+            slower += change > 0;
+        }
+        printf("%-48s %14.0f %14.0f %+8.1f%% %8.4f%s\n", s.first.c_str(), m0, m1, change, p, flag);
+    }
+    return slower;
+}
+
+bool option(const char* arg, const char* name, std::string& value)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    value = arg + len + 1;
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t runs = 5;
+    double threshold = 5, alpha = 0.05;
+    std::string bench = ACCA_BENCH_PATH, filter = DEFAULT_FILTER, baseline, out, extra, value;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            for (i++; i < argc; i++) {
+                extra += " " + shellQuote(argv[i]);
+            }
+        } else if (option(argv[i], "--runs", value)) {
+            runs = std::max<size_t>(1, strtoul(value.c_str(), nullptr, 10));
+        } else if (option(argv[i], "--threshold", value)) {
+            threshold = strtod(value.c_str(), nullptr);
+        } else if (option(argv[i], "--alpha", value)) {
+            alpha = strtod(value.c_str(), nullptr);
+        } else if (!option(argv[i], "--baseline", baseline) && !option(argv[i], "--out", out)
+                   && !option(argv[i], "--filter", filter) && !option(argv[i], "--bench", bench)) {
+            std::cerr << "unknown argument " << argv[i] << std::endl;
+            return 2;
+        }
+    }
+
+    try {
+        results_t results;
+        results.revision = revision();
+        results.cpu = cpuModel();
+        std::string cmd = shellQuote(bench) + " --benchmark_format=json --benchmark_filter=" + shellQuote(filter) + extra;
+        for (size_t i = 0; i < runs; i++) {
+            std::cerr << "run " << i + 1 << "/" << runs << std::endl;
+            addRun(results.samples, readCommand(cmd));
+        }
+        if (results.samples.empty()) {
+            throw std::runtime_error("no case matches " + filter);
+        }
+
+        if (out.empty()) {
+            std::string cpu = results.cpu;
+            std::replace_if(cpu.begin(), cpu.end(), [](char c) { return !isalnum((unsigned char) c); }, '_');
+            out = "perfcheck-" + results.revision + "-" + cpu + ".json";
+        }
+        write(results, out);
+        std::cerr << "wrote " << out << std::endl;
+
+        if (!baseline.empty()) {
+            return compare(read(baseline), results, threshold, alpha) ? 1 : 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "acca_perfcheck: " << e.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "perfcounters.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool enabled_ = false;
+const char* error_ = nullptr;
+
+#if defined(__linux__)
+
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+const uint64_t CACHE_READ_MISS = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+const EventConfig EVENTS[PerfCounters::EVENT_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | CACHE_READ_MISS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | CACHE_READ_MISS }
+};
+
+int open(const EventConfig& event)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#endif
+
+}
+
+PerfCounters::PerfCounters()
+{
+    bool any = false;
+    int err = 0;
+    for (size_t i = 0; i < EVENT_COUNT; i++) {
+        fds[i] = -1;
+#if defined(__linux__)
+        if (enabled_) {
+            fds[i] = open(EVENTS[i]);
+            if (fds[i] < 0) {
+                err = errno;
+            }
+            any |= fds[i] >= 0;
+        }
+#endif
+    }
+#if defined(__linux__)
+    if (enabled_ && !any && !error_) {
+        error_ = strerror(err);
+    }
+#else
+    (void) any;
+    (void) err;
+    if (enabled_) {
+        error_ = "perf events are only supported on Linux";
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+    for (size_t i = 0; i < EVENT_COUNT; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::read(Event event, uint64_t& value) const
+{
+#if defined(__linux__)
+    uint64_t v[3];
+    if (fds[event] < 0 || ::read(fds[event], v, sizeof v) != sizeof v || v[2] == 0) {
+        return false;
+    }
+    // v = { count, time enabled, time running }
+    value = v[2] < v[1] ? (uint64_t) ((double) v[0] * v[1] / v[2]) : v[0];
+    return true;
+#else
+    (void) event;
+    (void) value;
+    return false;
+#endif
+}
+
+const char* PerfCounters::name(Event event)
+{
+    static const char* const NAMES[EVENT_COUNT] = {
+        "cycles", "instructions", "L1d_misses", "LLC_misses", "dTLB_misses"
+    };
+    return NAMES[event];
+}
+
+void PerfCounters::setEnabled(bool enable)
+{
+    enabled_ = enable;
+}
+
+bool PerfCounters::enabled()
+{
+    return enabled_;
+}
+
+const char* PerfCounters::error()
+{
+    return error_;
+}
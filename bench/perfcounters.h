@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <stdint.h>
+
+// Hardware event counts of the calling thread from perf_event_open, user space only. Counting
+// starts on construction and is disabled by default. Events that the CPU, the kernel or the
+// container do not allow are reported as unavailable instead of failing.
+class PerfCounters
+{
+public:
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        LLC_MISSES,
+        DTLB_MISSES,
+        EVENT_COUNT
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    // Counts since construction, scaled if the kernel multiplexed the counter. Returns false
+    // if the event is not available.
+    bool read(Event event, uint64_t& value) const;
+
+    static const char* name(Event event);
+
+    static void setEnabled(bool enable);
+    static bool enabled();
+    // The reason no event could be opened, or nullptr.
+    static const char* error();
+
+private:
+    int fds[EVENT_COUNT];
+
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator=(const PerfCounters&);
+};
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Measures the plan for this machine (see planner.h) and saves it, for programs to load with
+// Plan::load or through the ACCA_PLAN environment variable:
+//
+//   $ ./acca_plan --out=acca.plan
+//   $ ACCA_PLAN=acca.plan ./acca_throughput
+//
+// --min-time is the time per candidate in seconds; the whole measurement takes about 40
+// times as long. Without --out, the plan is printed.
+//
+// usage: acca_plan [--out=<file>] [--min-time=<seconds>] [--quiet]
+
+#include "../planner.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    std::string out;
+    double minTime = 0.2;
+    bool quiet = false;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--out=", 6) == 0) {
+            out = argv[i] + 6;
+        }
+        else if (strncmp(argv[i], "--min-time=", 11) == 0) {
+            minTime = atof(argv[i] + 11);
+        }
+        else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        }
+        else {
+            fprintf(stderr, "usage: acca_plan [--out=<file>] [--min-time=<seconds>] [--quiet]\n");
+            return 2;
+        }
+    }
+
+    try {
+        Plan plan = Planner::measure(minTime, quiet ? nullptr : &std::cerr);
+        if (out.empty()) {
+            out = "/dev/stdout";
+        }
+        plan.save(out);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "acca_plan: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Throughput of the SHA-256 paths on inputs shaped like those of the authenticator:
+// 66-byte digest(h1, h2) inputs and 65-byte randomOracle inputs after the HMAC ipad block.
+//
+// usage: sha256bench [iterations]
+
+#include "../chameleonhash.h"
+#include "../sha256.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const size_t MSG_LEN = 2 * ChameleonHash::HASH_LEN;
+
+template <typename F>
+double nsPerHash(size_t hashes, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / hashes;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    unsigned char msg[MSG_LEN] = { 1 };
+    Sha256::out_t out;
+
+    // chain the outputs so that the compiler cannot drop any of the work
+    double secp = nsPerHash(iterations, [&]() {
+        for (size_t i = 0; i < iterations; i++) {
+            secp256k1_sha256_t sha;
+            secp256k1_sha256_initialize(&sha);
+            secp256k1_sha256_write(&sha, msg, sizeof msg);
+            secp256k1_sha256_finalize(&sha, msg);
+        }
+    });
+    printf("%-28s %8.1f ns/hash\n", "secp256k1_sha256", secp);
+
+    const bool shaNi = Sha256::shaNi();
+    for (bool enable : { false, true }) {
+        if (!Sha256::setShaNi(enable)) {
+            printf("%-28s not supported by this CPU\n", "Sha256::hash (sha-ni)");
+            continue;
+        }
+        double ns = nsPerHash(iterations, [&]() {
+            for (size_t i = 0; i < iterations; i++) {
+                Sha256::hash(out, msg, sizeof msg);
+                msg[0] = out[0];
+            }
+        });
+        printf("%-28s %8.1f ns/hash  %5.2fx\n", enable ? "Sha256::hash (sha-ni)" : "Sha256::hash (portable)", ns, secp / ns);
+    }
+    Sha256::setShaNi(shaNi);
+
+    const size_t CNT = 64;
+    std::vector<unsigned char> msgs(CNT * MSG_LEN, 2);
+    std::vector<const unsigned char*> in(CNT);
+    std::vector<size_t> len(CNT, MSG_LEN);
+    std::vector<Sha256::out_t> outs(CNT);
+    for (size_t i = 0; i < CNT; i++) {
+        in[i] = &msgs[i * MSG_LEN];
+    }
+
+    const Sha256::Backend backend = Sha256::backend();
+    Sha256::Backend backends[] = { Sha256::SCALAR, Sha256::AVX2, Sha256::AVX512 };
+    for (Sha256::Backend b : backends) {
+        char name[64];
+        snprintf(name, sizeof name, "Sha256::hashMany (%s)", Sha256::backendName(b));
+        if (!Sha256::setBackend(b)) {
+            printf("%-28s not supported by this CPU\n", name);
+            continue;
+        }
+        double ns = nsPerHash(iterations, [&]() {
+            for (size_t i = 0; i < iterations; i += CNT) {
+                Sha256::hashMany(outs.data(), in.data(), len.data(), CNT);
+                msgs[0] = outs[CNT - 1][0];
+            }
+        });
+        printf("%-28s %8.1f ns/hash  %5.2fx\n", name, ns, secp / ns);
+    }
+    Sha256::setBackend(backend);
+    return 0;
+}
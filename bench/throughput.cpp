@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Throughput of the operations whose cost depends on the libsecp256k1 configuration: ch with
+// the secret key (a*G, ECMULT_GEN_PREC_BITS), ch with the public key (a*P + b*G,
+// ECMULT_WINDOW_SIZE), and authenticate and verify, which compute one ch per tree level.
+// bench/matrix.sh builds and runs this for several configurations. --no-hugepages keeps the
+// tables and batches on regular pages, for comparison with the default.
+//
+// usage: acca_throughput [iterations] [--csv] [--no-hugepages]
+
+#include "../authenticator.h"
+#include "../hugepages.h"
+#include "../instrument.h"
+#include "../tokenbatch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const ChameleonHash::sk_t SK = {{
+    0xb2, 0x19, 0x77, 0xc8, 0xca, 0x1c, 0xbb, 0x55, 0xf0, 0xa3, 0xef, 0xfd, 0x99, 0x66, 0xe3, 0xd5,
+    0xc9, 0x58, 0x86, 0x88, 0xfa, 0x02, 0xbf, 0x7a, 0x0d, 0x2a, 0xf7, 0xb6, 0x36, 0x6f, 0x1e, 0x8f
+}};
+const ChameleonHash::W W = SK;
+
+template <typename F>
+double opsPerSec(size_t ops, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return ops / std::chrono::duration<double>(end - start).count();
+}
+
+const char* widemul()
+{
+#if defined(SECP256K1_WIDEMUL_INT128)
+#if defined(USE_ASM_X86_64)
+    return "int128-asm";
+#else
+    return "int128";
+#endif
+#else
+    return "int64";
+#endif
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = 2000;
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        }
+        else if (strcmp(argv[i], "--no-hugepages") == 0) {
+            HugePages::setEnabled(false);
+        }
+        else {
+            iterations = strtoul(argv[i], nullptr, 10);
+        }
+    }
+
+    ChameleonHash::digest_t m = {{ 1 }};
+    ChameleonHash::rand_t r = {{ 2 }};
+    ChameleonHash::hash_t h;
+
+    ChameleonHash chSk(SK, W, 0);
+    double chSign = opsPerSec(iterations, [&]() {
+        for (size_t i = 0; i < iterations; i++) {
+            chSk.ch(h, m, r, 0);
+            m[0] = h[1];
+        }
+    });
+
+    ChameleonHash chPk(chSk.getPk(true), W);
+    double chVerify = opsPerSec(iterations, [&]() {
+        for (size_t i = 0; i < iterations; i++) {
+            chPk.ch(h, m, r, 0);
+            m[0] = h[1];
+        }
+    });
+
+    // every authenticate and verify walks the whole tree, so use fewer iterations
+    size_t tokens = iterations / Authenticator::DEPTH + 1;
+    Authenticator acca(SK, W, 0);
+    Authenticator verifier(acca.getDpk(), W);
+    Authenticator::ct_t ct = {};
+    Authenticator::st_t st = { 'a', 'b', 'c' };
+    std::vector<Authenticator::token_t> t(tokens);
+    double authenticate = opsPerSec(tokens, [&]() {
+        for (size_t i = 0; i < tokens; i++) {
+            ct[0] = i;
+            acca.authenticate(t[i], ct, st, 0);
+        }
+    });
+    bool ok = true;
+    double verify = opsPerSec(tokens, [&]() {
+        for (size_t i = 0; i < tokens; i++) {
+            ct[0] = i;
+            ok &= verifier.verify(t[i], ct, st, 0);
+        }
+    });
+
+    TokenBatch batch;
+    std::vector<Authenticator::ct_t> cts(tokens, ct);
+    for (size_t i = 0; i < tokens; i++) {
+        batch.add(st, 0);
+    }
+    acca.authenticates(batch, ct, h);
+    std::unique_ptr<bool[]> results(new bool[tokens]);
+    double verifyBatch = opsPerSec(tokens, [&]() {
+        verifier.verifyBatch(batch, cts.data(), results.get());
+    });
+    for (size_t i = 0; i < tokens; i++) {
+        ok &= results[i];
+    }
+    if (!ok) {
+        fprintf(stderr, "verification failed\n");
+        return 1;
+    }
+
+    if (csv) {
+        printf("%s,%d,%d,%.0f,%.0f,%.1f,%.1f,%.1f\n", widemul(), ECMULT_WINDOW_SIZE, ECMULT_GEN_PREC_BITS,
+               chSign, chVerify, authenticate, verify, verifyBatch);
+        return 0;
+    }
+    printf("widemul %s, ECMULT_WINDOW_SIZE %d, ECMULT_GEN_PREC_BITS %d\n", widemul(), ECMULT_WINDOW_SIZE, ECMULT_GEN_PREC_BITS);
+    printf("a*P + b*G table on %s, batch on %s\n", HugePages::kindName(HugePages::kind(secp256k1_pre_g)),
+           HugePages::kindName(HugePages::kind(batch.rs(0))));
+    printf("%-24s %10.0f ops/s\n", "ch (secret key)", chSign);
+    printf("%-24s %10.0f ops/s\n", "ch (public key)", chVerify);
+    printf("%-24s %10.1f ops/s\n", "authenticate", authenticate);
+    printf("%-24s %10.1f ops/s\n", "verify", verify);
+    printf("%-24s %10.1f ops/s\n", "verifyBatch", verifyBatch);
+
+    if (Instrument::ENABLED) {
+        Instrument::stats_t stats;
+        Instrument::snapshot(stats);
+        printf("\n%-24s %10s %14s %12s\n", "phase", "calls", "ticks", "ticks/call");
+        for (size_t i = 0; i < Instrument::PHASE_COUNT; i++) {
+            printf("%-24s %10llu %14llu %12.0f\n", Instrument::phaseName((Instrument::Phase) i),
+                   (unsigned long long) stats.calls[i], (unsigned long long) stats.ticks[i],
+                   stats.calls[i] ? (double) stats.ticks[i] / stats.calls[i] : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "blake3.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+namespace {
+
+const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// Message word order in every round, i.e., the message permutation applied 0 to 6 times
+const uint8_t SCHEDULE[7][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+    { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+    { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+    { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+    { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+    { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 }
+};
+
+enum {
+    CHUNK_START = 1 << 0,
+    CHUNK_END = 1 << 1,
+    PARENT = 1 << 2,
+    ROOT = 1 << 3,
+    KEYED_HASH = 1 << 4
+};
+
+inline uint32_t readLE32(const unsigned char* p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+inline void writeLE32(unsigned char* p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+inline uint32_t rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+inline void g(uint32_t* s, size_t a, size_t b, size_t c, size_t d, uint32_t mx, uint32_t my)
+{
+    s[a] = s[a] + s[b] + mx;
+    s[d] = rotr(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = rotr(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + my;
+    s[d] = rotr(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = rotr(s[b] ^ s[c], 7);
+}
+
+// The compression function; the first 8 words of out are the chaining value.
+void compress(uint32_t out[16], const Blake3::cv_t& cv, const unsigned char* block, uint64_t counter, uint32_t blockLen, uint32_t flags)
+{
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; i++) {
+        m[i] = readLE32(block + 4 * i);
+    }
+    uint32_t s[16] = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        IV[0], IV[1], IV[2], IV[3], (uint32_t) counter, (uint32_t) (counter >> 32), blockLen, flags
+    };
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC unroll 7
+#endif
+    for (size_t r = 0; r < 7; r++) {
+        const uint8_t* x = SCHEDULE[r];
+        g(s, 0, 4, 8, 12, m[x[0]], m[x[1]]);
+        g(s, 1, 5, 9, 13, m[x[2]], m[x[3]]);
+        g(s, 2, 6, 10, 14, m[x[4]], m[x[5]]);
+        g(s, 3, 7, 11, 15, m[x[6]], m[x[7]]);
+        g(s, 0, 5, 10, 15, m[x[8]], m[x[9]]);
+        g(s, 1, 6, 11, 12, m[x[10]], m[x[11]]);
+        g(s, 2, 7, 8, 13, m[x[12]], m[x[13]]);
+        g(s, 3, 4, 9, 14, m[x[14]], m[x[15]]);
+    }
+    for (size_t i = 0; i < 8; i++) {
+        out[i] = s[i] ^ s[i + 8];
+        out[i + 8] = s[i + 8] ^ cv[i];
+    }
+}
+
+void chainingValue(Blake3::cv_t& res, const Blake3::cv_t& cv, const unsigned char* block, uint64_t counter, uint32_t blockLen, uint32_t flags)
+{
+    uint32_t out[16];
+    compress(out, cv, block, counter, blockLen, flags);
+    std::copy(out, out + 8, res.begin());
+}
+
+void parentCv(Blake3::cv_t& res, const Blake3::cv_t& left, const Blake3::cv_t& right, const Blake3::ctx_t& ctx)
+{
+    unsigned char block[Blake3::BLOCK_LEN];
+    for (size_t i = 0; i < 8; i++) {
+        writeLE32(block + 4 * i, left[i]);
+        writeLE32(block + 32 + 4 * i, right[i]);
+    }
+    chainingValue(res, ctx.key, block, 0, Blake3::BLOCK_LEN, ctx.flags | PARENT);
+}
+
+void startChunk(Blake3::ctx_t& ctx, uint64_t counter)
+{
+    ctx.cv = ctx.key;
+    ctx.chunkCounter = counter;
+    memset(ctx.block, 0, sizeof ctx.block);
+    ctx.blockLen = 0;
+    ctx.blocksCompressed = 0;
+}
+
+uint32_t chunkStartFlag(const Blake3::ctx_t& ctx)
+{
+    return ctx.blocksCompressed == 0 ? CHUNK_START : 0;
+}
+
+void initializeWithKey(Blake3::ctx_t& ctx, const uint32_t key[8], uint32_t flags)
+{
+    std::copy(key, key + 8, ctx.key.begin());
+    ctx.flags = flags;
+    ctx.stackLen = 0;
+    startChunk(ctx, 0);
+}
+
+}
+
+void Blake3::initialize(ctx_t& ctx)
+{
+    initializeWithKey(ctx, IV, 0);
+}
+
+void Blake3::initializeKeyed(ctx_t& ctx, const key_t& key)
+{
+    uint32_t words[8];
+    for (size_t i = 0; i < 8; i++) {
+        words[i] = readLE32(key.data() + 4 * i);
+    }
+    initializeWithKey(ctx, words, KEYED_HASH);
+}
+
+void Blake3::write(ctx_t& ctx, const unsigned char* in, size_t len)
+{
+    while (len > 0) {
+        // A full chunk is only finished once more input arrives, because the last chunk has to
+        // be compressed with the ROOT flag if it is the only one.
+        if (ctx.blocksCompressed * BLOCK_LEN + ctx.blockLen == CHUNK_LEN) {
+            cv_t cv;
+            chainingValue(cv, ctx.cv, ctx.block, ctx.chunkCounter, BLOCK_LEN, ctx.flags | chunkStartFlag(ctx) | CHUNK_END);
+            uint64_t totalChunks = ctx.chunkCounter + 1;
+            // merge all subtrees that are complete now
+            while ((totalChunks & 1) == 0) {
+                parentCv(cv, ctx.stack[--ctx.stackLen], cv, ctx);
+                totalChunks >>= 1;
+            }
+            ctx.stack[ctx.stackLen++] = cv;
+            startChunk(ctx, ctx.chunkCounter + 1);
+        }
+
+        if (ctx.blockLen == BLOCK_LEN) {
+            chainingValue(ctx.cv, ctx.cv, ctx.block, ctx.chunkCounter, BLOCK_LEN, ctx.flags | chunkStartFlag(ctx));
+            ctx.blocksCompressed++;
+            memset(ctx.block, 0, sizeof ctx.block);
+            ctx.blockLen = 0;
+        }
+
+        size_t n = std::min(len, BLOCK_LEN - ctx.blockLen);
+        memcpy(ctx.block + ctx.blockLen, in, n);
+        ctx.blockLen += n;
+        in += n;
+        len -= n;
+    }
+}
+
+void Blake3::finalize(const ctx_t& ctx, out_t& out)
+{
+    finalize(ctx, out.data(), out.size());
+}
+
+void Blake3::finalize(const ctx_t& ctx, unsigned char* out, size_t len)
+{
+    // the output of the current chunk, and then of the parents on the way up to the root
+    cv_t cv = ctx.cv;
+    unsigned char block[BLOCK_LEN];
+    memcpy(block, ctx.block, BLOCK_LEN);
+    uint64_t counter = ctx.chunkCounter;
+    uint32_t blockLen = ctx.blockLen;
+    uint32_t flags = ctx.flags | chunkStartFlag(ctx) | CHUNK_END;
+
+    for (size_t i = ctx.stackLen; i > 0; i--) {
+        cv_t right;
+        chainingValue(right, cv, block, counter, blockLen, flags);
+        for (size_t j = 0; j < 8; j++) {
+            writeLE32(block + 4 * j, ctx.stack[i - 1][j]);
+            writeLE32(block + 32 + 4 * j, right[j]);
+        }
+        cv = ctx.key;
+        counter = 0;
+        blockLen = BLOCK_LEN;
+        flags = ctx.flags | PARENT;
+    }
+
+    // The root node has counter 0, so its counter is free to number the output blocks.
+    assert(counter == 0);
+    for (uint64_t outCounter = 0; len > 0; outCounter++) {
+        uint32_t words[16];
+        unsigned char bytes[BLOCK_LEN];
+        compress(words, cv, block, outCounter, blockLen, flags | ROOT);
+        for (size_t i = 0; i < 16; i++) {
+            writeLE32(bytes + 4 * i, words[i]);
+        }
+        size_t n = std::min(len, BLOCK_LEN);
+        memcpy(out, bytes, n);
+        out += n;
+        len -= n;
+    }
+}
+
+void Blake3::hash(out_t& out, const unsigned char* in, size_t len)
+{
+    ctx_t ctx;
+    initialize(ctx);
+    write(ctx, in, len);
+    finalize(ctx, out);
+}
+
+void Blake3::keyedHash(out_t& out, const key_t& key, const unsigned char* in, size_t len)
+{
+    ctx_t ctx;
+    initializeKeyed(ctx, key);
+    write(ctx, in, len);
+    finalize(ctx, out);
+}
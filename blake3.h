@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef BLAKE3_H
+#define BLAKE3_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+
+// Portable BLAKE3 in plain and keyed mode, with 32-byte or extended outputs. The implementation follows the
+// BLAKE3 reference implementation and supports inputs of any length.
+class Blake3
+{
+public:
+    static const size_t OUT_LEN = 32;
+    static const size_t KEY_LEN = 32;
+    static const size_t BLOCK_LEN = 64;
+    static const size_t CHUNK_LEN = 1024;
+
+    typedef std::array<unsigned char, OUT_LEN> out_t;
+    typedef std::array<unsigned char, KEY_LEN> key_t;
+    typedef std::array<uint32_t, 8> cv_t;
+
+    // Incremental hashing, like Sha256::ctx_t.
+    struct ctx_t {
+        cv_t key;
+        uint32_t flags;
+
+        // current chunk
+        cv_t cv;
+        uint64_t chunkCounter;
+        unsigned char block[BLOCK_LEN];
+        size_t blockLen;
+        size_t blocksCompressed;
+
+        // chaining values of completed subtrees, enough for 2^54 chunks
+        cv_t stack[54];
+        size_t stackLen;
+    };
+
+    static void initialize(ctx_t& ctx);
+    static void initializeKeyed(ctx_t& ctx, const key_t& key);
+    static void write(ctx_t& ctx, const unsigned char* in, size_t len);
+    static void finalize(const ctx_t& ctx, out_t& out);
+    // extended output of len bytes, the first OUT_LEN of which are the hash
+    static void finalize(const ctx_t& ctx, unsigned char* out, size_t len);
+
+    static void hash(out_t& out, const unsigned char* in, size_t len);
+    static void keyedHash(out_t& out, const key_t& key, const unsigned char* in, size_t len);
+};
+
+#endif // BLAKE3_H
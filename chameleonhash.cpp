@@ -25,9 +25,18 @@
  */
 
 #include "chameleonhash.h"
+#include "blake3.h"
+#include "ecmultlanes.h"
+#include "hugepages.h"
+#include "instrument.h"
+#include "probes.h"
+#include "sha256.h"
+
+#include "secp256k1/src/scratch_impl.h"
 
 #include <vector>
 #include <algorithm>
+#include <string.h>
 
 void ChameleonHash::initialize()
 {
@@ -35,6 +44,8 @@ void ChameleonHash::initialize()
     // ensure already by themselves that they do their work only once
     secp256k1_ecmult_gen_start();
     secp256k1_ecmult_start();
+    static HugePages::Kind tables = HugePages::prepareSecpTables();
+    (void) tables;
 }
 
 
@@ -84,15 +95,15 @@ ChameleonHash::ChameleonHash(const sk_t& sk, const W& w, int n) : hasSecretKey_(
     secp256k1_scalar_add(&skr, &skr, &this->sk);
     secp256k1_scalar_add(&skr, &skr, &a);
     // set pk = g^(sk+n*w)
-    secp256k1_ecmult_gen(&this->pk, &skr);
+    ACCA_TIMED(PHASE_ECMULT_GEN, secp256k1_ecmult_gen(&this->pk, &skr));
 
-    secp256k1_scalar_inverse(&this->skInv, &this->sk);
+    ACCA_TIMED(PHASE_SCALAR_INVERSE, secp256k1_scalar_inverse(&this->skInv, &this->sk));
 }
 
 ChameleonHash::pk_t ChameleonHash::getPk(bool compressed)
 {
     secp256k1_ge_t pkge;
-    secp256k1_ge_set_gej_var(&pkge, &this->pk);
+    ACCA_TIMED(PHASE_AFFINE, secp256k1_ge_set_gej_var(&pkge, &this->pk));
 
     pk_t res;
     res.resize(65);
@@ -129,9 +140,6 @@ void ChameleonHash::ch(hash_t& res, const digest_t& m, const rand_t& r, int n)
     }
 
     secp256k1_gej_t resgej;
-    secp256k1_ge_t resge;
-
-    int hash_len = 0;
 
     if (this->hasSecretKey_) {
         // now we (ab)use the rs variable to compute the result
@@ -160,15 +168,55 @@ void ChameleonHash::ch(hash_t& res, const digest_t& m, const rand_t& r, int n)
         secp256k1_scalar_add(&rs, &rs, &a);
 
         //在签名过程中用于加速a*G计算 g^(m+(sk+(n*w))*r)
-        secp256k1_ecmult_gen(&resgej, &rs);
+        ACCA_TIMED(PHASE_ECMULT_GEN, secp256k1_ecmult_gen(&resgej, &rs));
     }
     else {
-        secp256k1_ecmult(&resgej, &this->pk, &rs, &ms);
+        ACCA_TIMED(PHASE_ECMULT, secp256k1_ecmult(&resgej, &this->pk, &rs, &ms));
+    }
+    serialize(res, resgej);
+}
+
+void ChameleonHash::ch(hash_t* res, const digest_t* m, const rand_t* const* r, const int* n, size_t cnt)
+{
+    if (this->hasSecretKey_) {
+        for (size_t i = 0; i < cnt; i++) {
+            ch(res[i], m[i], *r[i], n[i]);
+        }
+        return;
+    }
+
+    if (!lanes) {
+        lanes = std::make_shared<EcmultLanes>(this->pk);
     }
+
+    secp256k1_scalar_t ms[EcmultLanes::LANES];
+    secp256k1_scalar_t rs[EcmultLanes::LANES];
+    secp256k1_gej_t resgej[EcmultLanes::LANES];
+    for (size_t done = 0; done < cnt; done += EcmultLanes::LANES) {
+        size_t lanesCnt = std::min(EcmultLanes::LANES, cnt - done);
+        for (size_t i = 0; i < lanesCnt; i++) {
+            int overflow;
+            secp256k1_scalar_set_b32(&ms[i], m[done + i].data(), nullptr);
+            secp256k1_scalar_set_b32(&rs[i], r[done + i]->data(), &overflow);
+            if (overflow) {
+                throw std::invalid_argument("overflow in randomness");
+            }
+        }
+        ACCA_TIMED(PHASE_ECMULT, lanes->ecmult(resgej, rs, ms, lanesCnt));
+        for (size_t i = 0; i < lanesCnt; i++) {
+            serialize(res[done + i], resgej[i]);
+        }
+    }
+}
+
+void ChameleonHash::serialize(hash_t& res, secp256k1_gej_t& gej)
+{
+    secp256k1_ge_t ge;
+    int hash_len = 0;
     //获取产生器（在group包里提到过）
-    secp256k1_ge_set_gej(&resge, &resgej);
+    ACCA_TIMED(PHASE_AFFINE, secp256k1_ge_set_gej(&ge, &gej));
     //签名
-    if (!secp256k1_eckey_pubkey_serialize(&resge, res.data(), &hash_len, 1) || hash_len != HASH_LEN) {
+    if (!secp256k1_eckey_pubkey_serialize(&ge, res.data(), &hash_len, 1) || hash_len != HASH_LEN) {
         throw std::logic_error("cannot serialize chameleon hash");
     }
 }
@@ -268,12 +316,12 @@ void ChameleonHash::extract(const digest_t& d1, const rand_t& r1, int n1, const
     secp256k1_scalar_set_b32(&r2s, r2.data(), nullptr);
     secp256k1_scalar_negate(&r1s, &r1s);
     secp256k1_scalar_add(&down, &r2s, &r1s);
-    secp256k1_scalar_inverse(&down, &down);
+    ACCA_TIMED(PHASE_SCALAR_INVERSE, secp256k1_scalar_inverse(&down, &down));
 
 
     // set sk = ((d1-d2)-(r2*n2-r1*n1)*w) / (r2-r1)
     secp256k1_scalar_mul(&this->sk, &up, &down);
-    secp256k1_scalar_inverse(&this->skInv, &this->sk);
+    ACCA_TIMED(PHASE_SCALAR_INVERSE, secp256k1_scalar_inverse(&this->skInv, &this->sk));
     hasSecretKey_ = true;
 }
 
@@ -335,7 +383,7 @@ void ChameleonHash::collision(const ChameleonHash::digest_t& d1, const Chameleon
     secp256k1_scalar_clear(&down);
     secp256k1_scalar_add(&down, &a2, &this->sk);
     // set 1/(n2*w+sk)
-    secp256k1_scalar_inverse(&down, &down);
+    ACCA_TIMED(PHASE_SCALAR_INVERSE, secp256k1_scalar_inverse(&down, &down));
 
     // r2 = ((d1-d2)+(n1*w+sk)*r1)/(n2*w+sk)
     secp256k1_scalar_t r2s;
@@ -369,140 +417,433 @@ void ChameleonHash::collision(const ChameleonHash::digest_t& d1, const Chameleon
 
 void ChameleonHash::digest(digest_t& digest, const mesg_t& m)
 {
-    secp256k1_sha256_t sha;
+    ChameleonHash::digest(digest, m.data(), m.size());
+}
+
+namespace {
+
+const unsigned char ORACLE_KEY[] = "RandomOracleGRandomOracleGRandom";
+
+// Chaining values of the HMAC in randomOracle, whose key is fixed
+struct OracleMidstates {
+    Sha256::state_t inner, outer;
+    OracleMidstates() {
+        Sha256::hmacMidstates(inner, outer, ORACLE_KEY, 32);
+    }
+};
+
+const OracleMidstates& oracleMidstates()
+{
+    static OracleMidstates m;
+    return m;
+}
+
+}
+
+void ChameleonHash::digest(digest_t& digest, const unsigned char* m, size_t len)
+{
+    ACCA_PHASE(PHASE_SHA256);
     secp256k1_scalar_t ms;
 
-    const unsigned char* in = m.data();
-    size_t size = m.size();
+    const unsigned char* in = m;
+    size_t size = len;
 
     int overflow;
     do {
-        secp256k1_sha256_initialize(&sha);
-        secp256k1_sha256_write(&sha, in, size);
-        secp256k1_sha256_finalize(&sha, digest.data());
+        Sha256::hash(digest, in, size);
         secp256k1_scalar_set_b32(&ms, digest.data(), &overflow);
         in = digest.data();
         size = digest.size();
     } while (overflow);
 }
 
-void ChameleonHash::digest(digest_t& digest, const ChameleonHash::hash_t& in1, const ChameleonHash::hash_t& in2)
+void ChameleonHash::digest(digest_t& digest, const ChameleonHash::hash_t& in1, const ChameleonHash::hash_t& in2, Suite suite)
 {
-    secp256k1_sha256_t hash;
-    secp256k1_sha256_initialize(&hash);
-    secp256k1_sha256_write(&hash, in1.data(), in1.size());
-    secp256k1_sha256_write(&hash, in2.data(), in2.size());
-    secp256k1_sha256_finalize(&hash, digest.data());
+    ACCA_PHASE(PHASE_SHA256);
+    if (suite == SUITE_BLAKE3) {
+        Blake3::ctx_t hash;
+        Blake3::initialize(hash);
+        Blake3::write(hash, in1.data(), in1.size());
+        Blake3::write(hash, in2.data(), in2.size());
+        Blake3::finalize(hash, digest);
+        return;
+    }
+    Sha256::ctx_t hash;
+    Sha256::initialize(hash);
+    Sha256::write(hash, in1.data(), in1.size());
+    Sha256::write(hash, in2.data(), in2.size());
+    Sha256::finalize(hash, digest);
 }
 
-void ChameleonHash::randomOracle(hash_t& out, const hash_t& in1, const rand_t& in2)
+void ChameleonHash::randomOracle(hash_t& out, const hash_t& in1, const rand_t& in2, Suite suite)
 {
-    secp256k1_hmac_sha256_t hmac;
-    unsigned char key[] = "RandomOracleGRandomOracleGRandom";
-    secp256k1_hmac_sha256_initialize(&hmac, key, 32);
-    secp256k1_hmac_sha256_write(&hmac, in1.data(), in1.size());
-    secp256k1_hmac_sha256_write(&hmac, in2.data(), in2.size());
-    secp256k1_hmac_sha256_finalize(&hmac, out.data());
+    ACCA_PHASE(PHASE_HMAC);
+    if (suite == SUITE_BLAKE3) {
+        Blake3::key_t key;
+        std::copy(ORACLE_KEY, ORACLE_KEY + key.size(), key.begin());
+        Blake3::ctx_t hash;
+        Blake3::out_t res;
+        Blake3::initializeKeyed(hash, key);
+        Blake3::write(hash, in1.data(), in1.size());
+        Blake3::write(hash, in2.data(), in2.size());
+        Blake3::finalize(hash, res);
+        std::copy(res.begin(), res.end(), out.begin());
+        out[32] = '\0';
+        return;
+    }
+
+    const OracleMidstates& mid = oracleMidstates();
+    Sha256::ctx_t hmac;
+    Sha256::out_t inner, outer;
+    Sha256::initialize(hmac, mid.inner, Sha256::BLOCK_LEN);
+    Sha256::write(hmac, in1.data(), in1.size());
+    Sha256::write(hmac, in2.data(), in2.size());
+    Sha256::finalize(hmac, inner);
+    Sha256::initialize(hmac, mid.outer, Sha256::BLOCK_LEN);
+    Sha256::write(hmac, inner.data(), inner.size());
+    Sha256::finalize(hmac, outer);
+    std::copy(outer.begin(), outer.end(), out.begin());
     out[32] = '\0';
 }
 
-void ChameleonHash::calcaG(secp256k1_ge_t *resge, digest_t& m, rand_t& r, pk_t& pk) {
-	// m cannot overflow, this is ensured by the public ch() method
-	secp256k1_scalar_t ms, tmp;
-	//将标量设置为无符号整数
-	secp256k1_scalar_set_b32(&ms, m.data(), nullptr);
-
-	secp256k1_ge_t pkge;
-	secp256k1_gej_t pkgej;
-	if (!secp256k1_eckey_pubkey_parse(&pkge, pk.data(), pk.size())) {
-		throw std::invalid_argument("not a valid public key");
-	}
-	secp256k1_gej_set_ge(&pkgej, &pkge);
-
-	int overflow;
-	secp256k1_scalar_t rs;
-	//将标量设置为无符号整数
-	secp256k1_scalar_set_b32(&rs, r.data(), &overflow);
-	if (overflow) {
-		throw std::invalid_argument("overflow in randomness");
-	}
-
-	secp256k1_gej_t resgej, resgej_;
-
-	secp256k1_ecmult_gen(&resgej, &ms);
-
-	secp256k1_scalar_clear(&tmp);
-	secp256k1_ecmult(&resgej_, &pkgej, &rs, &tmp);
-	secp256k1_ge_set_gej(resge, &resgej_);
-	secp256k1_gej_add_ge_var(&resgej, &resgej, resge);
-	secp256k1_ge_set_gej(resge, &resgej);
-}
-void ChameleonHash::mergeV(hash_t& res, std::vector<digest_t>& m, std::vector<rand_t>& r,std::vector<pk_t>& pk, int cnt)
-{
-	secp256k1_scalar_t ms;
-	secp256k1_scalar_clear(&ms);
-	secp256k1_gej_t resgej;
-	secp256k1_ge_t resge;
-	secp256k1_ecmult_gen(&resgej, &ms);
-	for (int i = 0; i < cnt; i++) {
-		calcaG(&resge, m[i], r[i], pk[i]);
-		secp256k1_gej_add_ge_var(&resgej, &resgej, &resge);
-	}
-	secp256k1_ge_set_gej(&resge, &resgej);
-	int hash_len = 0;
-	if (!secp256k1_eckey_pubkey_serialize(&resge, res.data(), &hash_len, 1) || hash_len != HASH_LEN) {
-		throw std::logic_error("cannot serialize chameleon hash");
-	}
+void ChameleonHash::digest(digest_t* digest, const unsigned char* const* m, const size_t* len, size_t cnt)
+{
+    ACCA_TIMED(PHASE_SHA256, Sha256::hashMany(digest, m, len, cnt));
+    for (size_t i = 0; i < cnt; i++) {
+        secp256k1_scalar_t ms;
+        int overflow;
+        secp256k1_scalar_set_b32(&ms, digest[i].data(), &overflow);
+        if (overflow) {
+            // happens with negligible probability; finish like the single-message digest
+            digest_t d = digest[i];
+            ChameleonHash::digest(digest[i], d.data(), d.size());
+        }
+    }
+}
+
+void ChameleonHash::digest(digest_t* digest, const hash_t* const* in1, const hash_t* const* in2, size_t cnt, Suite suite)
+{
+    if (suite != SUITE_SHA256) {
+        for (size_t i = 0; i < cnt; i++) {
+            ChameleonHash::digest(digest[i], *in1[i], *in2[i], suite);
+        }
+        return;
+    }
+    static const size_t CHUNK = 32;
+    unsigned char buf[CHUNK][2 * HASH_LEN];
+    const unsigned char* in[CHUNK];
+    size_t lens[CHUNK];
+    for (size_t done = 0; done < cnt; done += CHUNK) {
+        size_t n = std::min(CHUNK, cnt - done);
+        for (size_t j = 0; j < n; j++) {
+            memcpy(buf[j], in1[done + j]->data(), HASH_LEN);
+            memcpy(buf[j] + HASH_LEN, in2[done + j]->data(), HASH_LEN);
+            in[j] = buf[j];
+            lens[j] = sizeof buf[j];
+        }
+        ACCA_TIMED(PHASE_SHA256, Sha256::hashMany(digest + done, in, lens, n));
+    }
+}
+
+void ChameleonHash::randomOracle(hash_t* out, const hash_t* const* in1, const rand_t* const* in2, size_t cnt, Suite suite)
+{
+    if (suite != SUITE_SHA256) {
+        for (size_t i = 0; i < cnt; i++) {
+            randomOracle(out[i], *in1[i], *in2[i], suite);
+        }
+        return;
+    }
+    static const size_t CHUNK = 32;
+    const OracleMidstates& mid = oracleMidstates();
+
+    unsigned char buf[CHUNK][HASH_LEN + RAND_LEN];
+    const unsigned char* in[CHUNK];
+    size_t lens[CHUNK];
+    Sha256::out_t inners[CHUNK], outs[CHUNK];
+    for (size_t done = 0; done < cnt; done += CHUNK) {
+        size_t n = std::min(CHUNK, cnt - done);
+        for (size_t j = 0; j < n; j++) {
+            memcpy(buf[j], in1[done + j]->data(), HASH_LEN);
+            memcpy(buf[j] + HASH_LEN, in2[done + j]->data(), RAND_LEN);
+            in[j] = buf[j];
+            lens[j] = sizeof buf[j];
+        }
+        ACCA_TIMED(PHASE_HMAC, Sha256::hashMany(inners, in, lens, n, mid.inner, Sha256::BLOCK_LEN));
+        for (size_t j = 0; j < n; j++) {
+            in[j] = inners[j].data();
+            lens[j] = inners[j].size();
+        }
+        ACCA_TIMED(PHASE_HMAC, Sha256::hashMany(outs, in, lens, n, mid.outer, Sha256::BLOCK_LEN));
+        for (size_t j = 0; j < n; j++) {
+            std::copy(outs[j].begin(), outs[j].end(), out[done + j].begin());
+            out[done + j][32] = '\0';
+        }
+    }
+}
+
+void ChameleonHash::mergeV(hash_t& res, std::vector<digest_t>& m, std::vector<rand_t>& r, std::vector<pk_t>& pk, int cnt)
+{
+    mergeV(res, m.data(), r.data(), pk.data(), cnt);
+}
+
+void ChameleonHash::mergeV(hash_t& res, const std::vector<digest_t>& m, const std::vector<rand_t>& r, const std::vector<pk_t>& pks, const std::vector<uint32_t>& pkRefs)
+{
+    ACCA_PROBE1(mergev_entry, m.size());
+    if (r.size() != m.size() || pkRefs.size() != m.size()) {
+        throw std::invalid_argument("inconsistent number of items");
+    }
+
+    // the items of a public key add up to a single term pk^(sum of r), so the multi-exponentiation
+    // is over the distinct public keys only
+    static thread_local std::vector<secp256k1_ge_t> pkges;
+    static thread_local std::vector<secp256k1_scalar_t> coefs;
+    pkges.resize(pks.size());
+    coefs.resize(pks.size());
+    for (size_t i = 0; i < pks.size(); i++) {
+        if (!secp256k1_eckey_pubkey_parse(&pkges[i], pks[i].data(), pks[i].size())) {
+            throw std::invalid_argument("not a valid public key");
+        }
+        secp256k1_scalar_clear(&coefs[i]);
+    }
+
+    secp256k1_scalar_t g;
+    secp256k1_scalar_clear(&g);
+    for (size_t i = 0; i < m.size(); i++) {
+        if (pkRefs[i] >= pks.size()) {
+            throw std::invalid_argument("unknown public key reference");
+        }
+        secp256k1_scalar_t ms, rs;
+        secp256k1_scalar_set_b32(&ms, m[i].data(), nullptr);
+        int overflow;
+        secp256k1_scalar_set_b32(&rs, r[i].data(), &overflow);
+        if (overflow) {
+            throw std::invalid_argument("overflow in randomness");
+        }
+        secp256k1_scalar_add(&g, &g, &ms);
+        secp256k1_scalar_add(&coefs[pkRefs[i]], &coefs[pkRefs[i]], &rs);
+    }
+
+    mergeV_t acc;
+    mergeVInitialize(acc);
+    ACCA_TIMED(PHASE_ECMULT, multiExp(acc.sum, g, pkges.data(), coefs.data(), pks.size()));
+    mergeVFinalize(res, acc);
+    ACCA_PROBE1(mergev_return, m.size());
 }
 
 void ChameleonHash::mergeA(hash_t& res, std::vector<digest_t>& m, std::vector<rand_t>& r, int n[], int cnt)
 {
-	secp256k1_scalar_t res_;
-	secp256k1_scalar_clear(&res_);
-	for (int i = 0; i < cnt; i++) {
-		// now we (ab)use the rs variable to compute the result
-		// set n*w
-		secp256k1_scalar_t ms;
-		secp256k1_scalar_t rs;
-		secp256k1_scalar_t x;
-		secp256k1_scalar_t a;
-		secp256k1_scalar_clear(&a);
-		secp256k1_scalar_clear(&x);
-		secp256k1_scalar_set_b32(&ms, m[i].data(), nullptr);
-		int overflow;
-		secp256k1_scalar_set_b32(&rs, r[i].data(), &overflow);
-		if (overflow) {
-			throw std::invalid_argument("overflow in randomness");
-		}
-		secp256k1_scalar_add(&x, &x, &this->w);
-		while (n[i]) {
-			if (n[i] & 1) {
-				secp256k1_scalar_add(&a, &a, &x);
-			}
-			secp256k1_scalar_add(&x, &x, &x);
-			n[i] >>= 1;
-		}
-		//set (n*w)*r
-		secp256k1_scalar_mul(&a, &a, &rs);
-
-		//将两个标量相乘（以组顺序为模）。 r*sk
-		secp256k1_scalar_mul(&rs, &rs, &this->sk);
-		//将两个标量相加（按组顺序进行模运算）。返回是否已溢出。 m+sk*r
-		secp256k1_scalar_add(&rs, &rs, &ms);
-
-		// set m+sk*r+(n*w)*r
-		secp256k1_scalar_add(&rs, &rs, &a);
-
-		// set res+{m_i}
-		secp256k1_scalar_add(&res_, &res_, &rs);
-	}
-	secp256k1_gej_t resgej;
-	secp256k1_ge_t resge;
-	secp256k1_ecmult_gen(&resgej, &res_);
-	secp256k1_ge_set_gej(&resge, &resgej);
-	//签名
-	int hash_len = 0;
-	if (!secp256k1_eckey_pubkey_serialize(&resge, res.data(), &hash_len, 1) || hash_len != HASH_LEN) {
-		throw std::logic_error("cannot serialize chameleon hash");
-	}
+    mergeA(res, m.data(), r.data(), n, cnt);
+}
+
+void ChameleonHash::mergeA(hash_t& res, const digest_t* m, const rand_t* r, const int* n, size_t cnt)
+{
+    mergeA_t acc;
+    mergeAInitialize(acc);
+    for (size_t i = 0; i < cnt; i++) {
+        mergeAAdd(acc, m[i], r[i], n[i]);
+    }
+    mergeAFinalize(res, acc);
+}
+
+void ChameleonHash::mergeV(hash_t& res, const digest_t* m, const rand_t* r, const pk_t* pk, size_t cnt)
+{
+    ACCA_PROBE1(mergev_entry, cnt);
+    mergeV_t acc;
+    mergeVInitialize(acc);
+    for (size_t i = 0; i < cnt; i++) {
+        mergeVAdd(acc, m[i], r[i], pk[i]);
+    }
+    mergeVFinalize(res, acc);
+    ACCA_PROBE1(mergev_return, cnt);
+}
+
+void ChameleonHash::mergeAInitialize(mergeA_t& acc)
+{
+    secp256k1_scalar_clear(&acc.sum);
+}
+
+void ChameleonHash::mergeAAdd(mergeA_t& acc, const digest_t& m, const rand_t& r, int n)
+{
+    if (!hasSecretKey()) {
+        throw std::logic_error("no secret key available");
+    }
+
+    // now we (ab)use the rs variable to compute the result
+    // set n*w
+    secp256k1_scalar_t ms;
+    secp256k1_scalar_t rs;
+    secp256k1_scalar_t x;
+    secp256k1_scalar_t a;
+    secp256k1_scalar_clear(&a);
+    secp256k1_scalar_clear(&x);
+    secp256k1_scalar_set_b32(&ms, m.data(), nullptr);
+    int overflow;
+    secp256k1_scalar_set_b32(&rs, r.data(), &overflow);
+    if (overflow) {
+        throw std::invalid_argument("overflow in randomness");
+    }
+    secp256k1_scalar_add(&x, &x, &this->w);
+    while (n) {
+        if (n & 1) {
+            secp256k1_scalar_add(&a, &a, &x);
+        }
+        secp256k1_scalar_add(&x, &x, &x);
+        n >>= 1;
+    }
+    // set (n*w)*r
+    secp256k1_scalar_mul(&a, &a, &rs);
+
+    // set m+sk*r
+    secp256k1_scalar_mul(&rs, &rs, &this->sk);
+    secp256k1_scalar_add(&rs, &rs, &ms);
+
+    // set m+sk*r+(n*w)*r
+    secp256k1_scalar_add(&rs, &rs, &a);
+
+    // set sum+{m_i}
+    secp256k1_scalar_add(&acc.sum, &acc.sum, &rs);
+}
+
+void ChameleonHash::mergeAFinalize(hash_t& res, const mergeA_t& acc)
+{
+    secp256k1_gej_t resgej;
+    secp256k1_ge_t resge;
+    ACCA_TIMED(PHASE_ECMULT_GEN, secp256k1_ecmult_gen(&resgej, &acc.sum));
+    ACCA_TIMED(PHASE_AFFINE, secp256k1_ge_set_gej(&resge, &resgej));
+    int hash_len = 0;
+    if (!secp256k1_eckey_pubkey_serialize(&resge, res.data(), &hash_len, 1) || hash_len != HASH_LEN) {
+        throw std::logic_error("cannot serialize chameleon hash");
+    }
+}
+
+void ChameleonHash::mergeVInitialize(mergeV_t& acc)
+{
+    initialize();
+    secp256k1_gej_set_infinity(&acc.sum);
+}
+
+void ChameleonHash::mergeVAdd(mergeV_t& acc, const digest_t& m, const rand_t& r, const pk_t& pk)
+{
+    // m cannot overflow, this is ensured by digest()
+    secp256k1_scalar_t ms, rs;
+    secp256k1_scalar_set_b32(&ms, m.data(), nullptr);
+    int overflow;
+    secp256k1_scalar_set_b32(&rs, r.data(), &overflow);
+    if (overflow) {
+        throw std::invalid_argument("overflow in randomness");
+    }
+
+    secp256k1_ge_t pkge;
+    secp256k1_gej_t pkgej;
+    if (!secp256k1_eckey_pubkey_parse(&pkge, pk.data(), pk.size())) {
+        throw std::invalid_argument("not a valid public key");
+    }
+    secp256k1_gej_set_ge(&pkgej, &pkge);
+
+    // set sum + g^m * pk^r
+    secp256k1_gej_t itemgej;
+    ACCA_TIMED(PHASE_ECMULT, secp256k1_ecmult(&itemgej, &pkgej, &rs, &ms));
+    secp256k1_gej_add_var(&acc.sum, &acc.sum, &itemgej);
+}
+
+void ChameleonHash::mergeVFinalize(hash_t& res, const mergeV_t& acc)
+{
+    secp256k1_gej_t resgej = acc.sum;
+    secp256k1_ge_t resge;
+    ACCA_TIMED(PHASE_AFFINE, secp256k1_ge_set_gej(&resge, &resgej));
+    int hash_len = 0;
+    if (!secp256k1_eckey_pubkey_serialize(&resge, res.data(), &hash_len, 1) || hash_len != HASH_LEN) {
+        throw std::logic_error("cannot serialize chameleon hash");
+    }
+}
+
+namespace {
+
+void throwIllegal(const char* text, void*)
+{
+    throw std::logic_error(text);
+}
+
+const secp256k1_callback multiExpError = { throwIllegal, nullptr };
+
+struct multiExpInput {
+    const secp256k1_ge_t* points;
+    const secp256k1_scalar_t* coefs;
+};
+
+int multiExpItem(secp256k1_scalar_t* sc, secp256k1_ge_t* pt, size_t idx, void* data)
+{
+    const multiExpInput* in = static_cast<const multiExpInput*>(data);
+    *sc = in->coefs[idx];
+    *pt = in->points[idx];
+    return 1;
+}
+
+// scratch space of the calling thread, grown to the largest multi-exponentiation so far
+class Scratch
+{
+public:
+    Scratch() : scratch(nullptr), len(0) {}
+    ~Scratch() {
+        secp256k1_scratch_destroy(&multiExpError, scratch);
+    }
+
+    secp256k1_scratch* get(size_t minLen) {
+        if (minLen > len) {
+            secp256k1_scratch_destroy(&multiExpError, scratch);
+            scratch = nullptr;
+            len = 0;
+            scratch = secp256k1_scratch_create(&multiExpError, minLen);
+            if (!scratch) {
+                throw std::bad_alloc();
+            }
+            len = minLen;
+        }
+        return scratch;
+    }
+
+private:
+    secp256k1_scratch* scratch;
+    size_t len;
+};
+
+thread_local Scratch scratch;
+
+}
+
+void ChameleonHash::multiExp(secp256k1_gej_t& res, const secp256k1_scalar_t& g, const secp256k1_ge_t* points, const secp256k1_scalar_t* coefs, size_t cnt)
+{
+    multiExp(res, g, points, coefs, cnt, Plan::current().multiExp(cnt));
+}
+
+void ChameleonHash::multiExp(secp256k1_gej_t& res, const secp256k1_scalar_t& g, const secp256k1_ge_t* points, const secp256k1_scalar_t* coefs, size_t cnt, Plan::MultiExp algorithm)
+{
+    initialize();
+    multiExpInput in = { points, coefs };
+    if (cnt > 0 && algorithm == Plan::MULTIEXP_STRAUSS) {
+        size_t len = secp256k1_strauss_scratch_size(cnt) + STRAUSS_SCRATCH_OBJECTS * ALIGNMENT;
+        if (secp256k1_ecmult_strauss_batch_single(&multiExpError, scratch.get(len), &res, &g, multiExpItem, &in, cnt)) {
+            return;
+        }
+    } else if (cnt > 0 && algorithm == Plan::MULTIEXP_PIPPENGER) {
+        size_t len = secp256k1_pippenger_scratch_size(cnt, secp256k1_pippenger_bucket_window(cnt)) + PIPPENGER_SCRATCH_OBJECTS * ALIGNMENT;
+        if (secp256k1_ecmult_pippenger_batch_single(&multiExpError, scratch.get(len), &res, &g, multiExpItem, &in, cnt)) {
+            return;
+        }
+    }
+
+    // one ecmult per point, G goes along with the first one
+    secp256k1_scalar_t zero;
+    secp256k1_scalar_clear(&zero);
+    secp256k1_gej_t point, term;
+    secp256k1_gej_set_infinity(&res);
+    if (cnt == 0) {
+        secp256k1_gej_set_infinity(&point);
+        secp256k1_ecmult(&res, &point, &zero, &g);
+    }
+    for (size_t i = 0; i < cnt; i++) {
+        secp256k1_gej_set_ge(&point, &points[i]);
+        secp256k1_ecmult(&term, &point, &coefs[i], i == 0 ? &g : &zero);
+        secp256k1_gej_add_var(&res, &res, &term);
+    }
 }
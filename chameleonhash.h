@@ -48,9 +48,15 @@
 #include "secp256k1/src/eckey_impl.h"
 #include "secp256k1/src/hash_impl.h"
 
+#include "plan.h"
+#include "suite.h"
+
 #include <array>
+#include <memory>
 #include <vector>
 
+class EcmultLanes;
+
 class ChameleonHash
 {
 public:
@@ -83,6 +89,9 @@ public:
 
     void ch(hash_t& res, const mesg_t& m, const rand_t& r, int n);
     void ch(hash_t& res, const digest_t& m, const rand_t& r, int n);
+    // ch on cnt independent inputs. Without the secret key, the multiplications are computed
+    // EcmultLanes::LANES at a time.
+    void ch(hash_t* res, const digest_t* m, const rand_t* const* r, const int* n, size_t cnt);
 
     void extract(const digest_t& d1, const rand_t& r1, int n1, const digest_t& d2, const rand_t& r2, int n2);
     void extract(const mesg_t& m1, const rand_t& r1, int n1, const digest_t& d2, const rand_t& r2, int n2);
@@ -96,10 +105,42 @@ public:
 
 	void mergeA(hash_t& res, std::vector<digest_t>& m, std::vector<rand_t>& r, int n[],int cnt);
 	void mergeV(hash_t& res, std::vector<digest_t>& m, std::vector<rand_t>& r, std::vector<pk_t>& pk, int cnt);
+    // Like mergeV above, but item i uses pks[pkRefs[i]]. Every distinct public key is parsed only once.
+    void mergeV(hash_t& res, const std::vector<digest_t>& m, const std::vector<rand_t>& r, const std::vector<pk_t>& pks, const std::vector<uint32_t>& pkRefs);
+
+    // mergeA and mergeV on caller-owned arrays of cnt items. They neither allocate nor modify their inputs.
+    void mergeA(hash_t& res, const digest_t* m, const rand_t* r, const int* n, size_t cnt);
+    static void mergeV(hash_t& res, const digest_t* m, const rand_t* r, const pk_t* pk, size_t cnt);
+
+    // Incremental mergeA and mergeV, for callers that produce the items one at a time.
+    struct mergeA_t {
+        secp256k1_scalar_t sum;
+    };
+    struct mergeV_t {
+        secp256k1_gej_t sum;
+    };
+    static void mergeAInitialize(mergeA_t& acc);
+    void mergeAAdd(mergeA_t& acc, const digest_t& m, const rand_t& r, int n);
+    static void mergeAFinalize(hash_t& res, const mergeA_t& acc);
+    static void mergeVInitialize(mergeV_t& acc);
+    static void mergeVAdd(mergeV_t& acc, const digest_t& m, const rand_t& r, const pk_t& pk);
+    static void mergeVFinalize(hash_t& res, const mergeV_t& acc);
+
+    // res = g * G + sum of coefs[i] * points[i], with the algorithm Plan::current() picks for
+    // cnt points.
+    static void multiExp(secp256k1_gej_t& res, const secp256k1_scalar_t& g, const secp256k1_ge_t* points, const secp256k1_scalar_t* coefs, size_t cnt);
+    static void multiExp(secp256k1_gej_t& res, const secp256k1_scalar_t& g, const secp256k1_ge_t* points, const secp256k1_scalar_t* coefs, size_t cnt, Plan::MultiExp algorithm);
 
     static void digest(digest_t& digest, const mesg_t& m);
-    static void digest(digest_t& digest, const hash_t& in1, const hash_t& in2);
-    static void randomOracle(ChameleonHash::hash_t& out, const ChameleonHash::hash_t& in1, const ChameleonHash::rand_t& in2);
+    static void digest(digest_t& digest, const unsigned char* m, size_t len);
+    static void digest(digest_t& digest, const hash_t& in1, const hash_t& in2, Suite suite = SUITE_SHA256);
+    static void randomOracle(ChameleonHash::hash_t& out, const ChameleonHash::hash_t& in1, const ChameleonHash::rand_t& in2, Suite suite = SUITE_SHA256);
+
+    // digest and randomOracle on cnt independent inputs. With SHA-256, they are hashed in parallel
+    // by Sha256::hashMany.
+    static void digest(digest_t* digest, const unsigned char* const* m, const size_t* len, size_t cnt);
+    static void digest(digest_t* digest, const hash_t* const* in1, const hash_t* const* in2, size_t cnt, Suite suite = SUITE_SHA256);
+    static void randomOracle(hash_t* out, const hash_t* const* in1, const rand_t* const* in2, size_t cnt, Suite suite = SUITE_SHA256);
 	
 
 private:
@@ -108,9 +149,11 @@ private:
     secp256k1_scalar_t w;
     secp256k1_scalar_t skInv;
     bool hasSecretKey_;
+    // built on first use by the batch ch
+    std::shared_ptr<EcmultLanes> lanes;
 
     static void initialize();
-	void calcaG(secp256k1_ge_t *resge, digest_t& m, rand_t& r, pk_t& pk);
+    static void serialize(hash_t& res, secp256k1_gej_t& gej);
 };
 
 #endif // CHAMELEONHASH_H
@@ -0,0 +1,796 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Local signing and verification daemon. Clients connect to a Unix domain socket and send
+// requests as described in accadprotocol.h, as many at a time as they like; the responses
+// are sent back as soon as they are ready, which need not be in request order. A client that
+// does not read its responses is disconnected once MAX_QUEUED bytes of them are queued.
+//
+// Verification requests are coalesced: requests under the same verifier key that arrive
+// within the coalescing window are verified together by verifyBatch, and aggregate proofs
+// arriving within the window are checked with one multi-exponentiation by
+// AggregateProof::verify. The window adapts to the load (see coalescer.h), so a lone request
+// is processed right away, and is at most --window microseconds under heavy load.
+// Authentication requests are processed one at a time, since authenticates would need the
+// same context for all items.
+//
+// A signer file holds one line with the secret key and the trapdoor in hex, and n. The
+// signers are numbered in the order of the --signer options, starting at 0. A plan file of
+// acca_plan sets the batch parameters and the default number of worker threads.
+//
+// Anyone who can authenticate two statements under one context can extract the secret key,
+// so only the user the daemon runs as may connect: the socket is accessible only to that user
+// and lies in $XDG_RUNTIME_DIR, or else in a private directory /tmp/accad-<uid>, and
+// connections from other users (by SO_PEERCRED) are closed. The daemon refuses to start if another one is
+// listening on the socket.
+//
+// usage: accad [--socket=<path>] [--window=<us>] [--max-batch=<items>] [--threads=<n>]
+//              [--plan=<file>] [--signer=<file>]...
+
+#include "accadprotocol.h"
+#include "coalescer.h"
+#include "../aggregateproof.h"
+#include "../plan.h"
+#include "../tokenbatch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t VERIFY_LEN = AccadProtocol::KEY_LEN + 4 + Authenticator::CT_LEN + Authenticator::TOKEN_LEN;
+// bound on the verifiers cached by each worker
+const size_t MAX_VERIFIERS = 1024;
+// bound on the responses queued for a client that does not read them; beyond it, the
+// connection is dropped
+const size_t MAX_QUEUED = 16 << 20;
+// how long the responses still queued at shutdown may take to send
+const int DRAIN_MS = 1000;
+
+struct options_t {
+    std::string socket;
+    unsigned window;
+    size_t maxBatch;
+    // 0 for the threads of the plan
+    unsigned threads;
+    std::string plan;
+    std::vector<std::string> signers;
+};
+
+struct signer_t {
+    Authenticator::dsk_t dsk;
+    Authenticator::dw_t w;
+    int n;
+};
+
+// The workers send responses without waiting: what the socket does not take is queued in out
+// and sent by the I/O thread once the socket is writable.
+struct connection_t {
+    int fd;
+    // written to wake the I/O thread when out is no longer empty
+    int wake;
+    std::vector<unsigned char> in;
+    // guards out and broken
+    std::mutex writeLock;
+    std::vector<unsigned char> out;
+    bool broken;
+
+    connection_t(int fd, int wake) : fd(fd), wake(wake), broken(false) {
+    }
+    ~connection_t() {
+        close(fd);
+    }
+};
+
+struct request_t {
+    std::shared_ptr<connection_t> conn;
+    uint32_t type;
+    uint32_t id;
+    std::vector<unsigned char> payload;
+};
+
+// requests that are processed together
+typedef std::vector<request_t> job_t;
+
+volatile sig_atomic_t stopping = 0;
+
+void onSignal(int)
+{
+    stopping = 1;
+}
+
+bool option(const char* arg, const char* name, std::string& value)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    value = arg + len + 1;
+    return true;
+}
+
+void fromHex(unsigned char* out, size_t len, const std::string& hex)
+{
+    if (hex.size() != 2 * len) {
+        throw std::invalid_argument("expected " + std::to_string(len) + " bytes in hex: " + hex);
+    }
+    for (size_t i = 0; i < len; i++) {
+        char* end;
+        std::string byte = hex.substr(2 * i, 2);
+        out[i] = (unsigned char) strtoul(byte.c_str(), &end, 16);
+        if (*end) {
+            throw std::invalid_argument("not hex: " + hex);
+        }
+    }
+}
+
+signer_t readSigner(const std::string& path)
+{
+    std::ifstream f(path);
+    std::string dsk, w;
+    signer_t s;
+    if (!(f >> dsk >> w >> s.n)) {
+        throw std::runtime_error("cannot read a signer from " + path);
+    }
+    fromHex(s.dsk.data(), s.dsk.size(), dsk);
+    fromHex(s.w.data(), s.w.size(), w);
+    return s;
+}
+
+// Sends as much of conn.out as the socket takes. Requires conn.writeLock.
+void flush(connection_t& conn)
+{
+    size_t sent = 0;
+    while (sent < conn.out.size()) {
+        ssize_t w = send(conn.fd, conn.out.data() + sent, conn.out.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (w <= 0) {
+            // the client is gone; its connection is dropped by the I/O thread
+            conn.broken = true;
+            conn.out.clear();
+            return;
+        }
+        sent += w;
+    }
+    conn.out.erase(conn.out.begin(), conn.out.begin() + sent);
+}
+
+void respond(connection_t& conn, uint32_t status, uint32_t id, const unsigned char* payload, size_t len)
+{
+    std::lock_guard<std::mutex> lock(conn.writeLock);
+    if (conn.broken) {
+        return;
+    }
+    bool queued = !conn.out.empty();
+    AccadProtocol::append(conn.out, status, id, payload, len);
+    if (!queued) {
+        flush(conn);
+    }
+    if (conn.out.size() > MAX_QUEUED) {
+        conn.broken = true;
+        conn.out.clear();
+        shutdown(conn.fd, SHUT_RDWR);
+    } else if (!queued && !conn.out.empty()) {
+        char c = 0;
+        ssize_t w = write(conn.wake, &c, 1);
+        (void) w;
+    }
+}
+
+void fail(const request_t& req, const std::string& message)
+{
+    respond(*req.conn, AccadProtocol::FAILED, req.id, reinterpret_cast<const unsigned char*>(message.data()), message.size());
+}
+
+void respond(const request_t& req, bool valid)
+{
+    respond(*req.conn, valid ? AccadProtocol::OK : AccadProtocol::INVALID, req.id, nullptr, 0);
+}
+
+class Daemon
+{
+public:
+    Daemon(const options_t& opt, const std::vector<signer_t>& signers)
+        : opt(opt), signers(signers), coalescer(std::chrono::microseconds(opt.window), opt.maxBatch),
+          done(false), nextItem(0), requests(0), batches(0), batchedItems(0) {
+        if (pipe2(wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+            throw std::runtime_error(std::string("pipe: ") + strerror(errno));
+        }
+    }
+    ~Daemon() {
+        close(wake[0]);
+        close(wake[1]);
+    }
+
+    void run(int listener) {
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < opt.threads; i++) {
+            workers.emplace_back(&Daemon::work, this);
+        }
+        try {
+            serve(listener);
+        } catch (...) {
+            stop(workers);
+            throw;
+        }
+        stop(workers);
+        drain();
+    }
+
+    void printStats() const {
+        std::cerr << "accad: " << requests << " requests, " << batches << " batches";
+        if (batches > 0) {
+            std::cerr << ", " << (double) batchedItems / batches << " items per batch";
+        }
+        std::cerr << std::endl;
+    }
+
+private:
+    const options_t& opt;
+    const std::vector<signer_t>& signers;
+
+    // owned by the I/O thread
+    Coalescer coalescer;
+    std::map<uint64_t, request_t> pending;
+    std::vector<std::shared_ptr<connection_t>> conns;
+    // the workers wake the I/O thread through this pipe when a connection has queued output
+    int wake[2];
+
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<job_t> jobs;
+    bool done;
+    uint64_t nextItem;
+
+    std::atomic<uint64_t> requests;
+    std::atomic<uint64_t> batches;
+    std::atomic<uint64_t> batchedItems;
+
+    void serve(int listener) {
+        sigset_t unblocked;
+        pthread_sigmask(SIG_SETMASK, nullptr, &unblocked);
+        sigdelset(&unblocked, SIGINT);
+        sigdelset(&unblocked, SIGTERM);
+        std::vector<pollfd> fds;
+        std::vector<Coalescer::group_t> groups;
+
+        while (!stopping) {
+            fds.assign(1, pollfd { listener, POLLIN, 0 });
+            fds.push_back(pollfd { wake[0], POLLIN, 0 });
+            for (const auto& c : conns) {
+                fds.push_back(pollfd { c->fd, (short) (POLLIN | (queued(*c) ? POLLOUT : 0)), 0 });
+            }
+            timespec timeout;
+            timespec* t = nullptr;
+            Coalescer::Clock::time_point deadline = coalescer.deadline();
+            if (deadline != Coalescer::Clock::time_point::max()) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Coalescer::Clock::now()).count();
+                ns = std::max<int64_t>(ns, 0);
+                timeout.tv_sec = ns / 1000000000;
+                timeout.tv_nsec = ns % 1000000000;
+                t = &timeout;
+            }
+            // SIGINT and SIGTERM are only delivered while waiting here.
+            if (ppoll(fds.data(), fds.size(), t, &unblocked) < 0 && errno != EINTR) {
+                throw std::runtime_error(std::string("poll: ") + strerror(errno));
+            }
+
+            if (fds[0].revents & POLLIN) {
+                accept(listener);
+            }
+            if (fds[1].revents & POLLIN) {
+                char buf[256];
+                while (read(wake[0], buf, sizeof buf) > 0) {
+                }
+            }
+            // conns only grows in accept, so fds[i + 2] still belongs to conns[i].
+            size_t polled = fds.size() - 2;
+            for (size_t i = polled; i-- > 0; ) {
+                short revents = fds[i + 2].revents;
+                if ((revents & POLLOUT) && !send(*conns[i])) {
+                    conns.erase(conns.begin() + i);
+                } else if ((revents & ~POLLOUT) && !receive(conns[i])) {
+                    conns.erase(conns.begin() + i);
+                }
+            }
+            groups.clear();
+            coalescer.release(groups, Coalescer::Clock::now());
+            dispatch(groups);
+        }
+        groups.clear();
+        coalescer.release(groups, Coalescer::Clock::now(), true);
+        dispatch(groups);
+    }
+
+    void accept(int listener) {
+        int fd;
+        while ((fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+            ucred cred;
+            socklen_t len = sizeof cred;
+            if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != geteuid()) {
+                close(fd);
+                continue;
+            }
+            conns.push_back(std::make_shared<connection_t>(fd, wake[1]));
+        }
+    }
+
+    static bool queued(connection_t& conn) {
+        std::lock_guard<std::mutex> l(conn.writeLock);
+        return !conn.out.empty();
+    }
+
+    // Sends the queued output of conn. Returns false once conn is broken.
+    static bool send(connection_t& conn) {
+        std::lock_guard<std::mutex> l(conn.writeLock);
+        flush(conn);
+        return !conn.broken;
+    }
+
+    // Sends the output still queued after the workers stopped, for up to DRAIN_MS.
+    void drain() {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(DRAIN_MS);
+        std::vector<pollfd> fds;
+        for (;;) {
+            fds.clear();
+            for (const auto& c : conns) {
+                if (queued(*c)) {
+                    fds.push_back(pollfd { c->fd, POLLOUT, 0 });
+                }
+            }
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (fds.empty() || left <= 0 || poll(fds.data(), fds.size(), left) < 0) {
+                return;
+            }
+            for (const auto& c : conns) {
+                send(*c);
+            }
+        }
+    }
+
+    // Reads all available requests from conn. Returns false once conn is closed or broken.
+    bool receive(const std::shared_ptr<connection_t>& conn) {
+        unsigned char buf[65536];
+        for (;;) {
+            ssize_t r = read(conn->fd, buf, sizeof buf);
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (r <= 0) {
+                return false;
+            }
+            conn->in.insert(conn->in.end(), buf, buf + r);
+        }
+
+        size_t pos = 0;
+        AccadProtocol::header_t header;
+        while (conn->in.size() - pos >= sizeof header) {
+            memcpy(&header, &conn->in[pos], sizeof header);
+            if (header.len > AccadProtocol::MAX_LEN) {
+                return false;
+            }
+            if (conn->in.size() - pos - sizeof header < header.len) {
+                break;
+            }
+            const unsigned char* payload = &conn->in[pos + sizeof header];
+            add(request_t { conn, header.code, header.id, std::vector<unsigned char>(payload, payload + header.len) });
+            pos += sizeof header + header.len;
+        }
+        conn->in.erase(conn->in.begin(), conn->in.begin() + pos);
+        return true;
+    }
+
+    void add(request_t&& req) {
+        requests++;
+        switch (req.type) {
+        case AccadProtocol::AUTHENTICATE:
+            push(job_t(1, std::move(req)));
+            return;
+        case AccadProtocol::VERIFY:
+            if (req.payload.size() < VERIFY_LEN) {
+                fail(req, "malformed request");
+                return;
+            }
+            // coalesced by verifier key
+            coalescer.add("v" + std::string(req.payload.begin(), req.payload.begin() + AccadProtocol::KEY_LEN), nextItem, Coalescer::Clock::now());
+            break;
+        case AccadProtocol::VERIFY_AGGREGATE:
+            coalescer.add("a", nextItem, Coalescer::Clock::now());
+            break;
+        default:
+            fail(req, "unknown request type");
+            return;
+        }
+        pending.insert(std::make_pair(nextItem++, std::move(req)));
+    }
+
+    void dispatch(std::vector<Coalescer::group_t>& groups) {
+        for (const auto& g : groups) {
+            job_t job;
+            job.reserve(g.items.size());
+            for (uint64_t item : g.items) {
+                auto it = pending.find(item);
+                job.push_back(std::move(it->second));
+                pending.erase(it);
+            }
+            push(std::move(job));
+        }
+    }
+
+    void push(job_t&& job) {
+        std::lock_guard<std::mutex> l(lock);
+        jobs.push_back(std::move(job));
+        ready.notify_one();
+    }
+
+    void stop(std::vector<std::thread>& workers) {
+        {
+            std::lock_guard<std::mutex> l(lock);
+            done = true;
+            ready.notify_all();
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    // Processes jobs until the daemon stops and all jobs are done.
+    void work() {
+        std::vector<std::unique_ptr<Authenticator>> signerCache(signers.size());
+        std::map<std::string, std::unique_ptr<Authenticator>> verifiers;
+        TokenBatch batch;
+        std::vector<Authenticator::ct_t> cts;
+        std::unique_ptr<bool[]> results(new bool[std::max<size_t>(1, opt.maxBatch)]);
+
+        for (;;) {
+            job_t job;
+            {
+                std::unique_lock<std::mutex> l(lock);
+                // not wait, for the same reason as in AsyncAuthenticator::run
+                while (!done && jobs.empty()) {
+                    ready.wait_for(l, std::chrono::hours(1));
+                }
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            if (job.size() > 1) {
+                batches++;
+                batchedItems += job.size();
+            }
+            try {
+                switch (job[0].type) {
+                case AccadProtocol::AUTHENTICATE:
+                    authenticate(job[0], signerCache);
+                    break;
+                case AccadProtocol::VERIFY:
+                    verify(job, verifiers, batch, cts, results.get());
+                    break;
+                case AccadProtocol::VERIFY_AGGREGATE:
+                    verifyAggregate(job, results.get());
+                    break;
+                }
+            } catch (const std::exception& e) {
+                for (const auto& req : job) {
+                    fail(req, e.what());
+                }
+            }
+        }
+    }
+
+    void authenticate(const request_t& req, std::vector<std::unique_ptr<Authenticator>>& cache) {
+        const std::vector<unsigned char>& p = req.payload;
+        uint32_t signer;
+        if (p.size() < 4 + Authenticator::CT_LEN) {
+            throw std::invalid_argument("malformed request");
+        }
+        memcpy(&signer, p.data(), 4);
+        if (signer >= signers.size()) {
+            throw std::invalid_argument("no such signer");
+        }
+        const signer_t& s = signers[signer];
+        if (!cache[signer]) {
+            cache[signer].reset(new Authenticator(s.dsk, s.w, s.n));
+        }
+        Authenticator::ct_t ct;
+        std::copy(p.begin() + 4, p.begin() + 4 + ct.size(), ct.begin());
+        Authenticator::st_t st(p.begin() + 4 + ct.size(), p.end());
+        Authenticator::token_t t;
+        cache[signer]->authenticate(t, ct, st, s.n);
+        respond(*req.conn, AccadProtocol::OK, req.id, reinterpret_cast<const unsigned char*>(&t), sizeof t);
+    }
+
+    // All requests in job have the same verifier key.
+    void verify(const job_t& job, std::map<std::string, std::unique_ptr<Authenticator>>& verifiers,
+                TokenBatch& batch, std::vector<Authenticator::ct_t>& cts, bool* results) {
+        const size_t depth = Authenticator::DEPTH;
+        const size_t chsLen = depth * ChameleonHash::HASH_LEN;
+        std::string key(job[0].payload.begin(), job[0].payload.begin() + AccadProtocol::KEY_LEN);
+        auto it = verifiers.find(key);
+        if (it == verifiers.end()) {
+            if (verifiers.size() >= MAX_VERIFIERS) {
+                verifiers.clear();
+            }
+            Authenticator::dpk_t dpk;
+            Authenticator::dw_t w;
+            AccadProtocol::getKey(dpk, w, job[0].payload.data());
+            it = verifiers.insert(std::make_pair(key, std::unique_ptr<Authenticator>(new Authenticator(dpk, w)))).first;
+        }
+        Authenticator& verifier = *it->second;
+
+        batch.reset();
+        cts.resize(job.size());
+        for (size_t i = 0; i < job.size(); i++) {
+            const unsigned char* p = job[i].payload.data() + AccadProtocol::KEY_LEN;
+            int32_t n;
+            memcpy(&n, p, 4);
+            std::copy(p + 4, p + 4 + Authenticator::CT_LEN, cts[i].begin());
+            const unsigned char* st = p + 4 + Authenticator::CT_LEN + Authenticator::TOKEN_LEN;
+            batch.add(st, job[i].payload.data() + job[i].payload.size() - st, n);
+        }
+        // The tokens are copied after all items are added, as adding may change the stride.
+        for (size_t i = 0; i < job.size(); i++) {
+            const unsigned char* token = job[i].payload.data() + AccadProtocol::KEY_LEN + 4 + Authenticator::CT_LEN;
+            for (size_t l = 0; l < depth; l++) {
+                memcpy(batch.chs(i)[l * batch.stride()].data(), token + l * ChameleonHash::HASH_LEN, ChameleonHash::HASH_LEN);
+                memcpy(batch.rs(i)[l * batch.stride()].data(), token + chsLen + l * ChameleonHash::RAND_LEN, ChameleonHash::RAND_LEN);
+            }
+        }
+        if (job.size() == 1) {
+            results[0] = verifier.verify(batch, 0, cts[0]);
+        } else {
+            try {
+                verifier.verifyBatch(batch, cts.data(), results);
+            } catch (const std::exception&) {
+                // A malformed token, e.g., with randomness out of range, fails only its own
+                // request, not the others of the batch.
+                for (size_t i = 0; i < job.size(); i++) {
+                    try {
+                        respond(job[i], verifier.verify(batch, i, cts[i]));
+                    } catch (const std::exception& e) {
+                        fail(job[i], e.what());
+                    }
+                }
+                return;
+            }
+        }
+        for (size_t i = 0; i < job.size(); i++) {
+            respond(job[i], results[i]);
+        }
+    }
+
+    void verifyAggregate(const job_t& job, bool* results) {
+        std::vector<AggregateProof> proofs;
+        std::vector<const AggregateProof*> ptrs;
+        std::vector<size_t> parsed;
+        proofs.reserve(job.size());
+        for (size_t i = 0; i < job.size(); i++) {
+            try {
+                proofs.push_back(AggregateProof::parse(job[i].payload));
+                parsed.push_back(i);
+            } catch (const std::exception& e) {
+                fail(job[i], e.what());
+            }
+        }
+        for (const auto& p : proofs) {
+            ptrs.push_back(&p);
+        }
+        try {
+            AggregateProof::verify(ptrs.data(), ptrs.size(), results);
+        } catch (const std::exception&) {
+            // as in verify, only the malformed proof fails
+            for (size_t j = 0; j < parsed.size(); j++) {
+                try {
+                    AggregateProof::verify(&ptrs[j], 1, &results[j]);
+                    respond(job[parsed[j]], results[j]);
+                } catch (const std::exception& e) {
+                    fail(job[parsed[j]], e.what());
+                }
+            }
+            return;
+        }
+        for (size_t j = 0; j < parsed.size(); j++) {
+            respond(job[parsed[j]], results[j]);
+        }
+    }
+};
+
+void parse(options_t& opt, int argc, char** argv)
+{
+    std::string value;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (option(arg, "--socket", value)) {
+            opt.socket = value;
+        } else if (option(arg, "--window", value)) {
+            opt.window = std::stoul(value);
+        } else if (option(arg, "--max-batch", value)) {
+            opt.maxBatch = std::max(1ul, std::stoul(value));
+        } else if (option(arg, "--threads", value)) {
+            opt.threads = std::max(1ul, std::stoul(value));
+        } else if (option(arg, "--plan", value)) {
+            opt.plan = value;
+        } else if (option(arg, "--signer", value)) {
+            opt.signers.push_back(value);
+        } else {
+            throw std::invalid_argument(std::string("unknown option ") + arg);
+        }
+    }
+}
+
+int listen(const std::string& path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path) {
+        throw std::invalid_argument("socket path too long");
+    }
+    strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("socket: ") + strerror(errno));
+    }
+    // Only a socket file left behind by a daemon that did not shut down cleanly is removed,
+    // not that of a running daemon or any other file.
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            close(fd);
+            throw std::runtime_error(path + " exists and is not a socket");
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool running = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0;
+        if (probe >= 0) {
+            close(probe);
+        }
+        if (running) {
+            close(fd);
+            throw std::runtime_error("another daemon is listening on " + path);
+        }
+        unlink(path.c_str());
+    }
+    mode_t mask = umask(077);
+    int bound = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+    umask(mask);
+    if (bound != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        std::string err = strerror(errno);
+        close(fd);
+        throw std::runtime_error("cannot listen on " + path + ": " + err);
+    }
+    return fd;
+}
+
+// $XDG_RUNTIME_DIR/accad.sock, or else /tmp/accad-<uid>/accad.sock in a directory only the
+// user may enter.
+std::string defaultSocket()
+{
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        return std::string(runtime) + "/accad.sock";
+    }
+    std::string dir = "/tmp/accad-" + std::to_string(getuid());
+    if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        throw std::runtime_error("cannot create " + dir + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077) != 0) {
+        throw std::runtime_error(dir + " is not a private directory of this user");
+    }
+    return dir + "/accad.sock";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    options_t opt;
+    opt.window = 200;
+    opt.maxBatch = 64;
+    opt.threads = 0;
+
+    try {
+        parse(opt, argc, argv);
+        if (opt.socket.empty()) {
+            opt.socket = defaultSocket();
+        }
+        if (!opt.plan.empty()) {
+            Plan::setCurrent(Plan::load(opt.plan));
+        }
+        if (opt.threads == 0) {
+            opt.threads = Plan::current().threads;
+        }
+        std::vector<signer_t> signers;
+        for (const auto& path : opt.signers) {
+            signers.push_back(readSigner(path));
+        }
+
+        // Block SIGINT and SIGTERM everywhere but in ppoll, so that they cannot be lost
+        // between checking for them and waiting. The workers inherit the mask.
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+        struct sigaction sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sa_handler = onSignal;
+        sigaction(SIGINT, &sa, nullptr);
+        sigaction(SIGTERM, &sa, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+
+        int listener = listen(opt.socket);
+        std::cerr << "accad: listening on " << opt.socket << " with " << signers.size() << " signers" << std::endl;
+        Daemon daemon(opt, signers);
+        try {
+            daemon.run(listener);
+        } catch (...) {
+            close(listener);
+            unlink(opt.socket.c_str());
+            throw;
+        }
+        close(listener);
+        unlink(opt.socket.c_str());
+        daemon.printStats();
+    } catch (const std::exception& e) {
+        std::cerr << "accad: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
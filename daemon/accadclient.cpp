@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "accadclient.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+AccadClient::AccadClient(const std::string& path) : nextId(1)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path) {
+        throw std::invalid_argument("socket path too long");
+    }
+    strcpy(addr.sun_path, path.c_str());
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+        std::string err = strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error("cannot connect to " + path + ": " + err);
+    }
+}
+
+AccadClient::~AccadClient()
+{
+    close(fd);
+}
+
+uint32_t AccadClient::send(AccadProtocol::Type type)
+{
+    uint32_t id = nextId++;
+    AccadProtocol::write(fd, type, id, buf.data(), buf.size());
+    return id;
+}
+
+uint32_t AccadClient::sendAuthenticate(uint32_t signer, const Authenticator::ct_t& ct, const Authenticator::st_t& st)
+{
+    buf.assign(reinterpret_cast<const unsigned char*>(&signer), reinterpret_cast<const unsigned char*>(&signer) + 4);
+    buf.insert(buf.end(), ct.begin(), ct.end());
+    buf.insert(buf.end(), st.begin(), st.end());
+    return send(AccadProtocol::AUTHENTICATE);
+}
+
+uint32_t AccadClient::sendVerify(const Authenticator::dpk_t& dpk, const Authenticator::dw_t& w, int n,
+                                 const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st)
+{
+    buf.clear();
+    AccadProtocol::putKey(buf, dpk, w);
+    int32_t n32 = n;
+    buf.insert(buf.end(), reinterpret_cast<const unsigned char*>(&n32), reinterpret_cast<const unsigned char*>(&n32) + 4);
+    buf.insert(buf.end(), ct.begin(), ct.end());
+    buf.insert(buf.end(), reinterpret_cast<const unsigned char*>(&t), reinterpret_cast<const unsigned char*>(&t) + sizeof t);
+    buf.insert(buf.end(), st.begin(), st.end());
+    return send(AccadProtocol::VERIFY);
+}
+
+uint32_t AccadClient::sendVerifys(const AggregateProof& proof)
+{
+    buf.clear();
+    proof.serialize(buf);
+    return send(AccadProtocol::VERIFY_AGGREGATE);
+}
+
+uint32_t AccadClient::receive(AccadProtocol::Status& status, std::vector<unsigned char>& payload)
+{
+    AccadProtocol::header_t header;
+    if (!AccadProtocol::readAll(fd, &header, sizeof header)) {
+        throw std::runtime_error("accad closed the connection");
+    }
+    if (header.len > AccadProtocol::MAX_LEN) {
+        throw std::runtime_error("response too long");
+    }
+    payload.resize(header.len);
+    if (header.len > 0 && !AccadProtocol::readAll(fd, payload.data(), header.len)) {
+        throw std::runtime_error("accad closed the connection");
+    }
+    status = (AccadProtocol::Status) header.code;
+    return header.id;
+}
+
+bool AccadClient::wait(uint32_t id, std::vector<unsigned char>& payload)
+{
+    AccadProtocol::Status status;
+    if (receive(status, payload) != id) {
+        throw std::logic_error("response to an unexpected request");
+    }
+    if (status == AccadProtocol::FAILED) {
+        throw std::runtime_error("accad: " + std::string(payload.begin(), payload.end()));
+    }
+    return status == AccadProtocol::OK;
+}
+
+void AccadClient::authenticate(Authenticator::token_t& t, uint32_t signer, const Authenticator::ct_t& ct, const Authenticator::st_t& st)
+{
+    std::vector<unsigned char> payload;
+    if (!wait(sendAuthenticate(signer, ct, st), payload) || payload.size() != sizeof t) {
+        throw std::runtime_error("accad returned no token");
+    }
+    memcpy(&t, payload.data(), sizeof t);
+}
+
+bool AccadClient::verify(const Authenticator::dpk_t& dpk, const Authenticator::dw_t& w, int n,
+                         const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st)
+{
+    std::vector<unsigned char> payload;
+    return wait(sendVerify(dpk, w, n, t, ct, st), payload);
+}
+
+bool AccadClient::verifys(const AggregateProof& proof)
+{
+    std::vector<unsigned char> payload;
+    return wait(sendVerifys(proof), payload);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef ACCADCLIENT_H
+#define ACCADCLIENT_H
+
+#include "accadprotocol.h"
+#include "../aggregateproof.h"
+
+#include <string>
+#include <vector>
+
+// Connection to accad. The send functions queue a request and return its id without waiting;
+// receive returns the next response, which may belong to any outstanding request. The other
+// functions send one request and wait for its response, and must not be mixed with
+// outstanding asynchronous requests. Errors reported by the daemon are thrown as
+// std::runtime_error.
+class AccadClient
+{
+public:
+    explicit AccadClient(const std::string& path);
+    ~AccadClient();
+
+    uint32_t sendAuthenticate(uint32_t signer, const Authenticator::ct_t& ct, const Authenticator::st_t& st);
+    uint32_t sendVerify(const Authenticator::dpk_t& dpk, const Authenticator::dw_t& w, int n,
+                        const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st);
+    uint32_t sendVerifys(const AggregateProof& proof);
+    // Waits for the next response and returns the id of its request.
+    uint32_t receive(AccadProtocol::Status& status, std::vector<unsigned char>& payload);
+
+    void authenticate(Authenticator::token_t& t, uint32_t signer, const Authenticator::ct_t& ct, const Authenticator::st_t& st);
+    bool verify(const Authenticator::dpk_t& dpk, const Authenticator::dw_t& w, int n,
+                const Authenticator::token_t& t, const Authenticator::ct_t& ct, const Authenticator::st_t& st);
+    bool verifys(const AggregateProof& proof);
+
+private:
+    int fd;
+    uint32_t nextId;
+    std::vector<unsigned char> buf;
+
+    uint32_t send(AccadProtocol::Type type);
+    // Waits for the response to id and returns whether it is OK; throws on FAILED.
+    bool wait(uint32_t id, std::vector<unsigned char>& payload);
+
+    AccadClient(const AccadClient&);
+    AccadClient& operator=(const AccadClient&);
+};
+
+#endif // ACCADCLIENT_H
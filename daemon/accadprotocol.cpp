@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "accadprotocol.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void sendAll(int fd, const unsigned char* p, size_t len)
+{
+    while (len > 0) {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd pfd = { fd, POLLOUT, 0 };
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        if (w <= 0) {
+            throw std::runtime_error(std::string("cannot send: ") + strerror(errno));
+        }
+        p += w;
+        len -= w;
+    }
+}
+
+}
+
+void AccadProtocol::putKey(std::vector<unsigned char>& out, const Authenticator::dpk_t& dpk, const Authenticator::dw_t& w)
+{
+    if (dpk.chpk.size() != PK_LEN) {
+        throw std::invalid_argument("the public key must be compressed");
+    }
+    out.insert(out.end(), dpk.chpk.begin(), dpk.chpk.end());
+    out.insert(out.end(), dpk.rootDigest.begin(), dpk.rootDigest.end());
+    out.push_back(dpk.suite);
+    out.push_back(dpk.derivation);
+    out.insert(out.end(), w.begin(), w.end());
+}
+
+void AccadProtocol::getKey(Authenticator::dpk_t& dpk, Authenticator::dw_t& w, const unsigned char* in)
+{
+    dpk.chpk.assign(in, in + PK_LEN);
+    in += PK_LEN;
+    std::copy(in, in + dpk.rootDigest.size(), dpk.rootDigest.begin());
+    in += dpk.rootDigest.size();
+    dpk.suite = (Suite) *in++;
+    dpk.derivation = (Derivation) *in++;
+    std::copy(in, in + w.size(), w.begin());
+}
+
+void AccadProtocol::append(std::vector<unsigned char>& out, uint32_t code, uint32_t id, const unsigned char* payload, size_t len)
+{
+    if (len > MAX_LEN) {
+        throw std::invalid_argument("message too long");
+    }
+    header_t header = { code, id, (uint32_t) len };
+    const unsigned char* h = reinterpret_cast<const unsigned char*>(&header);
+    out.insert(out.end(), h, h + sizeof header);
+    out.insert(out.end(), payload, payload + len);
+}
+
+void AccadProtocol::write(int fd, uint32_t code, uint32_t id, const unsigned char* payload, size_t len)
+{
+    if (len > MAX_LEN) {
+        throw std::invalid_argument("message too long");
+    }
+    header_t header = { code, id, (uint32_t) len };
+    sendAll(fd, reinterpret_cast<const unsigned char*>(&header), sizeof header);
+    sendAll(fd, payload, len);
+}
+
+bool AccadProtocol::readAll(int fd, void* buf, size_t len)
+{
+    unsigned char* p = static_cast<unsigned char*>(buf);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t r = read(fd, p + done, len - done);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r < 0) {
+            throw std::runtime_error(std::string("cannot receive: ") + strerror(errno));
+        }
+        if (r == 0) {
+            if (done == 0) {
+                return false;
+            }
+            throw std::runtime_error("connection closed in the middle of a message");
+        }
+        done += r;
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef ACCADPROTOCOL_H
+#define ACCADPROTOCOL_H
+
+#include "../authenticator.h"
+
+#include <stdint.h>
+#include <vector>
+
+// Messages between accad and its clients on a Unix stream socket. Every message is a header
+// followed by len bytes of payload, all integers in host byte order. A client may send many
+// requests without waiting; every response carries the id of its request, and responses can
+// arrive in any order.
+//
+// Request payloads:
+//   AUTHENTICATE      signer (4) || ct || st            -> OK with the token (chs || rs)
+//   VERIFY            key || n (4) || ct || token || st  -> OK or INVALID
+//   VERIFY_AGGREGATE  AggregateProof::serialize           -> OK or INVALID
+// where key is the compressed chpk (33) || rootDigest (32) || suite (1) || derivation (1) ||
+// w (32) of the verifier, and signer is the index of a key the daemon was started with.
+// FAILED responses carry an error message.
+class AccadProtocol
+{
+public:
+    enum Type : uint32_t {
+        AUTHENTICATE = 1,
+        VERIFY = 2,
+        VERIFY_AGGREGATE = 3
+    };
+
+    enum Status : uint32_t {
+        OK = 0,
+        INVALID = 1,
+        FAILED = 2
+    };
+
+    struct header_t {
+        // Type in requests, Status in responses
+        uint32_t code;
+        uint32_t id;
+        uint32_t len;
+    };
+
+    static const size_t PK_LEN = 33;
+    static const size_t KEY_LEN = PK_LEN + ChameleonHash::MESG_LEN + 2 + ChameleonHash::W_LEN;
+    static const uint32_t MAX_LEN = 64 << 20;
+
+    static void putKey(std::vector<unsigned char>& out, const Authenticator::dpk_t& dpk, const Authenticator::dw_t& w);
+    // Reads KEY_LEN bytes.
+    static void getKey(Authenticator::dpk_t& dpk, Authenticator::dw_t& w, const unsigned char* in);
+
+    // Appends a whole message to out, for senders that cannot wait for the socket.
+    static void append(std::vector<unsigned char>& out, uint32_t code, uint32_t id, const unsigned char* payload, size_t len);
+    // Writes a whole message; waits while a non-blocking socket is full.
+    static void write(int fd, uint32_t code, uint32_t id, const unsigned char* payload, size_t len);
+    // Reads len bytes. Returns false on end of file before the first byte.
+    static bool readAll(int fd, void* buf, size_t len);
+};
+
+#endif // ACCADPROTOCOL_H
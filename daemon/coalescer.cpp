@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "coalescer.h"
+
+#include <algorithm>
+
+Coalescer::Coalescer(std::chrono::microseconds maxWindow, size_t maxBatch)
+    : maxWindow(maxWindow), maxBatch(std::max<size_t>(1, maxBatch)), gap(1e18)
+{
+}
+
+void Coalescer::add(const std::string& key, uint64_t item, Clock::time_point now)
+{
+    if (last != Clock::time_point()) {
+        double g = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+        gap = gap >= 1e18 ? g : gap + (g - gap) / 8;
+    }
+    last = now;
+
+    pending_t& p = groups[key];
+    p.items.push_back(item);
+    p.arrivals.push_back(now);
+}
+
+std::chrono::nanoseconds Coalescer::window() const
+{
+    if (gap >= maxWindow.count()) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::min(maxWindow, std::chrono::nanoseconds((int64_t) (gap * (maxBatch - 1))));
+}
+
+void Coalescer::release(std::vector<group_t>& out, Clock::time_point now, bool all)
+{
+    std::chrono::nanoseconds w = window();
+    for (auto it = groups.begin(); it != groups.end(); ) {
+        pending_t& p = it->second;
+        // full batches right away, and the rest once its oldest item is due
+        while (!p.items.empty()) {
+            if (p.items.size() < maxBatch && !all && now < p.arrivals.front() + w) {
+                break;
+            }
+            size_t cnt = std::min(maxBatch, p.items.size());
+            out.push_back(group_t { it->first, std::vector<uint64_t>(p.items.begin(), p.items.begin() + cnt) });
+            p.items.erase(p.items.begin(), p.items.begin() + cnt);
+            p.arrivals.erase(p.arrivals.begin(), p.arrivals.begin() + cnt);
+        }
+        if (p.items.empty()) {
+            it = groups.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+Coalescer::Clock::time_point Coalescer::deadline() const
+{
+    Clock::time_point d = Clock::time_point::max();
+    std::chrono::nanoseconds w = window();
+    for (const auto& g : groups) {
+        d = std::min(d, std::chrono::time_point_cast<Clock::duration>(g.second.arrivals.front() + w));
+    }
+    return d;
+}
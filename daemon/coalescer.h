@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef COALESCER_H
+#define COALESCER_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+// Groups requests that can be processed together, e.g., verifications under the same key.
+// A group is released when it holds maxBatch items or when its oldest item has waited for
+// the current window. The window follows the load: it is the time that maxBatch - 1 further
+// requests take at the average gap between arrivals, capped at maxWindow, and zero while
+// that gap is longer than maxWindow, so that sparse requests are never held back.
+class Coalescer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct group_t {
+        std::string key;
+        std::vector<uint64_t> items;
+    };
+
+    Coalescer(std::chrono::microseconds maxWindow, size_t maxBatch);
+
+    void add(const std::string& key, uint64_t item, Clock::time_point now);
+    // Appends the groups that are due at now to out, or all groups if all is set.
+    void release(std::vector<group_t>& out, Clock::time_point now, bool all = false);
+    // When the next group becomes due, or Clock::time_point::max() if none is pending.
+    Clock::time_point deadline() const;
+    std::chrono::nanoseconds window() const;
+
+private:
+    struct pending_t {
+        std::vector<uint64_t> items;
+        // when each item arrived
+        std::vector<Clock::time_point> arrivals;
+    };
+
+    std::chrono::nanoseconds maxWindow;
+    size_t maxBatch;
+    std::map<std::string, pending_t> groups;
+    // moving average of the time between arrivals in nanoseconds
+    double gap;
+    Clock::time_point last;
+};
+
+#endif // COALESCER_H
@@ -0,0 +1,675 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ecmultlanes.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ACCA_ECMULT_LANES
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint64_t M52 = 0xFFFFFFFFFFFFFULL;
+
+// Limbs are the 52-bit digits of a value below 2^260; the value need not be reduced modulo p.
+typedef uint64_t limbs_t[5];
+
+void limbsFromFe(limbs_t l, const secp256k1_fe_t& a)
+{
+    secp256k1_fe_t n = a;
+    unsigned char b[32];
+    secp256k1_fe_normalize(&n);
+    secp256k1_fe_get_b32(b, &n);
+    uint64_t w[4];
+    for (size_t i = 0; i < 4; i++) {
+        w[i] = 0;
+        for (size_t j = 0; j < 8; j++) {
+            w[i] |= (uint64_t) b[31 - 8 * i - j] << (8 * j);
+        }
+    }
+    l[0] = w[0] & M52;
+    l[1] = ((w[0] >> 52) | (w[1] << 12)) & M52;
+    l[2] = ((w[1] >> 40) | (w[2] << 24)) & M52;
+    l[3] = ((w[2] >> 28) | (w[3] << 36)) & M52;
+    l[4] = w[3] >> 16;
+}
+
+// Reduces modulo p; returns whether the value is zero.
+bool limbsToFe(secp256k1_fe_t& r, const limbs_t l)
+{
+    typedef unsigned __int128 u128;
+    uint64_t w[4] = {
+        l[0] | (l[1] << 52),
+        (l[1] >> 12) | (l[2] << 40),
+        (l[2] >> 24) | (l[3] << 28),
+        (l[3] >> 36) | (l[4] << 16)
+    };
+    // fold the bits above 2^256 with 2^256 = 0x1000003D1 (mod p), at most twice
+    uint64_t top = l[4] >> 48;
+    while (top) {
+        u128 acc = (u128) top * 0x1000003D1ULL;
+        for (size_t i = 0; i < 4; i++) {
+            acc += w[i];
+            w[i] = (uint64_t) acc;
+            acc >>= 64;
+        }
+        top = (uint64_t) acc;
+    }
+    const uint64_t P0 = 0xFFFFFFFEFFFFFC2FULL;
+    if (w[3] == ~0ULL && w[2] == ~0ULL && w[1] == ~0ULL && w[0] >= P0) {
+        // subtract p, i.e., add 2^256 - p and drop the carry
+        w[0] -= P0;
+        w[1] = w[2] = w[3] = 0;
+    }
+    unsigned char b[32];
+    for (size_t i = 0; i < 4; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            b[31 - 8 * i - j] = w[i] >> (8 * j);
+        }
+    }
+    secp256k1_fe_set_b32(&r, b);
+    return (w[0] | w[1] | w[2] | w[3]) == 0;
+}
+
+void buildTable(EcmultLanes::table_t& t, const secp256k1_ge_t& p, size_t n, int node)
+{
+    t.n = n;
+    t.x = std::vector<uint64_t, NodeAllocator<uint64_t>>(5 * n, 0, NodeAllocator<uint64_t>(node));
+    t.y = std::vector<uint64_t, NodeAllocator<uint64_t>>(5 * n, 0, NodeAllocator<uint64_t>(node));
+    secp256k1_gej_t m;
+    secp256k1_gej_set_ge(&m, &p);
+    for (size_t i = 0; i < n; i++) {
+        secp256k1_ge_t ge;
+        secp256k1_ge_set_gej(&ge, &m);
+        limbs_t x, y;
+        limbsFromFe(x, ge.x);
+        limbsFromFe(y, ge.y);
+        for (size_t l = 0; l < 5; l++) {
+            t.x[l * n + i] = x[l];
+            t.y[l * n + i] = y[l];
+        }
+        secp256k1_gej_add_ge_var(&m, &m, &p);
+    }
+}
+
+// Signed fixed-window recoding: k = sum(d[i] * 2^(w * i)) with -2^(w-1) < d[i] <= 2^(w-1).
+// Writes ceil(256 / w) + 1 digits.
+void recode(int64_t* d, size_t stride, const secp256k1_scalar_t& k, int w)
+{
+    unsigned char b[32];
+    secp256k1_scalar_get_b32(b, &k);
+    int64_t carry = 0;
+    size_t digits = (256 + w - 1) / w + 1;
+    for (size_t i = 0; i < digits; i++) {
+        int64_t bits = 0;
+        for (int j = w - 1; j >= 0; j--) {
+            size_t bit = i * w + j;
+            bits <<= 1;
+            if (bit < 256) {
+                bits |= (b[31 - bit / 8] >> (bit % 8)) & 1;
+            }
+        }
+        bits += carry;
+        carry = bits > (1 << (w - 1));
+        d[i * stride] = carry ? bits - (1 << w) : bits;
+    }
+}
+
+#ifdef ACCA_ECMULT_LANES
+
+#define ACCA_IFMA __attribute__((target("avx512f,avx512ifma"), always_inline)) inline
+
+struct fe8 {
+    __m512i n[5];
+};
+
+struct gej8 {
+    fe8 x, y, z;
+};
+
+ACCA_IFMA __m512i madd52lo(__m512i a, __m512i b, __m512i c)
+{
+    return _mm512_madd52lo_epu64(a, b, c);
+}
+
+ACCA_IFMA __m512i madd52hi(__m512i a, __m512i b, __m512i c)
+{
+    return _mm512_madd52hi_epu64(a, b, c);
+}
+
+// Brings limbs below 2^63 back to 52 bits. The value stays below 2^260, so the result is a
+// valid input to mul.
+ACCA_IFMA void normalize(fe8& a)
+{
+    const __m512i m = _mm512_set1_epi64(M52);
+    const __m512i r = _mm512_set1_epi64(0x1000003D10ULL); // 2^260 mod p
+    for (int round = 0; round < 2; round++) {
+        for (size_t i = 0; i < 4; i++) {
+            a.n[i + 1] = _mm512_add_epi64(a.n[i + 1], _mm512_srli_epi64(a.n[i], 52));
+            a.n[i] = _mm512_and_si512(a.n[i], m);
+        }
+        __m512i top = _mm512_srli_epi64(a.n[4], 52);
+        a.n[4] = _mm512_and_si512(a.n[4], m);
+        // top < 2^11, so the product fits into 52 bits. In the second round, top is 1 only if
+        // the first round wrapped around 2^260, and then a.n[0] is small.
+        a.n[0] = madd52lo(a.n[0], top, r);
+    }
+}
+
+ACCA_IFMA void mul(fe8& r, const fe8& a, const fe8& b)
+{
+    const __m512i m = _mm512_set1_epi64(M52);
+    const __m512i red = _mm512_set1_epi64(0x1000003D10ULL);
+    __m512i c[10];
+    for (size_t i = 0; i < 10; i++) {
+        c[i] = _mm512_setzero_si512();
+    }
+    // column i + j receives the low and column i + j + 1 the high 52 bits of a_i * b_j
+    for (size_t i = 0; i < 5; i++) {
+        for (size_t j = 0; j < 5; j++) {
+            c[i + j] = madd52lo(c[i + j], a.n[i], b.n[j]);
+            c[i + j + 1] = madd52hi(c[i + j + 1], a.n[i], b.n[j]);
+        }
+    }
+    // The product is below 2^520, so after carrying, the ten limbs hold it exactly.
+    for (size_t i = 0; i < 9; i++) {
+        c[i + 1] = _mm512_add_epi64(c[i + 1], _mm512_srli_epi64(c[i], 52));
+        c[i] = _mm512_and_si512(c[i], m);
+    }
+    // fold limbs 5 to 9 with 2^260 = 0x1000003D10 (mod p); t5 has weight 2^260 again
+    __m512i t[6] = { c[0], c[1], c[2], c[3], c[4], _mm512_setzero_si512() };
+    for (size_t k = 5; k < 10; k++) {
+        t[k - 5] = madd52lo(t[k - 5], c[k], red);
+        t[k - 4] = madd52hi(t[k - 4], c[k], red);
+    }
+    t[0] = madd52lo(t[0], t[5], red);
+    t[1] = madd52hi(t[1], t[5], red);
+    for (size_t i = 0; i < 5; i++) {
+        r.n[i] = t[i];
+    }
+    normalize(r);
+}
+
+ACCA_IFMA void sqr(fe8& r, const fe8& a)
+{
+    mul(r, a, a);
+}
+
+ACCA_IFMA void add(fe8& r, const fe8& a, const fe8& b)
+{
+    for (size_t i = 0; i < 5; i++) {
+        r.n[i] = _mm512_add_epi64(a.n[i], b.n[i]);
+    }
+    normalize(r);
+}
+
+// Limbs of 32 * p. Every limb exceeds 2^52, so subtracting a normalized limb cannot underflow.
+ACCA_IFMA __m512i p32(size_t i)
+{
+    static const uint64_t P[5] = {
+        0xFFFFEFFFFFC2FULL << 5, M52 << 5, M52 << 5, M52 << 5, 0xFFFFFFFFFFFFULL << 5
+    };
+    return _mm512_set1_epi64(P[i]);
+}
+
+ACCA_IFMA void sub(fe8& r, const fe8& a, const fe8& b)
+{
+    for (size_t i = 0; i < 5; i++) {
+        r.n[i] = _mm512_sub_epi64(_mm512_add_epi64(a.n[i], p32(i)), b.n[i]);
+    }
+    normalize(r);
+}
+
+ACCA_IFMA void neg(fe8& r, const fe8& a)
+{
+    for (size_t i = 0; i < 5; i++) {
+        r.n[i] = _mm512_sub_epi64(p32(i), a.n[i]);
+    }
+    normalize(r);
+}
+
+// r = 2^s * a for s <= 3
+ACCA_IFMA void shl(fe8& r, const fe8& a, int s)
+{
+    for (size_t i = 0; i < 5; i++) {
+        r.n[i] = _mm512_slli_epi64(a.n[i], s);
+    }
+    normalize(r);
+}
+
+ACCA_IFMA void blend(fe8& r, __mmask8 mask, const fe8& a)
+{
+    for (size_t i = 0; i < 5; i++) {
+        r.n[i] = _mm512_mask_blend_epi64(mask, r.n[i], a.n[i]);
+    }
+}
+
+// dbl-2009-l from the Explicit-Formulas Database
+ACCA_IFMA void gejDouble(gej8& r, const gej8& p)
+{
+    fe8 a, b, c, d, e, f, t;
+    mul(r.z, p.y, p.z);
+    shl(r.z, r.z, 1);
+    sqr(a, p.x);
+    sqr(b, p.y);
+    sqr(c, b);
+    add(t, p.x, b);
+    sqr(t, t);
+    sub(t, t, a);
+    sub(t, t, c);
+    shl(d, t, 1);
+    add(e, a, a);
+    add(e, e, a);
+    sqr(f, e);
+    shl(t, d, 1);
+    sub(r.x, f, t);
+    sub(t, d, r.x);
+    mul(t, e, t);
+    shl(c, c, 3);
+    sub(r.y, t, c);
+}
+
+// madd-2007-bl from the Explicit-Formulas Database. If p = +-(x, y), the result has z = 0.
+ACCA_IFMA void gejAddGe(gej8& r, const gej8& p, const fe8& x, const fe8& y)
+{
+    fe8 z1z1, u2, s2, h, hh, i, j, rr, v, t;
+    sqr(z1z1, p.z);
+    mul(u2, x, z1z1);
+    mul(s2, y, p.z);
+    mul(s2, s2, z1z1);
+    sub(h, u2, p.x);
+    sqr(hh, h);
+    shl(i, hh, 2);
+    mul(j, h, i);
+    sub(rr, s2, p.y);
+    shl(rr, rr, 1);
+    mul(v, p.x, i);
+
+    fe8 y1j;
+    mul(y1j, p.y, j);
+    shl(y1j, y1j, 1);
+
+    add(t, p.z, h);
+    sqr(t, t);
+    sub(t, t, z1z1);
+    sub(r.z, t, hh);
+
+    sqr(t, rr);
+    sub(t, t, j);
+    sub(t, t, v);
+    sub(r.x, t, v);
+
+    sub(t, v, r.x);
+    mul(t, rr, t);
+    sub(r.y, t, y1j);
+}
+
+ACCA_IFMA void load(fe8& r, const uint64_t (*l)[EcmultLanes::LANES])
+{
+    for (size_t i = 0; i < 5; i++) {
+        r.n[i] = _mm512_loadu_si512(l[i]);
+    }
+}
+
+ACCA_IFMA void store(uint64_t (*l)[EcmultLanes::LANES], const fe8& a)
+{
+    for (size_t i = 0; i < 5; i++) {
+        _mm512_storeu_si512(l[i], a.n[i]);
+    }
+}
+
+void toLanes(uint64_t (*l)[EcmultLanes::LANES], const secp256k1_fe_t* a)
+{
+    for (size_t j = 0; j < EcmultLanes::LANES; j++) {
+        limbs_t t;
+        limbsFromFe(t, a[j]);
+        for (size_t i = 0; i < 5; i++) {
+            l[i][j] = t[i];
+        }
+    }
+}
+
+bool fromLane(secp256k1_fe_t& r, const uint64_t (*l)[EcmultLanes::LANES], size_t j)
+{
+    limbs_t t;
+    for (size_t i = 0; i < 5; i++) {
+        t[i] = l[i][j];
+    }
+    return limbsToFe(r, t);
+}
+
+// Adds the table entries selected by the digits d of all lanes to acc. Lanes with digit 0 keep
+// their value, and lanes that are still at infinity take the entry.
+ACCA_IFMA void addDigits(gej8& acc, __mmask8& inf, const int64_t* d, const EcmultLanes::table_t& t)
+{
+    __m512i digits = _mm512_loadu_si512(d);
+    __mmask8 nz = _mm512_test_epi64_mask(digits, digits);
+    if (!nz) {
+        return;
+    }
+    __m512i idx = _mm512_sub_epi64(_mm512_abs_epi64(digits), _mm512_set1_epi64(1));
+    fe8 x, y, ny;
+    for (size_t i = 0; i < 5; i++) {
+        x.n[i] = _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), nz, idx, &t.x[i * t.n], 8);
+        y.n[i] = _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), nz, idx, &t.y[i * t.n], 8);
+    }
+    neg(ny, y);
+    blend(y, _mm512_cmplt_epi64_mask(digits, _mm512_setzero_si512()), ny);
+
+    gej8 sum;
+    gejAddGe(sum, acc, x, y);
+    __mmask8 start = nz & inf;
+    __mmask8 update = nz & ~inf;
+    blend(acc.x, update, sum.x);
+    blend(acc.y, update, sum.y);
+    blend(acc.z, update, sum.z);
+    fe8 one;
+    one.n[0] = _mm512_set1_epi64(1);
+    for (size_t i = 1; i < 5; i++) {
+        one.n[i] = _mm512_setzero_si512();
+    }
+    blend(acc.x, start, x);
+    blend(acc.y, start, y);
+    blend(acc.z, start, one);
+    inf &= ~nz;
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+void ecmultLanes(secp256k1_gej_t* r, const secp256k1_gej_t& a, const EcmultLanes::table_t& tableA, const EcmultLanes::table_t& tableG,
+                 const secp256k1_scalar_t* na, const secp256k1_scalar_t* ng, size_t cnt)
+{
+    const size_t LANES = EcmultLanes::LANES;
+    const int WA = EcmultLanes::A_WINDOW, WG = EcmultLanes::G_WINDOW;
+    const size_t DIGITS_A = (256 + WA - 1) / WA + 1, DIGITS_G = (256 + WG - 1) / WG + 1;
+
+    // digit i of lane j at d[i][j]; unused lanes get zero scalars
+    int64_t dA[DIGITS_A][LANES], dG[DIGITS_G][LANES];
+    secp256k1_scalar_t zero;
+    secp256k1_scalar_clear(&zero);
+    for (size_t j = 0; j < LANES; j++) {
+        recode(&dA[0][j], LANES, j < cnt ? na[j] : zero, WA);
+        recode(&dG[0][j], LANES, j < cnt ? ng[j] : zero, WG);
+    }
+
+    gej8 acc;
+    memset(&acc, 0, sizeof acc);
+    __mmask8 inf = 0xFF;
+    int top = std::max(DIGITS_A * WA, DIGITS_G * WG) - 1;
+    for (int bit = top; bit >= 0; bit--) {
+        if (inf != 0xFF) {
+            gejDouble(acc, acc);
+        }
+        if (bit % WA == 0 && (size_t) (bit / WA) < DIGITS_A) {
+            addDigits(acc, inf, dA[bit / WA], tableA);
+        }
+        if (bit % WG == 0 && (size_t) (bit / WG) < DIGITS_G) {
+            addDigits(acc, inf, dG[bit / WG], tableG);
+        }
+    }
+
+    uint64_t x[5][LANES], y[5][LANES], z[5][LANES];
+    store(x, acc.x);
+    store(y, acc.y);
+    store(z, acc.z);
+    for (size_t j = 0; j < cnt; j++) {
+        if ((inf >> j) & 1) {
+            secp256k1_gej_set_infinity(&r[j]);
+            continue;
+        }
+        r[j].infinity = 0;
+        fromLane(r[j].x, x, j);
+        fromLane(r[j].y, y, j);
+        if (fromLane(r[j].z, z, j)) {
+            // an addition hit a doubling or the point at infinity; redo the lane
+            secp256k1_ecmult(&r[j], &a, &na[j], &ng[j]);
+        }
+    }
+}
+
+#endif // ACCA_ECMULT_LANES
+
+bool detect()
+{
+#ifdef ACCA_ECMULT_LANES
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+#else
+    return false;
+#endif
+}
+
+bool& selected()
+{
+    static bool b = detect();
+    return b;
+}
+
+}
+
+EcmultLanes::EcmultLanes(const secp256k1_gej_t& a) : a(a)
+{
+    if (secp256k1_gej_is_infinity(&a)) {
+        throw std::invalid_argument("point at infinity");
+    }
+    secp256k1_gej_t aj = a;
+    secp256k1_ge_t ge;
+    secp256k1_ge_set_gej(&ge, &aj);
+    buildTable(tableA, ge, 1 << (A_WINDOW - 1), Numa::currentNode());
+}
+
+const EcmultLanes::table_t& EcmultLanes::tableG()
+{
+    struct Replicas {
+        std::vector<table_t> tables;
+        std::unique_ptr<std::once_flag[]> built;
+        Replicas() : tables(Numa::nodes()), built(new std::once_flag[tables.size()]) {
+        }
+    };
+    static Replicas replicas;
+    int node = std::min(Numa::currentNode(), (int) replicas.tables.size() - 1);
+    table_t& t = replicas.tables[node];
+    std::call_once(replicas.built[node], [&t, node] {
+        buildTable(t, secp256k1_ge_const_g, 1 << (G_WINDOW - 1), node);
+    });
+    return t;
+}
+
+void EcmultLanes::ecmult(secp256k1_gej_t* r, const secp256k1_scalar_t* na, const secp256k1_scalar_t* ng, size_t cnt) const
+{
+#ifdef ACCA_ECMULT_LANES
+    // A pass over the lanes costs about as much as LANES / 2 scalar multiplications, so the
+    // remaining items of a batch are computed one by one if there are fewer than that.
+    size_t done = 0;
+    if (selected()) {
+        const table_t& g = tableG();
+        for (; cnt - done >= LANES / 2; done += std::min(LANES, cnt - done)) {
+            ecmultLanes(r + done, a, tableA, g, na + done, ng + done, std::min(LANES, cnt - done));
+        }
+    }
+#else
+    size_t done = 0;
+#endif
+    for (size_t i = done; i < cnt; i++) {
+        secp256k1_ecmult(&r[i], &a, &na[i], &ng[i]);
+    }
+}
+
+#ifdef ACCA_ECMULT_LANES
+
+namespace {
+
+__attribute__((target("avx512f,avx512ifma")))
+void feMulLanes(secp256k1_fe_t* r, const secp256k1_fe_t* a, const secp256k1_fe_t* b, bool square)
+{
+    uint64_t la[5][EcmultLanes::LANES], lb[5][EcmultLanes::LANES];
+    toLanes(la, a);
+    toLanes(lb, b);
+    fe8 fa, fb, fr;
+    load(fa, la);
+    load(fb, lb);
+    if (square) {
+        sqr(fr, fa);
+    }
+    else {
+        mul(fr, fa, fb);
+    }
+    store(la, fr);
+    for (size_t j = 0; j < EcmultLanes::LANES; j++) {
+        fromLane(r[j], la, j);
+    }
+}
+
+void gejToLanes(uint64_t (*x)[EcmultLanes::LANES], uint64_t (*y)[EcmultLanes::LANES], uint64_t (*z)[EcmultLanes::LANES], const secp256k1_gej_t* a)
+{
+    secp256k1_fe_t fx[EcmultLanes::LANES], fy[EcmultLanes::LANES], fz[EcmultLanes::LANES];
+    for (size_t j = 0; j < EcmultLanes::LANES; j++) {
+        fx[j] = a[j].x;
+        fy[j] = a[j].y;
+        fz[j] = a[j].z;
+    }
+    toLanes(x, fx);
+    toLanes(y, fy);
+    toLanes(z, fz);
+}
+
+void gejFromLanes(secp256k1_gej_t* r, const uint64_t (*x)[EcmultLanes::LANES], const uint64_t (*y)[EcmultLanes::LANES], const uint64_t (*z)[EcmultLanes::LANES])
+{
+    for (size_t j = 0; j < EcmultLanes::LANES; j++) {
+        fromLane(r[j].x, x, j);
+        fromLane(r[j].y, y, j);
+        r[j].infinity = fromLane(r[j].z, z, j);
+    }
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+void gejLanes(secp256k1_gej_t* r, const secp256k1_gej_t* a, const secp256k1_ge_t* b)
+{
+    const size_t LANES = EcmultLanes::LANES;
+    uint64_t x[5][LANES], y[5][LANES], z[5][LANES];
+    gejToLanes(x, y, z, a);
+    gej8 p;
+    load(p.x, x);
+    load(p.y, y);
+    load(p.z, z);
+    if (b) {
+        secp256k1_fe_t bx[LANES], by[LANES];
+        for (size_t j = 0; j < LANES; j++) {
+            bx[j] = b[j].x;
+            by[j] = b[j].y;
+        }
+        uint64_t lx[5][LANES], ly[5][LANES];
+        toLanes(lx, bx);
+        toLanes(ly, by);
+        fe8 fx, fy;
+        load(fx, lx);
+        load(fy, ly);
+        gejAddGe(p, p, fx, fy);
+    }
+    else {
+        gejDouble(p, p);
+    }
+    store(x, p.x);
+    store(y, p.y);
+    store(z, p.z);
+    gejFromLanes(r, x, y, z);
+}
+
+}
+
+#endif // ACCA_ECMULT_LANES
+
+void EcmultLanes::feMul(secp256k1_fe_t* r, const secp256k1_fe_t* a, const secp256k1_fe_t* b)
+{
+#ifdef ACCA_ECMULT_LANES
+    if (selected()) {
+        feMulLanes(r, a, b, false);
+        return;
+    }
+#endif
+    for (size_t j = 0; j < LANES; j++) {
+        secp256k1_fe_mul(&r[j], &a[j], &b[j]);
+    }
+}
+
+void EcmultLanes::feSqr(secp256k1_fe_t* r, const secp256k1_fe_t* a)
+{
+#ifdef ACCA_ECMULT_LANES
+    if (selected()) {
+        feMulLanes(r, a, a, true);
+        return;
+    }
+#endif
+    for (size_t j = 0; j < LANES; j++) {
+        secp256k1_fe_sqr(&r[j], &a[j]);
+    }
+}
+
+void EcmultLanes::gejDouble(secp256k1_gej_t* r, const secp256k1_gej_t* a)
+{
+#ifdef ACCA_ECMULT_LANES
+    if (selected()) {
+        gejLanes(r, a, nullptr);
+        return;
+    }
+#endif
+    for (size_t j = 0; j < LANES; j++) {
+        secp256k1_gej_double_var(&r[j], &a[j]);
+    }
+}
+
+void EcmultLanes::gejAddGe(secp256k1_gej_t* r, const secp256k1_gej_t* a, const secp256k1_ge_t* b)
+{
+#ifdef ACCA_ECMULT_LANES
+    if (selected()) {
+        gejLanes(r, a, b);
+        return;
+    }
+#endif
+    for (size_t j = 0; j < LANES; j++) {
+        secp256k1_gej_add_ge_var(&r[j], &a[j], &b[j]);
+    }
+}
+
+bool EcmultLanes::enabled()
+{
+    return selected();
+}
+
+bool EcmultLanes::setEnabled(bool enable)
+{
+    if (enable && !detect()) {
+        return false;
+    }
+    selected() = enable;
+    return true;
+}
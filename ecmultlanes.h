@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef ECMULTLANES_H
+#define ECMULTLANES_H
+
+#include "chameleonhash.h"
+#include "numa.h"
+
+#include <stdint.h>
+#include <vector>
+
+// secp256k1 group operations on eight independent points at once, in the 64-bit lanes of
+// AVX-512 registers. Field elements use five 52-bit limbs as in field_5x52, and products are
+// computed with the 52-bit multiply-add instructions of AVX-512 IFMA.
+//
+// On CPUs without AVX-512 IFMA, all functions fall back to the scalar secp256k1 code, so they
+// can be used unconditionally.
+class EcmultLanes
+{
+public:
+    static const size_t LANES = 8;
+
+    // Precomputes the multiples of a for A_WINDOW. a must not be infinity.
+    explicit EcmultLanes(const secp256k1_gej_t& a);
+
+    // r[i] = na[i] * a + ng[i] * G for i < cnt, like secp256k1_ecmult.
+    void ecmult(secp256k1_gej_t* r, const secp256k1_scalar_t* na, const secp256k1_scalar_t* ng, size_t cnt) const;
+
+    // Lane-wise operations on LANES elements each, used to check the lanes against the
+    // scalar field and group code. gejAddGe is only defined if a[i] != +-b[i].
+    static void feMul(secp256k1_fe_t* r, const secp256k1_fe_t* a, const secp256k1_fe_t* b);
+    static void feSqr(secp256k1_fe_t* r, const secp256k1_fe_t* a);
+    static void gejDouble(secp256k1_gej_t* r, const secp256k1_gej_t* a);
+    static void gejAddGe(secp256k1_gej_t* r, const secp256k1_gej_t* a, const secp256k1_ge_t* b);
+
+    // Whether the CPU supports the lanes. Disabling them is meant for tests and benchmarks;
+    // enabling fails if the CPU does not support them.
+    static bool enabled();
+    static bool setEnabled(bool enable);
+
+    // Window sizes of the signed fixed-window recoding of na and ng. Every lane adds a table
+    // entry at the same bit positions, so no lane idles during additions.
+    static const int A_WINDOW = 5;
+    static const int G_WINDOW = 8;
+
+    // The multiples 1 * P, ..., n * P of a point P in affine coordinates, with limb l of the
+    // x coordinate of entry i at x[l * n + i]
+    struct table_t {
+        size_t n;
+        std::vector<uint64_t, NodeAllocator<uint64_t>> x, y;
+    };
+
+private:
+    secp256k1_gej_t a;
+    // on the node of the thread that constructed this
+    table_t tableA;
+
+    // The table of G on the node of the calling thread. Each node has its own copy, which is
+    // built on first use.
+    static const table_t& tableG();
+};
+
+#endif // ECMULTLANES_H
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "hugepages.h"
+#include "chameleonhash.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t SMALL_PAGE_LEN = 4096;
+
+bool enabled_ = true;
+
+size_t roundUp(size_t len, size_t to)
+{
+    return (len + to - 1) / to * to;
+}
+
+void prefault(const void* p, size_t len)
+{
+    const volatile unsigned char* c = static_cast<const volatile unsigned char*>(p);
+    for (size_t i = 0; i < len; i += SMALL_PAGE_LEN) {
+        (void) c[i];
+    }
+}
+
+#if defined(__linux__)
+
+// Maps len bytes (a multiple of PAGE_LEN) aligned to PAGE_LEN.
+void* mapAligned(size_t len)
+{
+    size_t padded = len + HugePages::PAGE_LEN;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    uintptr_t start = (uintptr_t) raw;
+    uintptr_t aligned = roundUp(start, HugePages::PAGE_LEN);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    if (start + padded > aligned + len) {
+        munmap((void*) (aligned + len), start + padded - aligned - len);
+    }
+    return (void*) aligned;
+}
+
+#endif
+
+}
+
+void* HugePages::allocate(size_t len)
+{
+#if defined(__linux__)
+    if (len >= MIN_LEN) {
+        len = roundUp(len, PAGE_LEN);
+        void* p = MAP_FAILED;
+        if (enabled_) {
+            p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        }
+        if (p == MAP_FAILED) {
+            p = mapAligned(len);
+            if (!p) {
+                throw std::bad_alloc();
+            }
+            madvise(p, len, enabled_ ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+            // Anonymous memory is only allocated on the first write.
+            for (size_t i = 0; i < len; i += SMALL_PAGE_LEN) {
+                static_cast<volatile unsigned char*>(p)[i] = 0;
+            }
+        }
+        return p;
+    }
+#endif
+    void* p = malloc(len ? len : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void HugePages::deallocate(void* p, size_t len)
+{
+    if (!p) {
+        return;
+    }
+#if defined(__linux__)
+    if (len >= MIN_LEN) {
+        munmap(p, roundUp(len, PAGE_LEN));
+        return;
+    }
+#endif
+    free(p);
+}
+
+void HugePages::advise(const void* p, size_t len)
+{
+#if defined(__linux__)
+    uintptr_t start = roundUp((uintptr_t) p, PAGE_LEN);
+    uintptr_t end = ((uintptr_t) p + len) / PAGE_LEN * PAGE_LEN;
+    if (enabled_ && start < end) {
+        madvise((void*) start, end - start, MADV_HUGEPAGE);
+#ifdef MADV_COLLAPSE
+        // Collapses file-backed pages, e.g., tables in .rodata, if the kernel supports it.
+        madvise((void*) start, end - start, MADV_COLLAPSE);
+#endif
+    }
+#endif
+    prefault(p, len);
+}
+
+HugePages::Kind HugePages::kind(const void* p)
+{
+    Kind res = NONE;
+#if defined(__linux__)
+    FILE* f = fopen("/proc/self/smaps", "r");
+    if (!f) {
+        return NONE;
+    }
+    char line[512];
+    bool inside = false;
+    while (fgets(line, sizeof line, f)) {
+        unsigned long start, end;
+        size_t kb;
+        // VMA headers start with the address range, field lines with a name
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            if (inside) {
+                break;
+            }
+            inside = start <= (uintptr_t) p && (uintptr_t) p < end;
+        }
+        else if (inside) {
+            if (sscanf(line, "KernelPageSize: %zu kB", &kb) == 1 && kb * 1024 >= PAGE_LEN) {
+                res = HUGETLB;
+                break;
+            }
+            if ((sscanf(line, "AnonHugePages: %zu kB", &kb) == 1 || sscanf(line, "FilePmdMapped: %zu kB", &kb) == 1) && kb > 0) {
+                res = TRANSPARENT;
+            }
+        }
+    }
+    fclose(f);
+#else
+    (void) p;
+#endif
+    return res;
+}
+
+const char* HugePages::kindName(Kind kind)
+{
+    switch (kind) {
+    case TRANSPARENT:
+        return "transparent huge pages";
+    case HUGETLB:
+        return "hugetlb";
+    default:
+        return "regular pages";
+    }
+}
+
+HugePages::Kind HugePages::prepareSecpTables()
+{
+    advise(secp256k1_pre_g, sizeof secp256k1_pre_g);
+    advise(secp256k1_pre_g_128, sizeof secp256k1_pre_g_128);
+    advise(secp256k1_ecmult_gen_prec_table, sizeof secp256k1_ecmult_gen_prec_table);
+    return kind(secp256k1_pre_g);
+}
+
+bool HugePages::enabled()
+{
+    return enabled_;
+}
+
+void HugePages::setEnabled(bool enable)
+{
+    enabled_ = enable;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef HUGEPAGES_H
+#define HUGEPAGES_H
+
+#include <stddef.h>
+#include <new>
+
+// Memory for large, hot tables, backed by 2 MiB pages where the system provides them. Fewer,
+// larger pages mean fewer TLB misses when the hot loops walk the tables.
+//
+// Allocations first try explicit huge pages (MAP_HUGETLB), then an aligned anonymous mapping
+// with MADV_HUGEPAGE, i.e., transparent huge pages. Both are prefaulted, so the first
+// authentication does not pay for page faults. Allocations below MIN_LEN use the regular heap.
+// While huge pages are disabled, larger allocations are still aligned, prefaulted mappings, but
+// with MADV_NOHUGEPAGE, so that they stay on regular pages and deallocate need not know
+// whether huge pages were enabled at the time.
+class HugePages
+{
+public:
+    static const size_t PAGE_LEN = 2 << 20;
+    static const size_t MIN_LEN = PAGE_LEN / 2;
+
+    enum Kind {
+        // regular pages
+        NONE,
+        // transparent huge pages
+        TRANSPARENT,
+        // explicit huge pages from the hugetlbfs pool
+        HUGETLB
+    };
+
+    static void* allocate(size_t len);
+    static void deallocate(void* p, size_t len);
+
+    // Prefaults existing memory, e.g., the static tables of libsecp256k1, and asks the kernel to
+    // back the whole 2 MiB pages in [p, p + len) with huge pages.
+    static void advise(const void* p, size_t len);
+
+    // The kind of pages backing the memory at p, as reported in /proc/self/smaps.
+    static Kind kind(const void* p);
+    static const char* kindName(Kind kind);
+
+    // Advises and prefaults the precomputed tables of libsecp256k1. ChameleonHash calls this
+    // once on first use. The return value describes the pages of the a*P + b*G table.
+    static Kind prepareSecpTables();
+
+    // Disabling huge pages is meant for benchmarks against the default layout. It affects
+    // later allocations only.
+    static bool enabled();
+    static void setEnabled(bool enable);
+};
+
+// Allocator for standard containers with HugePages.
+template <typename T>
+struct HugePageAllocator
+{
+    typedef T value_type;
+
+    HugePageAllocator() {}
+    template <typename U> HugePageAllocator(const HugePageAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        if (n > (size_t) -1 / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(HugePages::allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+        HugePages::deallocate(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) {
+    return true;
+}
+template <typename T, typename U>
+bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) {
+    return false;
+}
+
+#endif // HUGEPAGES_H
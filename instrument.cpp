@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "instrument.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+// The slots of one thread. Only the owning thread writes them, so relaxed loads and stores
+// suffice and the hot path needs no locked instructions.
+struct Slots {
+    std::atomic<uint64_t> calls[Instrument::PHASE_COUNT];
+    std::atomic<uint64_t> ticks[Instrument::PHASE_COUNT];
+
+    Slots() {
+        for (size_t i = 0; i < Instrument::PHASE_COUNT; i++) {
+            calls[i].store(0, std::memory_order_relaxed);
+            ticks[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void addTo(Instrument::stats_t& stats) const {
+        for (size_t i = 0; i < Instrument::PHASE_COUNT; i++) {
+            stats.calls[i] += calls[i].load(std::memory_order_relaxed);
+            stats.ticks[i] += ticks[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<Slots*> live;
+    // counts of exited threads, and the snapshot at the last reset
+    Instrument::stats_t retired;
+    Instrument::stats_t base;
+
+    Registry() {
+        memset(&retired, 0, sizeof retired);
+        memset(&base, 0, sizeof base);
+    }
+
+    void total(Instrument::stats_t& stats) {
+        stats = retired;
+        for (Slots* s : live) {
+            s->addTo(stats);
+        }
+    }
+};
+
+Registry& registry()
+{
+    // never destroyed, so that threads exiting during static destruction can still retire
+    static Registry* r = new Registry();
+    return *r;
+}
+
+struct ThreadSlots {
+    Slots slots;
+
+    ThreadSlots() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(&slots);
+    }
+
+    ~ThreadSlots() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        slots.addTo(r.retired);
+        for (size_t i = 0; i < r.live.size(); i++) {
+            if (r.live[i] == &slots) {
+                r.live[i] = r.live.back();
+                r.live.pop_back();
+                break;
+            }
+        }
+    }
+};
+
+}
+
+uint64_t Instrument::ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void Instrument::record(Phase phase, uint64_t ticks)
+{
+    static thread_local ThreadSlots t;
+    std::atomic<uint64_t>& c = t.slots.calls[phase];
+    std::atomic<uint64_t>& k = t.slots.ticks[phase];
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    k.store(k.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+}
+
+void Instrument::snapshot(stats_t& stats)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.total(stats);
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        stats.calls[i] -= r.base.calls[i];
+        stats.ticks[i] -= r.base.ticks[i];
+    }
+}
+
+void Instrument::reset()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.total(r.base);
+}
+
+const char* Instrument::phaseName(Phase phase)
+{
+    static const char* const NAMES[PHASE_COUNT] = {
+        "authenticate", "verify", "ecmult_gen", "ecmult", "affine", "scalar_inverse", "hmac", "sha256"
+    };
+    return phase < PHASE_COUNT ? NAMES[phase] : "unknown";
+}
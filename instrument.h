@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Opt-in counters and timers for the phases of the hot paths. Build with -DACCA_INSTRUMENT=ON
+// (cmake) to enable them; otherwise ACCA_PHASE and ACCA_TIMED expand to nothing and the
+// snapshot is always zero.
+//
+// Every thread counts into its own slots, which snapshot() sums up on demand. Timers read the
+// time stamp counter where available and the steady clock in nanoseconds elsewhere. Phases
+// nest, e.g., PHASE_AUTHENTICATE includes the PHASE_ECMULT_GEN time of the same call.
+class Instrument
+{
+public:
+#ifdef ACCA_INSTRUMENT
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    enum Phase {
+        PHASE_AUTHENTICATE,
+        PHASE_VERIFY,
+        // a*G on the signer side
+        PHASE_ECMULT_GEN,
+        // a*P + b*G on the verifier side, scalar or in lanes
+        PHASE_ECMULT,
+        // Jacobian to affine conversion before serialization
+        PHASE_AFFINE,
+        PHASE_SCALAR_INVERSE,
+        // PRF and random oracle
+        PHASE_HMAC,
+        // digests of statements and tree nodes
+        PHASE_SHA256,
+        PHASE_COUNT
+    };
+
+    struct stats_t {
+        uint64_t calls[PHASE_COUNT];
+        uint64_t ticks[PHASE_COUNT];
+    };
+
+    // Counts since the last reset(), over all threads, including threads that have exited.
+    static void snapshot(stats_t& stats);
+    // Makes the following snapshots count from now on.
+    static void reset();
+    static const char* phaseName(Phase phase);
+
+    static uint64_t ticks();
+    static void record(Phase phase, uint64_t ticks);
+
+    class Scope
+    {
+    public:
+        explicit Scope(Phase phase) : phase(phase), start(ticks()) {}
+        ~Scope() {
+            record(phase, ticks() - start);
+        }
+
+    private:
+        Phase phase;
+        uint64_t start;
+
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+    };
+};
+
+#ifdef ACCA_INSTRUMENT
+#define ACCA_INSTRUMENT_CONCAT2(a, b) a##b
+#define ACCA_INSTRUMENT_CONCAT(a, b) ACCA_INSTRUMENT_CONCAT2(a, b)
+// Times the rest of the enclosing block.
+#define ACCA_PHASE(phase) Instrument::Scope ACCA_INSTRUMENT_CONCAT(accaPhase, __LINE__)(Instrument::phase)
+// Times a single statement.
+#define ACCA_TIMED(phase, statement) do { ACCA_PHASE(phase); statement; } while (0)
+#else
+#define ACCA_PHASE(phase) do {} while (0)
+#define ACCA_TIMED(phase, statement) do { statement; } while (0)
+#endif
+
+#endif // INSTRUMENT_H
@@ -26,27 +26,34 @@
 
 #include "node.h"
 #include <assert.h>
+#include <stdexcept>
 
-Node::Node(const Authenticator::ct_t& ct) : level(Authenticator::DEPTH), fromLeft({})
+template <size_t CT_LEN>
+Node<CT_LEN>::Node(const ct_t& ct) : level(DEPTH), fromLeft({})
 {
     // Parse as big endian number
-    for (size_t i = 0; i < Authenticator::CT_LEN; i++) {
+    for (size_t i = 0; i < CT_LEN; i++) {
         fromLeft[LIMBS - 1 - i/sizeof(limb_t)]
-            |= (limb_t) ct[Authenticator::CT_LEN-i-1] << (i % sizeof(limb_t) * 8);
+            |= (limb_t) ct[CT_LEN-i-1] << (i % sizeof(limb_t) * 8);
     }
+    encode();
 }
 
-Node::Node(size_t level, uint64_t fromLeft) : level(level), fromLeft({})
+template <size_t CT_LEN>
+Node<CT_LEN>::Node(size_t level, uint64_t fromLeft) : level(level), fromLeft({})
 {
     this->fromLeft.back() += fromLeft;
+    encode();
 }
 
-Node Node::leftChildOfRoot()
+template <size_t CT_LEN>
+Node<CT_LEN> Node<CT_LEN>::leftChildOfRoot()
 {
     return Node(1, 0);
 }
 
-bool Node::moveToParent()
+template <size_t CT_LEN>
+bool Node<CT_LEN>::moveToParent()
 {
     if (isRoot()) {
         return false;
@@ -58,6 +65,7 @@ bool Node::moveToParent()
         *it = (*it >> 1) | ((*(it-1) & 1) << (8*sizeof(limb_t) - 1));
     }
     fromLeft[0] >>= 1;
+    encode();
 
 #ifndef NDEBUG
     {
@@ -71,16 +79,20 @@ bool Node::moveToParent()
     return true;
 }
 
-bool Node::moveToSibling()
+template <size_t CT_LEN>
+bool Node<CT_LEN>::moveToSibling()
 {
     if (isRoot()) {
         return false;
     }
     fromLeft.back() ^= 1;
+    // the last byte of the encoding is the least significant byte of the last limb
+    enc.back() ^= 1;
     return true;
 }
 
-bool Node::isLeftChild()
+template <size_t CT_LEN>
+bool Node<CT_LEN>::isLeftChild()
 {
     if (isRoot()) {
         throw std::logic_error("Root node is not a child.");
@@ -88,19 +100,43 @@ bool Node::isLeftChild()
     return !(fromLeft.back() & 1);
 }
 
-bool Node::isRoot()
+template <size_t CT_LEN>
+bool Node<CT_LEN>::isRoot()
 {
     return level == 0;
 }
 
-void Node::toBytes(Prf::data_t& d)
+template <size_t CT_LEN>
+void Node<CT_LEN>::toBytes(Prf::data_t& d)
 {
-    d.resize(sizeof level + sizeof(limb_t) * LIMBS);
-    d.push_back(level);
+    d.assign(enc.begin(), enc.end());
+}
+
+template <size_t CT_LEN>
+void Node<CT_LEN>::encode()
+{
+    // The first sizeof level + sizeof(limb_t) * LIMBS bytes stay zero.
+    auto out = enc.begin() + sizeof level + sizeof(limb_t) * LIMBS;
+    *(out++) = level;
     for (auto &limb : fromLeft) {
-        // for i = sizeof(limb_t) - 1, ..., 0
+        // for i = sizeof(limb_t) - 2, ..., 0
         for (size_t i = sizeof(limb_t) - 1; i-- > 0; ) {
-            d.push_back((limb >> (i*8)) & 0xFF);
+            *(out++) = (limb >> (i*8)) & 0xFF;
         }
     }
+    assert(out == enc.end());
+}
+
+template <size_t CT_LEN>
+void Node<CT_LEN>::wideBytes(wide_t& out) const
+{
+    out[0] = level >> 8;
+    out[1] = level;
+    // the position in big endian, without the unused high bytes of the first limb
+    for (size_t i = 0; i < CT_LEN; i++) {
+        out[WIDE_LEN - 1 - i] = fromLeft[LIMBS - 1 - i / sizeof(limb_t)] >> (i % sizeof(limb_t) * 8);
+    }
 }
+
+#define ACCA_INSTANTIATE_NODE(CT_LEN) template class Node<CT_LEN>;
+ACCA_FOR_EACH_CT_LEN(ACCA_INSTANTIATE_NODE)
@@ -27,15 +27,46 @@
 #ifndef NODE_H
 #define NODE_H
 
-#include "authenticator.h"
 #include "prf.h"
 #include <array>
+#include <stdint.h>
 
+// Context lengths for which Node, Prf and BasicAuthenticator are instantiated.
+// The length configured via the ACCA_CT_LEN variable in cmake is always included.
+#if ACCA_CT_LEN == 2 || ACCA_CT_LEN == 4 || ACCA_CT_LEN == 8
+#define ACCA_FOR_EACH_CT_LEN(X) X(2) X(4) X(8)
+#else
+#define ACCA_FOR_EACH_CT_LEN(X) X(2) X(4) X(8) X(ACCA_CT_LEN)
+#endif
+
+template <size_t CT_LEN>
 class Node
 {
+private:
+    // The code is fully parametric in limb_t.
+    typedef uint64_t limb_t;
+    static const size_t LIMBS = (CT_LEN + sizeof(limb_t) - 1) / sizeof(limb_t);
+
 public:
+    // Depth is number of non-root levels.
+    static const size_t DEPTH = CT_LEN * 8;
+
+    // Length of the encoding fed into the PRF: zero padding, the level, and the lower
+    // sizeof(limb_t) - 1 bytes of every limb. The PRF outputs are committed to in the
+    // rootDigest of every dpk, so this layout must not change.
+    static const size_t BYTES_LEN = sizeof(size_t) + sizeof(limb_t) * LIMBS + 1 + (sizeof(limb_t) - 1) * LIMBS;
+
+    // Length of the encoding for DERIVE_JOINT: the level as two big-endian bytes followed by all
+    // CT_LEN bytes of the position. Unlike bytes(), it is injective for every CT_LEN.
+    static const size_t WIDE_LEN = 2 + CT_LEN;
+    static_assert(WIDE_LEN <= BYTES_LEN, "buffers for bytes() must fit both encodings");
+
+    typedef std::array<unsigned char, CT_LEN> ct_t;
+    typedef std::array<unsigned char, BYTES_LEN> bytes_t;
+    typedef std::array<unsigned char, WIDE_LEN> wide_t;
+
     // construct a leaf node
-    Node(const Authenticator::ct_t& ct);
+    Node(const ct_t& ct);
     static Node leftChildOfRoot();
 
     bool moveToParent();
@@ -45,16 +76,22 @@ public:
     bool isRoot();
     void toBytes(Prf::data_t& d);
 
+    // The encoding is kept up to date by the move operations, so this does no work.
+    const bytes_t& bytes() const {
+        return enc;
+    }
+    void wideBytes(wide_t& out) const;
+
 private:
     // Level 0 is the level of the root.
     size_t level;
 
-    // The code is fully parametric in limb_t.
-    typedef uint64_t limb_t;
-    static const size_t LIMBS = (Authenticator::CT_LEN + sizeof(limb_t) - 1) / sizeof(limb_t);
     // Big-endian representation of number of other nodes on the same level left of this node.
     std::array<uint64_t, LIMBS> fromLeft = {};
     Node(size_t level, uint64_t fromLeft);
+
+    bytes_t enc = {};
+    void encode();
 };
 
 
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "numa.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// memory policies of the kernel ABI, see mbind(2)
+const int MPOL_DEFAULT_ = 0;
+const int MPOL_PREFERRED_ = 1;
+const int MPOL_BIND_ = 2;
+const size_t MAX_NODES = 1024;
+const size_t MASK_WORDS = MAX_NODES / (8 * sizeof(unsigned long));
+
+// the node of the calling thread, if bound by bindThread
+thread_local int boundNode = -1;
+#if defined(__linux__)
+// the CPUs and the memory policy of the calling thread before bindThread
+thread_local cpu_set_t unboundCpus;
+thread_local int unboundMode;
+thread_local unsigned long unboundMask[MASK_WORDS];
+#endif
+
+size_t roundUp(size_t len, size_t to)
+{
+    return (len + to - 1) / to * to;
+}
+
+// Parses a list like "0-3,8,10-11" from a file in sysfs.
+std::vector<int> readList(const char* path)
+{
+    std::vector<int> list;
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return list;
+    }
+    int first, last;
+    char sep;
+    while (fscanf(f, "%d", &first) == 1) {
+        last = first;
+        sep = fgetc(f);
+        if (sep == '-') {
+            if (fscanf(f, "%d", &last) != 1) {
+                break;
+            }
+            sep = fgetc(f);
+        }
+        for (int i = first; i <= last; i++) {
+            list.push_back(i);
+        }
+        if (sep != ',') {
+            break;
+        }
+    }
+    fclose(f);
+    return list;
+}
+
+struct layout_t {
+    int nodes;
+    std::vector<std::vector<int>> cpus;
+    std::vector<int> nodeOfCpu;
+
+    layout_t() : nodes(1) {
+        std::vector<int> online = readList("/sys/devices/system/node/online");
+        for (int node : online) {
+            nodes = std::max(nodes, node + 1);
+        }
+        cpus.resize(nodes);
+        for (int node : online) {
+            char path[64];
+            snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+            cpus[node] = readList(path);
+            for (int cpu : cpus[node]) {
+                if (cpu >= (int) nodeOfCpu.size()) {
+                    nodeOfCpu.resize(cpu + 1, 0);
+                }
+                nodeOfCpu[cpu] = node;
+            }
+        }
+    }
+};
+
+const layout_t& layout()
+{
+    static layout_t l;
+    return l;
+}
+
+#if defined(__linux__)
+void nodeMask(unsigned long* mask, int node)
+{
+    for (size_t i = 0; i < MASK_WORDS; i++) {
+        mask[i] = 0;
+    }
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+}
+#endif
+
+}
+
+int Numa::nodes()
+{
+    return layout().nodes;
+}
+
+std::vector<int> Numa::cpus(int node)
+{
+    if (node < 0 || node >= nodes()) {
+        return std::vector<int>();
+    }
+    return layout().cpus[node];
+}
+
+int Numa::nodeOfCpu(int cpu)
+{
+    const std::vector<int>& n = layout().nodeOfCpu;
+    return cpu >= 0 && cpu < (int) n.size() ? n[cpu] : 0;
+}
+
+int Numa::currentNode()
+{
+    if (boundNode >= 0) {
+        return boundNode;
+    }
+#if defined(__linux__)
+    if (nodes() > 1) {
+        return nodeOfCpu(sched_getcpu());
+    }
+#endif
+    return 0;
+}
+
+bool Numa::bindThread(int node)
+{
+#if defined(__linux__)
+    std::vector<int> c = cpus(node);
+    if (c.empty() || node >= (int) MAX_NODES) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : c) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    cpu_set_t before;
+    if (pthread_getaffinity_np(pthread_self(), sizeof before, &before) != 0 ||
+        pthread_setaffinity_np(pthread_self(), sizeof set, &set) != 0) {
+        return false;
+    }
+    if (boundNode < 0) {
+        unboundCpus = before;
+        // without NUMA support in the kernel, the policy is the default one
+        if (syscall(SYS_get_mempolicy, &unboundMode, unboundMask, MAX_NODES, nullptr, 0) != 0) {
+            unboundMode = MPOL_DEFAULT_;
+            std::fill(unboundMask, unboundMask + MASK_WORDS, 0);
+        }
+    }
+    unsigned long mask[MASK_WORDS];
+    nodeMask(mask, node);
+    // fails without NUMA support in the kernel, which leaves the default policy
+    syscall(SYS_set_mempolicy, MPOL_PREFERRED_, mask, MAX_NODES + 1);
+    boundNode = node;
+    return true;
+#else
+    (void) node;
+    return false;
+#endif
+}
+
+void Numa::unbindThread()
+{
+    if (boundNode < 0) {
+        return;
+    }
+#if defined(__linux__)
+    pthread_setaffinity_np(pthread_self(), sizeof unboundCpus, &unboundCpus);
+    syscall(SYS_set_mempolicy, unboundMode, unboundMask, MAX_NODES + 1);
+#endif
+    boundNode = -1;
+}
+
+void* Numa::allocate(size_t len, int node)
+{
+#if defined(__linux__)
+    if (node >= 0 && node < (int) MAX_NODES && nodes() > 1) {
+        len = roundUp(len ? len : 1, sysconf(_SC_PAGESIZE));
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        // The pages are allocated on the first write, on node if mbind succeeded.
+        unsigned long mask[MASK_WORDS];
+        nodeMask(mask, node);
+        syscall(SYS_mbind, p, len, MPOL_BIND_, mask, MAX_NODES + 1, 0);
+        return p;
+    }
+#endif
+    void* p = malloc(len ? len : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void Numa::deallocate(void* p, size_t len, int node)
+{
+    if (!p) {
+        return;
+    }
+#if defined(__linux__)
+    if (node >= 0 && node < (int) MAX_NODES && nodes() > 1) {
+        munmap(p, roundUp(len ? len : 1, sysconf(_SC_PAGESIZE)));
+        return;
+    }
+#endif
+    free(p);
+}
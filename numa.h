@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Placement of memory and threads on NUMA nodes, with the mbind and set_mempolicy system calls
+// and the node layout in /sys/devices/system/node. Where these are unavailable, everything
+// behaves as on a single node: allocations use the regular heap and binding threads fails.
+class Numa
+{
+public:
+    // Number of nodes, i.e., one more than the highest online node id.
+    static int nodes();
+    // The CPUs of node, in increasing order.
+    static std::vector<int> cpus(int node);
+    static int nodeOfCpu(int cpu);
+    // The node the calling thread is bound to, or else the node of the CPU it runs on.
+    static int currentNode();
+
+    // Restricts the calling thread to the CPUs of node and prefers node for its future page
+    // allocations. Returns false if the thread could not be moved.
+    static bool bindThread(int node);
+    // Restores the CPUs and the memory policy the calling thread had before bindThread.
+    static void unbindThread();
+
+    // Memory whose pages are allocated on node. On a single node, or for node -1, this is
+    // the regular heap.
+    static void* allocate(size_t len, int node);
+    static void deallocate(void* p, size_t len, int node);
+};
+
+// Allocator for standard containers with Numa. Containers take their allocator along on
+// assignment and swap, so their elements stay on the node they were allocated on.
+template <typename T>
+struct NodeAllocator
+{
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    int node;
+
+    explicit NodeAllocator(int node = -1) : node(node) {}
+    template <typename U> NodeAllocator(const NodeAllocator<U>& other) : node(other.node) {}
+
+    T* allocate(size_t n) {
+        if (n > (size_t) -1 / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(Numa::allocate(n * sizeof(T), node));
+    }
+    void deallocate(T* p, size_t n) {
+        Numa::deallocate(p, n * sizeof(T), node);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const NodeAllocator<T>& a, const NodeAllocator<U>& b) {
+    return a.node == b.node;
+}
+template <typename T, typename U>
+bool operator!=(const NodeAllocator<T>& a, const NodeAllocator<U>& b) {
+    return a.node != b.node;
+}
+
+#endif // NUMA_H
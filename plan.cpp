@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "plan.h"
+#include "ecmultlanes.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+const char* const HEADER = "# acca plan";
+
+Plan& stored()
+{
+    static Plan plan = []() {
+        Plan p;
+        const char* path = getenv("ACCA_PLAN");
+        if (path && *path) {
+            // A broken plan file must not make every batch operation throw; it is reported
+            // once, and the defaults are used instead, as they are for a plan measured
+            // elsewhere.
+            try {
+                Plan loaded = Plan::load(path);
+                if (loaded.cpu == p.cpu) {
+                    p = loaded;
+                }
+            } catch (const std::exception& e) {
+                fprintf(stderr, "acca: ignoring ACCA_PLAN: %s\n", e.what());
+            }
+        }
+        EcmultLanes::setEnabled(p.lanes);
+        return p;
+    }();
+    return plan;
+}
+
+std::string trim(const std::string& s)
+{
+    size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return std::string();
+    }
+    size_t last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+unsigned long parseNumber(const std::string& key, const std::string& value)
+{
+    char* end;
+    unsigned long v = strtoul(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || value[0] == '-') {
+        throw std::invalid_argument("malformed plan: " + key + " is not a number");
+    }
+    return v;
+}
+
+}
+
+Plan::Plan() : verifyChunk(64), straussThreshold(2), pippengerThreshold(88), lanes(EcmultLanes::enabled()),
+    threads(std::max(1u, std::thread::hardware_concurrency())), cpu(thisCpu())
+{
+}
+
+Plan::MultiExp Plan::multiExp(size_t points) const
+{
+    if (points >= pippengerThreshold) {
+        return MULTIEXP_PIPPENGER;
+    }
+    if (points >= straussThreshold) {
+        return MULTIEXP_STRAUSS;
+    }
+    return MULTIEXP_SIMPLE;
+}
+
+void Plan::save(const std::string& path) const
+{
+    std::ofstream out(path.c_str());
+    out << HEADER << "\n"
+        << "cpu = " << cpu << "\n"
+        << "verify_chunk = " << verifyChunk << "\n"
+        << "strauss_threshold = " << straussThreshold << "\n"
+        << "pippenger_threshold = " << pippengerThreshold << "\n"
+        << "lanes = " << (lanes ? 1 : 0) << "\n"
+        << "threads = " << threads << "\n";
+    out.close();
+    if (!out) {
+        throw std::runtime_error("cannot write plan to " + path);
+    }
+}
+
+Plan Plan::load(const std::string& path)
+{
+    std::ifstream in(path.c_str());
+    if (!in) {
+        throw std::runtime_error("cannot read plan from " + path);
+    }
+    Plan plan;
+    std::string line;
+    if (!std::getline(in, line) || trim(line) != HEADER) {
+        throw std::invalid_argument("malformed plan: missing header");
+    }
+    while (std::getline(in, line)) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument("malformed plan: " + line);
+        }
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+        if (key == "cpu") {
+            plan.cpu = value;
+        } else if (key == "verify_chunk") {
+            plan.verifyChunk = parseNumber(key, value);
+        } else if (key == "strauss_threshold") {
+            plan.straussThreshold = parseNumber(key, value);
+        } else if (key == "pippenger_threshold") {
+            plan.pippengerThreshold = parseNumber(key, value);
+        } else if (key == "lanes") {
+            plan.lanes = parseNumber(key, value) != 0;
+        } else if (key == "threads") {
+            plan.threads = parseNumber(key, value);
+        }
+        // unknown keys are from newer versions
+    }
+    if (plan.verifyChunk == 0 || plan.threads == 0) {
+        throw std::invalid_argument("malformed plan: zero verify_chunk or threads");
+    }
+    return plan;
+}
+
+const Plan& Plan::current()
+{
+    return stored();
+}
+
+void Plan::setCurrent(const Plan& plan)
+{
+    Plan& p = stored();
+    p = plan;
+    // the lanes stay off if the CPU lacks them
+    p.lanes = EcmultLanes::setEnabled(plan.lanes) && plan.lanes;
+}
+
+std::string Plan::thisCpu()
+{
+    std::string model;
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (model.empty() && std::getline(in, line)) {
+        if (line.compare(0, 10, "model name") == 0 || line.compare(0, 9, "Processor") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                model = trim(line.substr(colon + 1));
+            }
+        }
+    }
+    if (model.empty()) {
+        model = "unknown";
+    }
+    std::ostringstream s;
+    s << model << " x " << std::max(1u, std::thread::hardware_concurrency());
+    return s.str();
+}
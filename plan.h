@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <stddef.h>
+
+#include <string>
+
+// Parameters of the batch operations that depend on the machine, in the spirit of FFTW's
+// wisdom. The defaults are reasonable anywhere; acca_plan measures the candidates on the
+// machine at hand (see Planner) and saves a plan file, which a program loads at startup with
+// load and setCurrent, or which is loaded from the file named by the ACCA_PLAN environment
+// variable on first use. There, a plan measured on a different CPU is ignored, and so is a
+// file that cannot be loaded, which is reported on stderr.
+//
+// The plan in use is global. Set it before starting threads that use the batch operations.
+class Plan
+{
+public:
+    // Multi-exponentiation algorithms of libsecp256k1, see ChameleonHash::multiExp.
+    enum MultiExp {
+        // one ecmult per point
+        MULTIEXP_SIMPLE,
+        MULTIEXP_STRAUSS,
+        MULTIEXP_PIPPENGER
+    };
+
+    // Items per chunk in verifyBatch and VerifyPipeline, at most BATCH_CHUNK.
+    size_t verifyChunk;
+    // Multi-exponentiations of at least this many points use Strauss's algorithm, and of at
+    // least pippengerThreshold points Pippenger's.
+    size_t straussThreshold;
+    size_t pippengerThreshold;
+    // Whether ChameleonHash uses EcmultLanes where the CPU supports it.
+    bool lanes;
+    // Worker threads for throughput, e.g., of accad and the walkers of VerifyPipeline.
+    unsigned threads;
+    // The CPU the plan was measured on, e.g., "Intel(R) Xeon(R) ... x 32".
+    std::string cpu;
+
+    Plan();
+
+    MultiExp multiExp(size_t points) const;
+
+    // Text file with one "key = value" line per parameter; '#' starts a comment.
+    void save(const std::string& path) const;
+    // Throws if the file cannot be read or is malformed. Parameters missing from the file
+    // keep their defaults.
+    static Plan load(const std::string& path);
+
+    static const Plan& current();
+    // Also applies lanes to EcmultLanes.
+    static void setCurrent(const Plan& plan);
+
+    // Description of this machine for the cpu field.
+    static std::string thisCpu();
+};
+
+#endif // PLAN_H
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "planner.h"
+#include "authenticator.h"
+#include "ecmultlanes.h"
+#include "tokenbatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const ChameleonHash::sk_t SK = {{
+    0xb2, 0x19, 0x77, 0xc8, 0xca, 0x1c, 0xbb, 0x55, 0xf0, 0xa3, 0xef, 0xfd, 0x99, 0x66, 0xe3, 0xd5,
+    0xc9, 0x58, 0x86, 0x88, 0xfa, 0x02, 0xbf, 0x7a, 0x0d, 0x2a, 0xf7, 0xb6, 0x36, 0x6f, 0x1e, 0x8f
+}};
+const ChameleonHash::W W = SK;
+
+// a candidate within this fraction of the best is as good, and the cheaper one is taken
+const double TOLERANCE = 0.05;
+
+// calls of f per second, over at least minSeconds
+template <typename F>
+double callsPerSec(double minSeconds, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t calls = 0;
+    double elapsed;
+    do {
+        f();
+        calls++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return calls / elapsed;
+}
+
+// signed tokens for the verifyBatch candidates
+struct workload_t {
+    Authenticator signer;
+    Authenticator::dpk_t dpk;
+    TokenBatch batch;
+    std::vector<Authenticator::ct_t> cts;
+
+    workload_t() : signer(SK, W, 0), cts(Planner::BATCH_ITEMS) {
+        for (size_t i = 0; i < Planner::BATCH_ITEMS; i++) {
+            Authenticator::st_t st = { (unsigned char) i, (unsigned char) (i >> 8) };
+            batch.add(st, 0);
+        }
+        ChameleonHash::hash_t h;
+        signer.authenticates(batch, cts[0], h);
+        dpk = signer.getDpk();
+    }
+
+    bool verify(Authenticator& verifier) const {
+        bool results[Planner::BATCH_ITEMS];
+        verifier.verifyBatch(batch, cts.data(), results);
+        return std::count(results, results + Planner::BATCH_ITEMS, false) == 0;
+    }
+};
+
+void check(bool ok)
+{
+    if (!ok) {
+        throw std::logic_error("planner workload does not verify");
+    }
+}
+
+// items per second of verifyBatch with the current plan
+double verifyRate(const workload_t& work, double minSeconds)
+{
+    Authenticator verifier(work.dpk, W);
+    return Planner::BATCH_ITEMS * callsPerSec(minSeconds, [&]() { check(work.verify(verifier)); });
+}
+
+// items per second of verifyBatch on threads threads, each with its own verifier
+double verifyRate(const workload_t& work, unsigned threads, double minSeconds)
+{
+    std::atomic<size_t> calls(0);
+    std::atomic<bool> ok(true);
+    std::vector<std::thread> pool;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration<double>(minSeconds);
+    for (unsigned t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            Authenticator verifier(work.dpk, W);
+            do {
+                if (!work.verify(verifier)) {
+                    ok = false;
+                }
+                calls++;
+            } while (std::chrono::steady_clock::now() < deadline);
+        });
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    check(ok);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return Planner::BATCH_ITEMS * calls / elapsed;
+}
+
+// The number of points from which on faster beats slower at every count measured, given their
+// rates at 1, 2, 4, ... points, or MAX_POINTS + 1 if it does not beat it at MAX_POINTS.
+size_t crossover(const std::vector<double>& faster, const std::vector<double>& slower)
+{
+    size_t n = Planner::MAX_POINTS + 1;
+    for (size_t i = faster.size(); i-- > 0 && faster[i] > slower[i]; ) {
+        n = (size_t) 1 << i;
+    }
+    return n;
+}
+
+}
+
+Plan Planner::measure(double minSeconds, std::ostream* log)
+{
+    const Plan previous = Plan::current();
+    Plan plan = previous;
+    workload_t work;
+
+    try {
+        // the lanes, if the CPU has them
+        plan.lanes = false;
+        Plan::setCurrent(plan);
+        double without = verifyRate(work, minSeconds);
+        plan.lanes = true;
+        Plan::setCurrent(plan);
+        if (Plan::current().lanes) {
+            double with = verifyRate(work, minSeconds);
+            plan.lanes = with > without;
+            if (log) {
+                *log << "lanes: " << without << " items/s without, " << with << " items/s with" << std::endl;
+            }
+        } else {
+            plan.lanes = false;
+        }
+
+        // chunk sizes, the smaller on a tie, for the shorter latency of the pipeline
+        double best = 0;
+        std::vector<std::pair<size_t, double>> chunks;
+        for (size_t chunk = 8; chunk <= Authenticator::BATCH_CHUNK; chunk *= 2) {
+            Plan candidate = plan;
+            candidate.verifyChunk = chunk;
+            Plan::setCurrent(candidate);
+            chunks.push_back(std::make_pair(chunk, verifyRate(work, minSeconds)));
+            best = std::max(best, chunks.back().second);
+            if (log) {
+                *log << "verify chunk " << chunk << ": " << chunks.back().second << " items/s" << std::endl;
+            }
+        }
+        for (const auto& c : chunks) {
+            if (c.second >= (1 - TOLERANCE) * best) {
+                plan.verifyChunk = c.first;
+                break;
+            }
+        }
+        Plan::setCurrent(plan);
+
+        // multi-exponentiations of random points and coefficients
+        std::mt19937_64 rng(1);
+        std::vector<secp256k1_ge_t> points(MAX_POINTS);
+        std::vector<secp256k1_scalar_t> coefs(MAX_POINTS);
+        secp256k1_scalar_t g;
+        for (size_t i = 0; i <= MAX_POINTS; i++) {
+            unsigned char b[32];
+            for (size_t j = 0; j < sizeof b; j++) {
+                b[j] = rng();
+            }
+            secp256k1_scalar_t& sc = i < MAX_POINTS ? coefs[i] : g;
+            secp256k1_scalar_set_b32(&sc, b, nullptr);
+            if (i < MAX_POINTS) {
+                secp256k1_gej_t pj, inf;
+                secp256k1_scalar_t zero;
+                secp256k1_gej_set_infinity(&inf);
+                secp256k1_scalar_clear(&zero);
+                secp256k1_ecmult(&pj, &inf, &zero, &sc);
+                secp256k1_ge_set_gej(&points[i], &pj);
+            }
+        }
+        std::vector<double> rates[3];
+        for (size_t n = 1; n <= MAX_POINTS; n *= 2) {
+            for (int a = Plan::MULTIEXP_SIMPLE; a <= Plan::MULTIEXP_PIPPENGER; a++) {
+                secp256k1_gej_t res;
+                rates[a].push_back(n * callsPerSec(minSeconds, [&]() {
+                    ChameleonHash::multiExp(res, g, points.data(), coefs.data(), n, (Plan::MultiExp) a);
+                }));
+            }
+            if (log) {
+                *log << "multi-exponentiation of " << n << ": " << rates[0].back() << " simple, "
+                     << rates[1].back() << " Strauss, " << rates[2].back() << " Pippenger points/s" << std::endl;
+            }
+        }
+        plan.straussThreshold = crossover(rates[Plan::MULTIEXP_STRAUSS], rates[Plan::MULTIEXP_SIMPLE]);
+        plan.pippengerThreshold = crossover(rates[Plan::MULTIEXP_PIPPENGER], rates[Plan::MULTIEXP_STRAUSS]);
+        Plan::setCurrent(plan);
+
+        // threads, the fewest that come within the tolerance of the best
+        unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::pair<unsigned, double>> threads;
+        best = 0;
+        for (unsigned t = 1; ; t = std::min(2 * t, hw)) {
+            threads.push_back(std::make_pair(t, verifyRate(work, t, minSeconds)));
+            best = std::max(best, threads.back().second);
+            if (log) {
+                *log << "threads " << t << ": " << threads.back().second << " items/s" << std::endl;
+            }
+            if (t == hw) {
+                break;
+            }
+        }
+        for (const auto& t : threads) {
+            if (t.second >= (1 - TOLERANCE) * best) {
+                plan.threads = t.first;
+                break;
+            }
+        }
+    } catch (...) {
+        Plan::setCurrent(previous);
+        throw;
+    }
+    Plan::setCurrent(previous);
+    plan.cpu = Plan::thisCpu();
+    return plan;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "plan.h"
+
+#include <ostream>
+
+// Finds the Plan for this machine by timing the candidates of every parameter:
+// the lanes on and off, the chunk sizes of verifyBatch, the three multi-exponentiation
+// algorithms at 1, 2, 4, ..., MAX_POINTS points, and verifyBatch on 1 to threads
+// threads.
+class Planner
+{
+public:
+    static const size_t MAX_POINTS = 512;
+    // verifyBatch of this many items is the workload of the chunk, lanes and threads candidates.
+    static const size_t BATCH_ITEMS = 256;
+
+    // Runs every candidate for at least minSeconds, which makes the whole measurement take
+    // about 40 times as long, and reports progress to log, if given. The current plan is
+    // left unchanged.
+    static Plan measure(double minSeconds, std::ostream* log = nullptr);
+};
+
+#endif // PLANNER_H
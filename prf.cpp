@@ -25,16 +25,33 @@
  */
 
 #include "prf.h"
+#include "blake3.h"
 #include "node.h"
+#include "instrument.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <stdexcept>
+#include <string.h>
 
 const unsigned char Prf::X = 'X';
 const unsigned char Prf::R = 'R';
+const unsigned char Prf::J = 'J';
 
-Prf::Prf(Prf::key_t key) : key(key) { }
+namespace {
 
-Prf::Prf(ChameleonHash::sk_t dsk, bool extract) {
+// Longest encoding that the batch evaluations handle; node encodings are much shorter.
+const size_t MAX_BATCH_LEN = 2 * Sha256::BLOCK_LEN - 1;
+const size_t CHUNK = 32;
+
+}
+
+Prf::Prf(Prf::key_t key, Suite suite, Derivation derivation) : key(key), suite(suite), derivation(derivation) {
+    initialize();
+}
+
+// The key is derived with SHA-256 in every suite; this happens once per Prf.
+Prf::Prf(ChameleonHash::sk_t dsk, bool extract, Suite suite, Derivation derivation) : suite(suite), derivation(derivation) {
     if (extract) {
         secp256k1_sha256_t hash;
         secp256k1_sha256_initialize(&hash);
@@ -42,26 +59,235 @@ Prf::Prf(ChameleonHash::sk_t dsk, bool extract) {
         assert(KEY_LEN == 256/8);
         secp256k1_sha256_finalize(&hash, this->key.data());
     }
+    initialize();
+}
+
+void Prf::initialize()
+{
+    if (!isValidSuite(suite)) {
+        throw std::invalid_argument("unknown suite");
+    }
+    if (!isValidDerivation(derivation)) {
+        throw std::invalid_argument("unknown derivation mode");
+    }
+    assert(KEY_LEN <= Sha256::BLOCK_LEN);
+    Sha256::hmacMidstates(inner, outer, key.data(), key.size());
+}
+
+template <size_t CT_LEN>
+size_t Prf::encode(unsigned char* data, const Node<CT_LEN>& i) const
+{
+    if (derivation == DERIVE_JOINT) {
+        typename Node<CT_LEN>::wide_t wide;
+        i.wideBytes(wide);
+        std::copy(wide.begin(), wide.end(), data);
+        return wide.size();
+    }
+    std::copy(i.bytes().begin(), i.bytes().end(), data);
+    return i.bytes().size();
+}
+
+template <size_t CT_LEN>
+void Prf::getX(Prf::out_t& x, const Node<CT_LEN>& i)
+{
+    unsigned char data[Node<CT_LEN>::BYTES_LEN];
+    getX(x, data, encode(data, i));
+}
+
+template <size_t CT_LEN>
+void Prf::getR(Prf::out_t& r, const Node<CT_LEN>& i)
+{
+    unsigned char data[Node<CT_LEN>::BYTES_LEN];
+    getR(r, data, encode(data, i));
+}
+
+template <size_t CT_LEN>
+void Prf::getXR(Prf::out_t& x, Prf::out_t& r, const Node<CT_LEN>& i)
+{
+    unsigned char data[Node<CT_LEN>::BYTES_LEN];
+    getXR(x, r, data, encode(data, i));
+}
+
+void Prf::getX(Prf::out_t& x, const unsigned char* data, size_t len)
+{
+    if (derivation == DERIVE_JOINT) {
+        out_t r;
+        getJoint(x, r, data, len);
+        return;
+    }
+    get_random_with_prefix(x, data, len, X);
+}
+
+void Prf::getR(Prf::out_t& r, const unsigned char* data, size_t len)
+{
+    if (derivation == DERIVE_JOINT) {
+        out_t x;
+        getJoint(x, r, data, len);
+        return;
+    }
+    get_random_with_prefix(r, data, len, R);
 }
 
-void Prf::getX(Prf::out_t& x, Node& i)
+void Prf::getXR(Prf::out_t& x, Prf::out_t& r, const unsigned char* data, size_t len)
 {
-    Prf::data_t ibytes;
-    i.toBytes(ibytes);
-    get_random_with_prefix(x, ibytes, X);
+    if (derivation == DERIVE_JOINT) {
+        getJoint(x, r, data, len);
+        return;
+    }
+    get_random_with_prefix(x, data, len, X);
+    get_random_with_prefix(r, data, len, R);
 }
 
-void Prf::getR(Prf::out_t& r, Node& i)
+void Prf::getXR(out_t* x, out_t* r, const unsigned char* data, size_t len, size_t cnt)
 {
-    Prf::data_t ibytes;
-    i.toBytes(ibytes);
-    get_random_with_prefix(r, ibytes, R);
+    if (suite != SUITE_SHA256 || len > MAX_BATCH_LEN) {
+        for (size_t i = 0; i < cnt; i++) {
+            getXR(x[i], r[i], data + i * len, len);
+        }
+    }
+    else if (derivation == DERIVE_JOINT) {
+        getJointBatch(x, r, data, len, cnt);
+    }
+    else {
+        getSeparateBatch(x, r, data, len, cnt);
+    }
 }
 
-void Prf::get_random_with_prefix(out_t& x, const data_t& data, const unsigned char& prefix)
+void Prf::getSeparateBatch(out_t* x, out_t* r, const unsigned char* data, size_t len, size_t cnt)
 {
-    secp256k1_hmac_sha256_initialize(&hash, key.data(), key.size());
-    secp256k1_hmac_sha256_write(&hash, &prefix, 1);
-    secp256k1_hmac_sha256_write(&hash, data.data(), data.size());;
-    secp256k1_hmac_sha256_finalize(&hash, x.data());
+    ACCA_PHASE(PHASE_HMAC);
+    // Messages 2j and 2j + 1 are the prefixed encoding j for X and R, respectively.
+    unsigned char msgs[2 * CHUNK][MAX_BATCH_LEN + 1];
+    const unsigned char* in[2 * CHUNK];
+    size_t lens[2 * CHUNK];
+    out_t inners[2 * CHUNK], outs[2 * CHUNK];
+
+    for (size_t done = 0; done < cnt; done += CHUNK) {
+        size_t n = std::min(CHUNK, cnt - done);
+        for (size_t j = 0; j < n; j++) {
+            const unsigned char* enc = data + (done + j) * len;
+            msgs[2 * j][0] = X;
+            msgs[2 * j + 1][0] = R;
+            memcpy(&msgs[2 * j][1], enc, len);
+            memcpy(&msgs[2 * j + 1][1], enc, len);
+            in[2 * j] = msgs[2 * j];
+            in[2 * j + 1] = msgs[2 * j + 1];
+            lens[2 * j] = lens[2 * j + 1] = len + 1;
+        }
+        Sha256::hashMany(inners, in, lens, 2 * n, inner, Sha256::BLOCK_LEN);
+
+        for (size_t j = 0; j < 2 * n; j++) {
+            in[j] = inners[j].data();
+            lens[j] = inners[j].size();
+        }
+        Sha256::hashMany(outs, in, lens, 2 * n, outer, Sha256::BLOCK_LEN);
+
+        for (size_t j = 0; j < n; j++) {
+            x[done + j] = outs[2 * j];
+            r[done + j] = outs[2 * j + 1];
+        }
+    }
 }
+
+void Prf::getJointBatch(out_t* x, out_t* r, const unsigned char* data, size_t len, size_t cnt)
+{
+    ACCA_PHASE(PHASE_HMAC);
+    // One inner hash per encoding, then outer hashes 2j and 2j + 1 for X and R, respectively.
+    unsigned char msgs[CHUNK][MAX_BATCH_LEN + 1];
+    unsigned char outerMsgs[2 * CHUNK][HASH_LEN + 1];
+    const unsigned char* in[2 * CHUNK];
+    size_t lens[2 * CHUNK];
+    out_t inners[CHUNK], outs[2 * CHUNK];
+
+    for (size_t done = 0; done < cnt; done += CHUNK) {
+        size_t n = std::min(CHUNK, cnt - done);
+        for (size_t j = 0; j < n; j++) {
+            msgs[j][0] = J;
+            memcpy(&msgs[j][1], data + (done + j) * len, len);
+            in[j] = msgs[j];
+            lens[j] = len + 1;
+        }
+        Sha256::hashMany(inners, in, lens, n, inner, Sha256::BLOCK_LEN);
+
+        for (size_t j = 0; j < n; j++) {
+            memcpy(outerMsgs[2 * j], inners[j].data(), HASH_LEN);
+            memcpy(outerMsgs[2 * j + 1], inners[j].data(), HASH_LEN);
+            outerMsgs[2 * j][HASH_LEN] = X;
+            outerMsgs[2 * j + 1][HASH_LEN] = R;
+        }
+        for (size_t j = 0; j < 2 * n; j++) {
+            in[j] = outerMsgs[j];
+            lens[j] = sizeof outerMsgs[j];
+        }
+        Sha256::hashMany(outs, in, lens, 2 * n, outer, Sha256::BLOCK_LEN);
+
+        for (size_t j = 0; j < n; j++) {
+            x[done + j] = outs[2 * j];
+            r[done + j] = outs[2 * j + 1];
+        }
+    }
+}
+
+void Prf::getJoint(out_t& x, out_t& r, const unsigned char* data, size_t len)
+{
+    ACCA_PHASE(PHASE_HMAC);
+    if (suite == SUITE_BLAKE3) {
+        unsigned char xr[2 * HASH_LEN];
+        Blake3::ctx_t hash;
+        Blake3::initializeKeyed(hash, key);
+        Blake3::write(hash, &J, 1);
+        Blake3::write(hash, data, len);
+        Blake3::finalize(hash, xr, sizeof xr);
+        std::copy(xr, xr + HASH_LEN, x.begin());
+        std::copy(xr + HASH_LEN, xr + 2 * HASH_LEN, r.begin());
+        return;
+    }
+
+    // HMAC-SHA256 on the prefixed encoding, but with two outer hashes that append X and R
+    // to the shared inner hash.
+    Sha256::ctx_t hash;
+    out_t in;
+    Sha256::initialize(hash, inner, Sha256::BLOCK_LEN);
+    Sha256::write(hash, &J, 1);
+    Sha256::write(hash, data, len);
+    Sha256::finalize(hash, in);
+
+    Sha256::initialize(hash, outer, Sha256::BLOCK_LEN);
+    Sha256::write(hash, in.data(), in.size());
+    Sha256::ctx_t hashR = hash;
+    Sha256::write(hash, &X, 1);
+    Sha256::finalize(hash, x);
+    Sha256::write(hashR, &R, 1);
+    Sha256::finalize(hashR, r);
+}
+
+void Prf::get_random_with_prefix(out_t& x, const unsigned char* data, size_t len, const unsigned char& prefix)
+{
+    ACCA_PHASE(PHASE_HMAC);
+    if (suite == SUITE_BLAKE3) {
+        Blake3::ctx_t hash;
+        Blake3::initializeKeyed(hash, key);
+        Blake3::write(hash, &prefix, 1);
+        Blake3::write(hash, data, len);
+        Blake3::finalize(hash, x);
+        return;
+    }
+
+    // Together with the prefix, node encodings fit into the single block after the ipad block.
+    Sha256::ctx_t hash;
+    out_t in;
+    Sha256::initialize(hash, inner, Sha256::BLOCK_LEN);
+    Sha256::write(hash, &prefix, 1);
+    Sha256::write(hash, data, len);
+    Sha256::finalize(hash, in);
+    Sha256::initialize(hash, outer, Sha256::BLOCK_LEN);
+    Sha256::write(hash, in.data(), in.size());
+    Sha256::finalize(hash, x);
+}
+
+#define ACCA_INSTANTIATE_PRF(CT_LEN) \
+    template size_t Prf::encode<CT_LEN>(unsigned char* data, const Node<CT_LEN>& i) const; \
+    template void Prf::getX<CT_LEN>(Prf::out_t& x, const Node<CT_LEN>& i); \
+    template void Prf::getR<CT_LEN>(Prf::out_t& r, const Node<CT_LEN>& i); \
+    template void Prf::getXR<CT_LEN>(Prf::out_t& x, Prf::out_t& r, const Node<CT_LEN>& i);
+ACCA_FOR_EACH_CT_LEN(ACCA_INSTANTIATE_PRF)
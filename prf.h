@@ -28,13 +28,15 @@
 #define PRF_H
 
 #include "chameleonhash.h"
+#include "sha256.h"
+#include "suite.h"
 
 #include <assert.h>
 
 #include "secp256k1/src/hash.h"
 #include "secp256k1/src/hash_impl.h"
 
-class Node;
+template <size_t CT_LEN> class Node;
 
 class Prf
 {
@@ -46,19 +48,41 @@ public:
     typedef std::array<unsigned char, HASH_LEN> out_t;
     typedef std::vector<unsigned char> data_t;
 
-    Prf(key_t key);
-    Prf(ChameleonHash::sk_t dsk, bool extract);
+    Prf(key_t key, Suite suite = SUITE_SHA256, Derivation derivation = DERIVE_SEPARATE);
+    Prf(ChameleonHash::sk_t dsk, bool extract, Suite suite = SUITE_SHA256, Derivation derivation = DERIVE_SEPARATE);
 
-    void getX(out_t& x, Node& i);
-    void getR(out_t& r, Node& i);
+    template <size_t CT_LEN> void getX(out_t& x, const Node<CT_LEN>& i);
+    template <size_t CT_LEN> void getR(out_t& r, const Node<CT_LEN>& i);
+    template <size_t CT_LEN> void getXR(out_t& x, out_t& r, const Node<CT_LEN>& i);
+
+    // Writes the encoding of i that the derivation mode uses to data and returns its length,
+    // which is at most Node<CT_LEN>::BYTES_LEN.
+    template <size_t CT_LEN> size_t encode(unsigned char* data, const Node<CT_LEN>& i) const;
+
+    // The PRF on a raw node encoding, as written by encode.
+    void getX(out_t& x, const unsigned char* data, size_t len);
+    void getR(out_t& r, const unsigned char* data, size_t len);
+    void getXR(out_t& x, out_t& r, const unsigned char* data, size_t len);
+
+    // getXR on cnt encodings of len bytes each, stored back to back in data.
+    // With SUITE_SHA256, the evaluations run in parallel on the SIMD lanes of Sha256::hashMany.
+    void getXR(out_t* x, out_t* r, const unsigned char* data, size_t len, size_t cnt);
 
 private:
-    secp256k1_hmac_sha256_t hash;
     key_t key;
+    Suite suite;
+    Derivation derivation;
+    // SHA-256 chaining values after the HMAC ipad and opad blocks; every evaluation starts from them.
+    Sha256::state_t inner, outer;
 
     static const unsigned char X;
     static const unsigned char R;
-    void get_random_with_prefix(out_t& x, const data_t& data, const unsigned char& R);
+    static const unsigned char J;
+    void initialize();
+    void get_random_with_prefix(out_t& x, const unsigned char* data, size_t len, const unsigned char& prefix);
+    void getJoint(out_t& x, out_t& r, const unsigned char* data, size_t len);
+    void getSeparateBatch(out_t* x, out_t* r, const unsigned char* data, size_t len, size_t cnt);
+    void getJointBatch(out_t* x, out_t* r, const unsigned char* data, size_t len, size_t cnt);
 };
 
 #endif // PRF_H
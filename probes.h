@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT tracepoints (provider "acca") at the entry and exit of the signer and verifier entry
+// points, for attaching bpftrace or perf to running processes, e.g.,
+//
+//   bpftrace -e 'usdt:./authenticatortest:acca:verify_return { @[arg2] = count(); }'
+//
+// The probes come from sys/sdt.h if it is available (cmake enables ACCA_USDT then). Each probe
+// is a single NOP until a tracer attaches. Without sys/sdt.h, they expand to nothing.
+//
+// Arguments, in this order where present: CT_LEN, n (or cnt for batch operations), result.
+// Exit probes do not fire when the operation throws.
+
+#if defined(ACCA_USDT)
+#include <sys/sdt.h>
+#define ACCA_PROBE1(name, a1) DTRACE_PROBE1(acca, name, a1)
+#define ACCA_PROBE2(name, a1, a2) DTRACE_PROBE2(acca, name, a1, a2)
+#define ACCA_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(acca, name, a1, a2, a3)
+#define ACCA_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(acca, name, a1, a2, a3, a4)
+#else
+#define ACCA_PROBE1(name, a1) do {} while (0)
+#define ACCA_PROBE2(name, a1, a2) do {} while (0)
+#define ACCA_PROBE3(name, a1, a2, a3) do {} while (0)
+#define ACCA_PROBE4(name, a1, a2, a3, a4) do {} while (0)
+#endif
+
+#endif // PROBES_H
@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "sha256.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ACCA_SHA256_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include <assert.h>
+
+const Sha256::state_t Sha256::IV = {{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+}};
+
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t readBE32(const unsigned char* p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+inline void writeBE32(unsigned char* p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+inline uint32_t rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+// The kernels compress one block per lane. State and message words are stored lane-interleaved,
+// i.e., s[i][j] is word i of lane j.
+
+template <size_t LANES>
+void transformPortable(uint32_t (*s)[LANES], const uint32_t (*w)[LANES])
+{
+    for (size_t j = 0; j < LANES; j++) {
+        uint32_t W[16];
+        for (size_t i = 0; i < 16; i++) {
+            W[i] = w[i][j];
+        }
+        uint32_t a = s[0][j], b = s[1][j], c = s[2][j], d = s[3][j];
+        uint32_t e = s[4][j], f = s[5][j], g = s[6][j], h = s[7][j];
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC unroll 64
+#endif
+        for (size_t r = 0; r < 64; r++) {
+            if (r >= 16) {
+                uint32_t w15 = W[(r - 15) & 15], w2 = W[(r - 2) & 15];
+                W[r & 15] += (rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10)) + W[(r - 7) & 15]
+                           + (rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3));
+            }
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[r] + W[r & 15];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) | (c & (a | b)));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        s[0][j] += a; s[1][j] += b; s[2][j] += c; s[3][j] += d;
+        s[4][j] += e; s[5][j] += f; s[6][j] += g; s[7][j] += h;
+    }
+}
+
+#ifdef ACCA_SHA256_X86
+
+#define ACCA_AVX2_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+__attribute__((target("avx2")))
+void transformAvx2(uint32_t (*s)[8], const uint32_t (*w)[8])
+{
+    __m256i W[16];
+    for (size_t i = 0; i < 16; i++) {
+        W[i] = _mm256_loadu_si256((const __m256i*) w[i]);
+    }
+    __m256i a = _mm256_loadu_si256((const __m256i*) s[0]), b = _mm256_loadu_si256((const __m256i*) s[1]);
+    __m256i c = _mm256_loadu_si256((const __m256i*) s[2]), d = _mm256_loadu_si256((const __m256i*) s[3]);
+    __m256i e = _mm256_loadu_si256((const __m256i*) s[4]), f = _mm256_loadu_si256((const __m256i*) s[5]);
+    __m256i g = _mm256_loadu_si256((const __m256i*) s[6]), h = _mm256_loadu_si256((const __m256i*) s[7]);
+
+    for (size_t r = 0; r < 64; r++) {
+        if (r >= 16) {
+            __m256i w15 = W[(r - 15) & 15], w2 = W[(r - 2) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ACCA_AVX2_ROTR(w15, 7), ACCA_AVX2_ROTR(w15, 18)), _mm256_srli_epi32(w15, 3));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ACCA_AVX2_ROTR(w2, 17), ACCA_AVX2_ROTR(w2, 19)), _mm256_srli_epi32(w2, 10));
+            W[r & 15] = _mm256_add_epi32(_mm256_add_epi32(W[r & 15], s0), _mm256_add_epi32(s1, W[(r - 7) & 15]));
+        }
+        __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(ACCA_AVX2_ROTR(e, 6), ACCA_AVX2_ROTR(e, 11)), ACCA_AVX2_ROTR(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, S1), _mm256_add_epi32(ch, _mm256_add_epi32(_mm256_set1_epi32(K[r]), W[r & 15])));
+        __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(ACCA_AVX2_ROTR(a, 2), ACCA_AVX2_ROTR(a, 13)), ACCA_AVX2_ROTR(a, 22));
+        __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        __m256i t2 = _mm256_add_epi32(S0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+
+    __m256i out[8] = { a, b, c, d, e, f, g, h };
+    for (size_t i = 0; i < 8; i++) {
+        __m256i si = _mm256_loadu_si256((const __m256i*) s[i]);
+        _mm256_storeu_si256((__m256i*) s[i], _mm256_add_epi32(si, out[i]));
+    }
+}
+
+#undef ACCA_AVX2_ROTR
+
+__attribute__((target("avx512f")))
+void transformAvx512(uint32_t (*s)[16], const uint32_t (*w)[16])
+{
+    __m512i W[16];
+    for (size_t i = 0; i < 16; i++) {
+        W[i] = _mm512_loadu_si512(w[i]);
+    }
+    __m512i a = _mm512_loadu_si512(s[0]), b = _mm512_loadu_si512(s[1]);
+    __m512i c = _mm512_loadu_si512(s[2]), d = _mm512_loadu_si512(s[3]);
+    __m512i e = _mm512_loadu_si512(s[4]), f = _mm512_loadu_si512(s[5]);
+    __m512i g = _mm512_loadu_si512(s[6]), h = _mm512_loadu_si512(s[7]);
+
+    // 0x96 is a ^ b ^ c, 0xCA is a ? b : c, and 0xE8 is the majority of a, b and c.
+    for (size_t r = 0; r < 64; r++) {
+        if (r >= 16) {
+            __m512i w15 = W[(r - 15) & 15], w2 = W[(r - 2) & 15];
+            __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w15, 7), _mm512_ror_epi32(w15, 18), _mm512_srli_epi32(w15, 3), 0x96);
+            __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w2, 17), _mm512_ror_epi32(w2, 19), _mm512_srli_epi32(w2, 10), 0x96);
+            W[r & 15] = _mm512_add_epi32(_mm512_add_epi32(W[r & 15], s0), _mm512_add_epi32(s1, W[(r - 7) & 15]));
+        }
+        __m512i S1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11), _mm512_ror_epi32(e, 25), 0x96);
+        __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xCA);
+        __m512i t1 = _mm512_add_epi32(_mm512_add_epi32(h, S1), _mm512_add_epi32(ch, _mm512_add_epi32(_mm512_set1_epi32(K[r]), W[r & 15])));
+        __m512i S0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13), _mm512_ror_epi32(a, 22), 0x96);
+        __m512i t2 = _mm512_add_epi32(S0, _mm512_ternarylogic_epi32(a, b, c, 0xE8));
+        h = g;
+        g = f;
+        f = e;
+        e = _mm512_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm512_add_epi32(t1, t2);
+    }
+
+    __m512i out[8] = { a, b, c, d, e, f, g, h };
+    for (size_t i = 0; i < 8; i++) {
+        _mm512_storeu_si512(s[i], _mm512_add_epi32(_mm512_loadu_si512(s[i]), out[i]));
+    }
+}
+
+// Compresses cnt blocks with the SHA extensions. The state is kept in the ABEF/CDGH layout
+// that sha256rnds2 expects while the blocks are processed.
+__attribute__((target("sha,sse4.1")))
+void transformShaNi(uint32_t* s, const unsigned char* blocks, size_t cnt)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &s[0]), 0xB1); // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &s[4]), 0x1B); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+
+    for (; cnt > 0; cnt--, blocks += Sha256::BLOCK_LEN) {
+        __m128i abef = state0, cdgh = state1;
+        // w[g % 4] holds message words 4g to 4g + 3
+        __m128i w[4];
+        for (size_t g = 0; g < 16; g++) {
+            if (g < 4) {
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (blocks + 16 * g)), MASK);
+            }
+            else {
+                __m128i t = _mm_add_epi32(_mm_sha256msg1_epu32(w[g % 4], w[(g + 1) % 4]), _mm_alignr_epi8(w[(g + 3) % 4], w[(g + 2) % 4], 4));
+                w[g % 4] = _mm_sha256msg2_epu32(t, w[(g + 3) % 4]);
+            }
+            __m128i msg = _mm_add_epi32(w[g % 4], _mm_loadu_si128((const __m128i*) &K[4 * g]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+    _mm_storeu_si128((__m128i*) &s[0], _mm_blend_epi16(tmp, state1, 0xF0)); // DCBA
+    _mm_storeu_si128((__m128i*) &s[4], _mm_alignr_epi8(state1, tmp, 8)); // HGFE
+}
+
+#endif // ACCA_SHA256_X86
+
+// Hashes cnt <= LANES messages with KERNEL. Lanes whose message has fewer blocks than the
+// longest one keep running on zero blocks; their output has been taken before.
+template <size_t LANES, void (*KERNEL)(uint32_t (*)[LANES], const uint32_t (*)[LANES])>
+void hashGroup(Sha256::out_t* out, const unsigned char* const* in, const size_t* len, size_t cnt,
+               const Sha256::state_t& start, uint64_t startLen)
+{
+    uint32_t s[8][LANES];
+    uint32_t w[16][LANES];
+    size_t blocks[LANES];
+    size_t maxBlocks = 0;
+    unsigned char pad[Sha256::BLOCK_LEN];
+
+    for (size_t j = 0; j < LANES; j++) {
+        // 9 bytes for the 0x80 byte and the bit length
+        blocks[j] = j < cnt ? (len[j] + 9 + Sha256::BLOCK_LEN - 1) / Sha256::BLOCK_LEN : 0;
+        maxBlocks = std::max(maxBlocks, blocks[j]);
+        for (size_t i = 0; i < 8; i++) {
+            s[i][j] = start[i];
+        }
+    }
+
+    for (size_t b = 0; b < maxBlocks; b++) {
+        size_t off = b * Sha256::BLOCK_LEN;
+        for (size_t j = 0; j < LANES; j++) {
+            if (b >= blocks[j]) {
+                for (size_t i = 0; i < 16; i++) {
+                    w[i][j] = 0;
+                }
+                continue;
+            }
+            const unsigned char* p;
+            if (off + Sha256::BLOCK_LEN <= len[j]) {
+                p = in[j] + off;
+            }
+            else {
+                memset(pad, 0, sizeof pad);
+                if (off <= len[j]) {
+                    memcpy(pad, in[j] + off, len[j] - off);
+                    pad[len[j] - off] = 0x80;
+                }
+                if (b == blocks[j] - 1) {
+                    uint64_t bits = (startLen + len[j]) * 8;
+                    writeBE32(pad + 56, bits >> 32);
+                    writeBE32(pad + 60, bits);
+                }
+                p = pad;
+            }
+            for (size_t i = 0; i < 16; i++) {
+                w[i][j] = readBE32(p + 4 * i);
+            }
+        }
+
+        KERNEL(s, w);
+
+        for (size_t j = 0; j < cnt; j++) {
+            if (b == blocks[j] - 1) {
+                for (size_t i = 0; i < 8; i++) {
+                    writeBE32(out[j].data() + 4 * i, s[i][j]);
+                }
+            }
+        }
+    }
+}
+
+bool detectShaNi()
+{
+#ifdef ACCA_SHA256_X86
+    // __builtin_cpu_supports does not know "sha" in all compiler versions, so ask CPUID directly.
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7) {
+        return false;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    bool sha = (ebx & bit_SHA) != 0;
+    __cpuid(1, eax, ebx, ecx, edx);
+    return sha && (ecx & bit_SSE4_1) && (ecx & bit_SSSE3);
+#else
+    return false;
+#endif
+}
+
+Sha256::Backend detect()
+{
+#ifdef ACCA_SHA256_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return Sha256::AVX512;
+    }
+    // eight AVX2 lanes are about as fast as hashing one message after the other with SHA-NI
+    if (__builtin_cpu_supports("avx2") && !detectShaNi()) {
+        return Sha256::AVX2;
+    }
+#endif
+    return Sha256::SCALAR;
+}
+
+Sha256::Backend& selected()
+{
+    static Sha256::Backend b = detect();
+    return b;
+}
+
+bool& shaNiSelected()
+{
+    static bool b = detectShaNi();
+    return b;
+}
+
+}
+
+void Sha256::transform(state_t& s, const unsigned char* blocks, size_t cnt)
+{
+#ifdef ACCA_SHA256_X86
+    if (shaNiSelected()) {
+        transformShaNi(s.data(), blocks, cnt);
+        return;
+    }
+#endif
+    uint32_t sl[8][1], w[16][1];
+    for (size_t i = 0; i < 8; i++) {
+        sl[i][0] = s[i];
+    }
+    for (; cnt > 0; cnt--, blocks += BLOCK_LEN) {
+        for (size_t i = 0; i < 16; i++) {
+            w[i][0] = readBE32(blocks + 4 * i);
+        }
+        transformPortable<1>(sl, w);
+    }
+    for (size_t i = 0; i < 8; i++) {
+        s[i] = sl[i][0];
+    }
+}
+
+void Sha256::initialize(ctx_t& ctx, const state_t& start, uint64_t startLen)
+{
+    assert(startLen % BLOCK_LEN == 0);
+    ctx.s = start;
+    ctx.len = startLen;
+}
+
+void Sha256::write(ctx_t& ctx, const unsigned char* in, size_t len)
+{
+    size_t used = ctx.len % BLOCK_LEN;
+    ctx.len += len;
+    if (used) {
+        size_t n = std::min(len, BLOCK_LEN - used);
+        memcpy(ctx.buf + used, in, n);
+        in += n;
+        len -= n;
+        if (used + n < BLOCK_LEN) {
+            return;
+        }
+        transform(ctx.s, ctx.buf);
+    }
+    if (len >= BLOCK_LEN) {
+        transform(ctx.s, in, len / BLOCK_LEN);
+        in += len - len % BLOCK_LEN;
+        len %= BLOCK_LEN;
+    }
+    memcpy(ctx.buf, in, len);
+}
+
+void Sha256::finalize(ctx_t& ctx, out_t& out)
+{
+    uint64_t bits = ctx.len * 8;
+    size_t used = ctx.len % BLOCK_LEN;
+    ctx.buf[used++] = 0x80;
+    if (used > BLOCK_LEN - 8) {
+        memset(ctx.buf + used, 0, BLOCK_LEN - used);
+        transform(ctx.s, ctx.buf);
+        used = 0;
+    }
+    memset(ctx.buf + used, 0, BLOCK_LEN - 8 - used);
+    writeBE32(ctx.buf + BLOCK_LEN - 8, bits >> 32);
+    writeBE32(ctx.buf + BLOCK_LEN - 4, bits);
+    transform(ctx.s, ctx.buf);
+    for (size_t i = 0; i < 8; i++) {
+        writeBE32(out.data() + 4 * i, ctx.s[i]);
+    }
+}
+
+void Sha256::hash(out_t& out, const unsigned char* in, size_t len)
+{
+    ctx_t ctx;
+    initialize(ctx);
+    write(ctx, in, len);
+    finalize(ctx, out);
+}
+
+void Sha256::hmacMidstates(state_t& inner, state_t& outer, const unsigned char* key, size_t len)
+{
+    assert(len <= BLOCK_LEN);
+    unsigned char pad[BLOCK_LEN];
+
+    memset(pad, 0x36, sizeof pad);
+    for (size_t i = 0; i < len; i++) {
+        pad[i] ^= key[i];
+    }
+    inner = IV;
+    transform(inner, pad);
+
+    memset(pad, 0x5c, sizeof pad);
+    for (size_t i = 0; i < len; i++) {
+        pad[i] ^= key[i];
+    }
+    outer = IV;
+    transform(outer, pad);
+}
+
+void Sha256::hashMany(out_t* out, const unsigned char* const* in, const size_t* len, size_t cnt,
+                      const state_t& start, uint64_t startLen)
+{
+    Backend b = backend();
+    size_t i = 0;
+    while (i < cnt) {
+        size_t left = cnt - i;
+#ifdef ACCA_SHA256_X86
+        // Half-empty groups still pay for all lanes, so use the widest backend only when it is filled well.
+        if (b == AVX512 && left > 8) {
+            size_t n = std::min<size_t>(left, 16);
+            hashGroup<16, transformAvx512>(out + i, in + i, len + i, n, start, startLen);
+            i += n;
+            continue;
+        }
+        // With SHA-NI, the few messages left over by AVX-512 are faster one after the other.
+        if (left > 1 && (b == AVX2 || (b == AVX512 && !shaNiSelected()))) {
+            size_t n = std::min<size_t>(left, 8);
+            hashGroup<8, transformAvx2>(out + i, in + i, len + i, n, start, startLen);
+            i += n;
+            continue;
+        }
+#endif
+        // a single message gains nothing from lanes, but may run on SHA-NI
+        ctx_t ctx;
+        initialize(ctx, start, startLen);
+        write(ctx, in[i], len[i]);
+        finalize(ctx, out[i]);
+        i++;
+    }
+}
+
+Sha256::Backend Sha256::backend()
+{
+    return selected();
+}
+
+bool Sha256::setBackend(Backend b)
+{
+#ifdef ACCA_SHA256_X86
+    __builtin_cpu_init();
+    if ((b == AVX512 && !__builtin_cpu_supports("avx512f")) || (b == AVX2 && !__builtin_cpu_supports("avx2"))) {
+        return false;
+    }
+#else
+    if (b != SCALAR) {
+        return false;
+    }
+#endif
+    selected() = b;
+    return true;
+}
+
+bool Sha256::shaNi()
+{
+    return shaNiSelected();
+}
+
+bool Sha256::setShaNi(bool enable)
+{
+    if (enable && !detectShaNi()) {
+        return false;
+    }
+    shaNiSelected() = enable;
+    return true;
+}
+
+const char* Sha256::backendName(Backend b)
+{
+    switch (b) {
+    case AVX512:
+        return "avx512";
+    case AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
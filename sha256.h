@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+
+// SHA-256 for single messages and for many independent messages at once.
+//
+// Single messages are compressed with the SHA extensions (SHA-NI) where the CPU has them.
+// hashMany processes up to 16 (AVX-512) or 8 (AVX2) messages in SIMD lanes. Both fall back to a
+// portable implementation on other CPUs. The outputs are identical to those of the
+// secp256k1_sha256_* functions.
+class Sha256
+{
+public:
+    static const size_t OUT_LEN = 32;
+    static const size_t BLOCK_LEN = 64;
+
+    typedef std::array<unsigned char, OUT_LEN> out_t;
+    typedef std::array<uint32_t, 8> state_t;
+
+    // Backends of hashMany. SCALAR hashes one message after the other, with SHA-NI if enabled.
+    enum Backend {
+        SCALAR,
+        AVX2,
+        AVX512
+    };
+
+    static const state_t IV;
+
+    // Incremental hashing, like secp256k1_sha256_t.
+    struct ctx_t {
+        state_t s;
+        unsigned char buf[BLOCK_LEN];
+        uint64_t len;
+    };
+
+    // Compresses cnt consecutive blocks into s.
+    static void transform(state_t& s, const unsigned char* blocks, size_t cnt = 1);
+
+    // start and startLen continue from a chaining value, as for hashMany below.
+    static void initialize(ctx_t& ctx, const state_t& start = IV, uint64_t startLen = 0);
+    static void write(ctx_t& ctx, const unsigned char* in, size_t len);
+    static void finalize(ctx_t& ctx, out_t& out);
+    static void hash(out_t& out, const unsigned char* in, size_t len);
+
+    // Chaining values after the ipad and the opad block of HMAC-SHA256 with a key of at most
+    // BLOCK_LEN bytes.
+    static void hmacMidstates(state_t& inner, state_t& outer, const unsigned char* key, size_t len);
+
+    // Hashes the cnt messages in[i] of length len[i]. Every message is preceded by startLen bytes,
+    // a multiple of BLOCK_LEN, that led to the chaining value start. This allows to continue from
+    // HMAC midstates.
+    static void hashMany(out_t* out, const unsigned char* const* in, const size_t* len, size_t cnt,
+                         const state_t& start = IV, uint64_t startLen = 0);
+
+    // The fastest backend supported by the CPU is selected on first use. Selecting a backend
+    // explicitly is meant for tests and benchmarks; it fails if the CPU does not support it.
+    static Backend backend();
+    static bool setBackend(Backend b);
+    static const char* backendName(Backend b);
+
+    // The same for the SHA-NI single-message path.
+    static bool shaNi();
+    static bool setShaNi(bool enable);
+};
+
+#endif // SHA256_H
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <vector>
+
+// Bounded lock-free queue between one producer thread and one consumer thread. The two
+// indices live on separate cache lines, and each side keeps a copy of the other side's index,
+// so that it reads the other side's cache line only when the ring looks full or empty.
+template <typename T>
+class SpscRing
+{
+public:
+    // The capacity is rounded up to a power of two.
+    explicit SpscRing(size_t capacity) : head(0), cachedTail(0), tail(0), cachedHead(0) {
+        size_t c = 1;
+        while (c < capacity) {
+            c *= 2;
+        }
+        slots.resize(c);
+        mask = c - 1;
+    }
+
+    // Producer side. Returns false if the ring is full.
+    bool tryPush(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) {
+                return false;
+            }
+        }
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool tryPop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return false;
+            }
+        }
+        value = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static const size_t CACHE_LINE = 64;
+
+    // The sides are separated by padding rather than alignas, which plain new ignores before
+    // C++17: members CACHE_LINE bytes apart never share a cache line, wherever the ring is.
+    std::vector<T> slots;
+    size_t mask;
+    char padSlots[CACHE_LINE];
+    // written by the consumer
+    std::atomic<size_t> head;
+    size_t cachedTail;
+    char padHead[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    // written by the producer
+    std::atomic<size_t> tail;
+    size_t cachedHead;
+    char padTail[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    SpscRing(const SpscRing&);
+    SpscRing& operator=(const SpscRing&);
+};
+
+#endif // SPSCRING_H
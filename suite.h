@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef SUITE_H
+#define SUITE_H
+
+// Symmetric primitives behind the PRF, the digests of the tree and the random oracle.
+// The suite of an authenticator is recorded in its dpk, so tokens are always verified with the
+// suite they were created with. Statements are digested with SHA-256 in every suite, because
+// their digests are merged across signers.
+enum Suite : unsigned char {
+    // HMAC-SHA256 and SHA-256; the original scheme
+    SUITE_SHA256 = 0,
+    // keyed BLAKE3 and BLAKE3
+    SUITE_BLAKE3 = 1
+};
+
+inline bool isValidSuite(Suite suite)
+{
+    return suite == SUITE_SHA256 || suite == SUITE_BLAKE3;
+}
+
+// How the Prf derives the x and r values of a node. Like the suite, the mode is recorded in the dpk.
+enum Derivation : unsigned char {
+    // x and r from separate PRF evaluations on the original node encoding, see Node::bytes
+    DERIVE_SEPARATE = 0,
+    // x and r from a single PRF evaluation on the full-width encoding, see Node::wideBytes.
+    // With SHA-256, x and r share the inner hash of the HMAC and differ only in the outer hash.
+    // With BLAKE3, they are the two halves of a 64-byte output.
+    DERIVE_JOINT = 1
+};
+
+inline bool isValidDerivation(Derivation derivation)
+{
+    return derivation == DERIVE_SEPARATE || derivation == DERIVE_JOINT;
+}
+
+#endif // SUITE_H
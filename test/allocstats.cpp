@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "allocstats.h"
+
+#include <stddef.h>
+
+namespace {
+
+// plain TLS, so that counting does not allocate
+__thread uint64_t count_ = 0;
+__thread uint64_t bytes_ = 0;
+
+inline void record(size_t size)
+{
+    count_++;
+    bytes_ += size;
+}
+
+}
+
+void AllocStats::snapshot(stats_t& stats)
+{
+    stats.count = count_;
+    stats.bytes = bytes_;
+}
+
+#if defined(__GLIBC__)
+
+#include <errno.h>
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* p);
+
+void* malloc(size_t size)
+{
+    record(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    record(n * size);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t size)
+{
+    record(size);
+    return __libc_realloc(p, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    record(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** p, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    *p = memalign(alignment, size);
+    return *p || !size ? 0 : ENOMEM;
+}
+
+void free(void* p)
+{
+    __libc_free(p);
+}
+
+}
+
+#else
+
+#include <cstdlib>
+#include <new>
+
+void* operator new(size_t size)
+{
+    record(size);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <stdint.h>
+
+// Counts heap allocations per thread. Linking allocstats.cpp into an executable interposes
+// malloc and friends (with glibc) or operator new (elsewhere), so allocations by the library,
+// libsecp256k1 and the standard library are all seen.
+class AllocStats
+{
+public:
+    struct stats_t {
+        uint64_t count;
+        uint64_t bytes;
+    };
+
+    // Allocations of the calling thread since it started.
+    static void snapshot(stats_t& stats);
+
+    // Allocations of the calling thread since construction.
+    class Scope
+    {
+    public:
+        Scope() {
+            snapshot(start);
+        }
+        stats_t get() const {
+            stats_t now;
+            snapshot(now);
+            now.count -= start.count;
+            now.bytes -= start.bytes;
+            return now;
+        }
+    private:
+        stats_t start;
+    };
+};
+
+#endif // ALLOCSTATS_H
@@ -27,11 +27,27 @@
 #include <gtest/gtest.h>
 #include "../chameleonhash.h"
 #include "../authenticator.h"
-#include <ctime>
+#include "../aggregateproof.h"
+#include "../tokenbatch.h"
+#include "../sha256.h"
+#include "../blake3.h"
+#include "../node.h"
+#include "../ecmultlanes.h"
+#include "../hugepages.h"
+#include "../instrument.h"
+#include "../asyncauthenticator.h"
+#include "../verifypipeline.h"
+#include "../numa.h"
+#include "../plan.h"
+#include "../daemon/coalescer.h"
+#include "allocstats.h"
 #include <random>
+#include <thread>
 #include <array>
 #include <iomanip>
 #include <cstdio>
+#include <atomic>
+#include <unistd.h>
 
 using namespace std;
 
@@ -206,6 +222,63 @@ TEST_F(AuthenticatorTest, AuthenticatorExtractSimple) {
     EXPECT_EQ(sk, acca.getDsk());
 }
 
+// The PRF outputs, and thus the node encoding, are committed to in every dpk.
+TEST_F(AuthenticatorTest, AuthenticatorKnownAnswer) {
+    const ChameleonHash::digest_t rootDigest = {
+        0xc8, 0x3f, 0x3f, 0xfe, 0x82, 0x1c, 0xd7, 0xb6,
+        0x4a, 0xf4, 0x98, 0x6a, 0x24, 0xb7, 0x92, 0xb2,
+        0x77, 0xdf, 0x82, 0x43, 0xd2, 0xf8, 0x55, 0x52,
+        0xee, 0x20, 0x71, 0x51, 0x39, 0x40, 0xba, 0xa4
+    };
+    const ChameleonHash::hash_t leafSibling = {
+        0x02,
+        0xfb, 0x03, 0xc1, 0x0d, 0xa4, 0xf6, 0x50, 0x8b,
+        0x49, 0x8a, 0x37, 0x77, 0xd1, 0x18, 0x24, 0x66,
+        0x13, 0x61, 0x2f, 0xf9, 0x78, 0xc3, 0xc7, 0x66,
+        0x97, 0x1c, 0x99, 0xa2, 0xd3, 0xa3, 0xa6, 0xef
+    };
+    const ChameleonHash::rand_t leafR = {
+        0x16, 0x52, 0x42, 0x9b, 0xa4, 0x18, 0xc5, 0xb7,
+        0xe8, 0x5d, 0x91, 0xf6, 0x32, 0x2b, 0x90, 0xd6,
+        0xff, 0x49, 0xd2, 0x67, 0x84, 0x96, 0x78, 0xb9,
+        0x1d, 0xf6, 0x75, 0x87, 0xa9, 0x9c, 0x76, 0x2b
+    };
+
+    Authenticator acca(sk, sk, 0);
+    EXPECT_EQ(rootDigest, acca.getDpk().rootDigest);
+    if (Authenticator::CT_LEN == 8) {
+        Authenticator::token_t t;
+        acca.authenticate(t, ct, m1, 2);
+        EXPECT_EQ(leafSibling, t.chs[0]);
+        EXPECT_EQ(leafR, t.rs[0]);
+    }
+}
+
+template <size_t CT_LEN>
+static void authenticateVerifyExtract(const ChameleonHash::sk_t& sk, const ChameleonHash::W& w, const Authenticator::ct_t& ct,
+                                      const ChameleonHash::mesg_t& m1, const ChameleonHash::mesg_t& m2) {
+    BasicAuthenticator<CT_LEN> acca(sk, w, 0);
+    typename BasicAuthenticator<CT_LEN>::ct_t shortCt;
+    copy(ct.begin(), ct.begin() + CT_LEN, shortCt.begin());
+    typename BasicAuthenticator<CT_LEN>::token_t t0, t1, t2;
+
+    acca.authenticate(t0, shortCt, m1, 0);
+    BasicAuthenticator<CT_LEN> verifier(acca.getDpk(), w);
+    EXPECT_TRUE(verifier.verify(t0, shortCt, m1, 0));
+    EXPECT_FALSE(verifier.verify(t0, shortCt, m2, 0));
+
+    acca.authenticate(t1, shortCt, m1, 1);
+    acca.authenticate(t2, shortCt, m2, 2);
+    acca.extract(t1, t2, shortCt, m1, m2, 1, 2);
+    EXPECT_EQ(sk, acca.getDsk());
+}
+
+TEST_F(AuthenticatorTest, AuthenticatorShortContexts) {
+    EXPECT_EQ(2u * 8 * 65, sizeof(BasicAuthenticator<2>::token_t));
+    authenticateVerifyExtract<2>(sk, w, ct, m1, m2);
+    authenticateVerifyExtract<4>(sk, w, ct, m1, m2);
+}
+
 TEST_F(AuthenticatorTest, AuthenticatorMergeVerifySimple) {
 	Authenticator acca(sk, w, 0);
 	ChameleonHash::hash_t hash;
@@ -223,22 +296,912 @@ TEST_F(AuthenticatorTest, AuthenticatorMergeVerifySimple) {
 	EXPECT_TRUE(acca.verifys(t, 2, ct, n, pks, w, hash));
 }
 
-TEST_F(AuthenticatorTest, TestSingleDataTime) {
+TEST_F(AuthenticatorTest, AuthenticatorBatchArrays) {
+    Authenticator acca(sk, w, 0);
+    ChameleonHash::hash_t hash;
+    const int n[3] = { 3, 1, 3 };
+    const Authenticator::st_t ms[3] = { xs[0], xs[1], xs[2] };
+    Authenticator::token_t t[3];
+    ChameleonHash::pk_t pks[3];
+    for (int i = 0; i < 3; i++) {
+        ChameleonHash chsk(sk, w, n[i]);
+        pks[i] = chsk.getPk(true);
+    }
+
+    acca.authenticates(t, ms, n, 3, ct, hash);
+    EXPECT_EQ(3, n[0]);
+    EXPECT_EQ(1, n[1]);
+    EXPECT_TRUE(acca.verifys(t, ms, pks, 3, hash));
+    EXPECT_FALSE(acca.verifys(t, ms, pks, 2, hash));
+    EXPECT_FALSE(acca.verifys(t, ms + 1, pks, 2, hash));
+}
+
+TEST_F(AuthenticatorTest, AuthenticatorTokenBatch) {
+    Authenticator acca(sk, w, 0);
+    ChameleonHash::hash_t hash;
+    TokenBatch batch(2, 64);
+    ChameleonHash::pk_t pks[3];
+    for (int i = 0; i < 3; i++) {
+        // the third item grows the batch beyond its reserved capacity
+        batch.add(xs[i], i + 1);
+        ChameleonHash chsk(sk, w, i + 1);
+        pks[i] = chsk.getPk(true);
+    }
+    acca.authenticates(batch, ct, hash);
+    EXPECT_TRUE(acca.verifys(batch, pks, hash));
+
+    Authenticator::token_t t;
+    acca.authenticate(t, ct, xs[1], 2);
+    for (size_t l = 0; l < Authenticator::DEPTH; l++) {
+        EXPECT_EQ(t.rs[l], batch.rs(1)[l * batch.stride()]);
+        EXPECT_EQ(t.chs[l], batch.chs(1)[l * batch.stride()]);
+    }
+
+    Authenticator acca0(sk, w, 0);
+    batch.reset();
+    batch.add(m1, 0);
+    batch.add(m2, 0);
+    EXPECT_EQ(2u, batch.size());
+    acca0.authenticates(batch, ct, hash);
+    Authenticator verifier(acca0.getDpk(), w);
+    EXPECT_TRUE(verifier.verify(batch, 0, ct));
+    EXPECT_TRUE(verifier.verify(batch, 1, ct));
+    EXPECT_EQ(m2, Authenticator::st_t(batch.statement(1), batch.statement(1) + batch.statementLen(1)));
+}
+
+TEST_F(AuthenticatorTest, AuthenticatorVerifyBatch) {
+    Authenticator acca(sk, w, 0);
+    ChameleonHash::hash_t hash;
+    TokenBatch batch;
+    for (int i = 0; i < 3; i++) {
+        batch.add(xs[i], 0);
+    }
+    acca.authenticates(batch, ct, hash);
+
+    Authenticator verifier(acca.getDpk(), w);
+    Authenticator::ct_t cts[3] = { ct, ct, ct };
+    bool results[3];
+    verifier.verifyBatch(batch, cts, results);
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_TRUE(results[i]);
+    }
+
+    cts[1][0] ^= 1;
+    batch.chs(2)[5 * batch.stride()][7] ^= 1;
+    verifier.verifyBatch(batch, cts, results);
+    EXPECT_TRUE(results[0]);
+    EXPECT_FALSE(results[1]);
+    EXPECT_FALSE(results[2]);
+    EXPECT_FALSE(verifier.verify(batch, 2, ct));
+}
+
+TEST_F(AuthenticatorTest, Sha256ManyBuffers) {
+    const Sha256::Backend best = Sha256::backend();
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<> byte(0, 255);
+    // 64 bytes that precede every message in the second round
+    unsigned char prefix[Sha256::BLOCK_LEN];
+    for (size_t i = 0; i < sizeof prefix; i++) {
+        prefix[i] = byte(gen);
+    }
+    Sha256::state_t mid = Sha256::IV;
+    Sha256::transform(mid, prefix);
+
+    // lengths around all padding boundaries and in every lane position
+    const size_t CNT = 140;
+    std::vector<std::vector<unsigned char>> msgs(CNT);
+    std::vector<const unsigned char*> in(CNT);
+    std::vector<size_t> len(CNT);
+    for (size_t i = 0; i < CNT; i++) {
+        msgs[i].resize(i);
+        for (size_t j = 0; j < i; j++) {
+            msgs[i][j] = byte(gen);
+        }
+        in[i] = msgs[i].data();
+        len[i] = i;
+    }
+
+    Sha256::Backend backends[] = { Sha256::SCALAR, Sha256::AVX2, Sha256::AVX512 };
+    for (Sha256::Backend b : backends) {
+        if (!Sha256::setBackend(b)) {
+            continue;
+        }
+        for (int round = 0; round < 2; round++) {
+            // odd counts leave lanes idle
+            for (size_t cnt : { CNT, (size_t) 13, (size_t) 1 }) {
+                std::vector<Sha256::out_t> out(cnt);
+                if (round == 0) {
+                    Sha256::hashMany(out.data(), in.data() + CNT - cnt, len.data() + CNT - cnt, cnt);
+                }
+                else {
+                    Sha256::hashMany(out.data(), in.data() + CNT - cnt, len.data() + CNT - cnt, cnt, mid, Sha256::BLOCK_LEN);
+                }
+                for (size_t i = 0; i < cnt; i++) {
+                    Sha256::out_t expected;
+                    secp256k1_sha256_t sha;
+                    secp256k1_sha256_initialize(&sha);
+                    if (round == 1) {
+                        secp256k1_sha256_write(&sha, prefix, sizeof prefix);
+                    }
+                    secp256k1_sha256_write(&sha, in[CNT - cnt + i], len[CNT - cnt + i]);
+                    secp256k1_sha256_finalize(&sha, expected.data());
+                    EXPECT_EQ(expected, out[i]) << Sha256::backendName(b) << " length " << len[CNT - cnt + i];
+                }
+            }
+        }
+    }
+    Sha256::setBackend(best);
+}
+
+TEST_F(AuthenticatorTest, Sha256SingleStream) {
+    const bool shaNi = Sha256::shaNi();
+    std::mt19937 gen(2);
+    std::uniform_int_distribution<> byte(0, 255);
+    std::vector<unsigned char> msg(300);
+    for (size_t i = 0; i < msg.size(); i++) {
+        msg[i] = byte(gen);
+    }
+
+    for (bool enable : { false, true }) {
+        if (!Sha256::setShaNi(enable)) {
+            continue;
+        }
+        for (size_t len = 0; len <= msg.size(); len += 7) {
+            Sha256::out_t expected, out;
+            secp256k1_sha256_t sha;
+            secp256k1_sha256_initialize(&sha);
+            secp256k1_sha256_write(&sha, msg.data(), len);
+            secp256k1_sha256_finalize(&sha, expected.data());
+
+            // split the message to exercise the buffering in write
+            Sha256::ctx_t ctx;
+            Sha256::initialize(ctx);
+            Sha256::write(ctx, msg.data(), len / 3);
+            Sha256::write(ctx, msg.data() + len / 3, len - len / 3);
+            Sha256::finalize(ctx, out);
+            EXPECT_EQ(expected, out) << "SHA-NI " << enable << " length " << len;
+        }
+
+        ChameleonHash::hash_t h1 = ch1, expected, out;
+        secp256k1_hmac_sha256_t hmac;
+        unsigned char key[] = "RandomOracleGRandomOracleGRandom";
+        secp256k1_hmac_sha256_initialize(&hmac, key, 32);
+        secp256k1_hmac_sha256_write(&hmac, h1.data(), h1.size());
+        secp256k1_hmac_sha256_write(&hmac, r1.data(), r1.size());
+        secp256k1_hmac_sha256_finalize(&hmac, expected.data());
+        expected[32] = 0;
+        ChameleonHash::randomOracle(out, h1, r1);
+        EXPECT_EQ(expected, out);
+    }
+    Sha256::setShaNi(shaNi);
+}
+
+TEST_F(AuthenticatorTest, Blake3KnownAnswer) {
+    // from the official BLAKE3 test vectors, input length 1025
+    const Blake3::out_t expected = {
+        0xd0, 0x02, 0x78, 0xae, 0x47, 0xeb, 0x27, 0xb3, 0x4f, 0xae, 0xcf, 0x67, 0xb4, 0xfe, 0x26, 0x3f,
+        0x82, 0xd5, 0x41, 0x29, 0x16, 0xc1, 0xff, 0xd9, 0x7c, 0x8c, 0xb7, 0xfb, 0x81, 0x4b, 0x84, 0x44
+    };
+    const Blake3::out_t expectedKeyed = {
+        0x35, 0x7d, 0xc5, 0x5d, 0xe0, 0xc7, 0xe3, 0x82, 0xc9, 0x00, 0xfd, 0x6e, 0x32, 0x0a, 0xcc, 0x04,
+        0x14, 0x6b, 0xe0, 0x1d, 0xb6, 0xa8, 0xce, 0x72, 0x10, 0xb7, 0x18, 0x9b, 0xd6, 0x64, 0xea, 0x69
+    };
+    std::vector<unsigned char> in(1025);
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = i % 251;
+    }
+    Blake3::key_t key;
+    const char* k = "whats the Elvish word for friend";
+    std::copy(k, k + key.size(), key.begin());
+
+    Blake3::out_t out;
+    Blake3::hash(out, in.data(), in.size());
+    EXPECT_EQ(expected, out);
+    Blake3::ctx_t ctx;
+    Blake3::initializeKeyed(ctx, key);
+    Blake3::write(ctx, in.data(), 100);
+    Blake3::write(ctx, in.data() + 100, in.size() - 100);
+    Blake3::finalize(ctx, out);
+    EXPECT_EQ(expectedKeyed, out);
+}
+
+TEST_F(AuthenticatorTest, AuthenticatorBlake3Suite) {
+    Authenticator acca(sk, w, 0, SUITE_BLAKE3);
+    Authenticator::dpk_t dpk = acca.getDpk();
+    EXPECT_EQ(SUITE_BLAKE3, dpk.suite);
+    EXPECT_NE(Authenticator(sk, w, 0).getDpk().rootDigest, dpk.rootDigest);
+
+    Authenticator::token_t t, t1, t2;
+    acca.authenticate(t, ct, m1, 0);
+    Authenticator verifier(dpk, w);
+    EXPECT_TRUE(verifier.verify(t, ct, m1, 0));
+    EXPECT_FALSE(verifier.verify(t, ct, m2, 0));
+
+    TokenBatch batch;
+    batch.add(m1, 0);
+    batch.add(m2, 0);
+    ChameleonHash::hash_t hash;
+    acca.authenticates(batch, ct, hash);
+    Authenticator::ct_t cts[2] = { ct, ct };
+    bool results[2];
+    verifier.verifyBatch(batch, cts, results);
+    EXPECT_TRUE(results[0]);
+    EXPECT_TRUE(results[1]);
+
+    // the suite is part of the dpk
+    dpk.suite = SUITE_SHA256;
+    EXPECT_FALSE(Authenticator(dpk, w).verify(t, ct, m1, 0));
+    dpk.suite = (Suite) 0xff;
+    EXPECT_THROW(Authenticator(dpk, w), std::invalid_argument);
+
+    acca.authenticate(t1, ct, m1, 1);
+    acca.authenticate(t2, ct, m2, 2);
+    acca.extract(t1, t2, ct, m1, m2, 1, 2);
+    EXPECT_EQ(sk, acca.getDsk());
+}
+
+TEST_F(AuthenticatorTest, AuthenticatorJointDerivation) {
+    for (Suite suite : { SUITE_SHA256, SUITE_BLAKE3 }) {
+        Authenticator acca(sk, w, 0, suite, DERIVE_JOINT);
+        Authenticator::dpk_t dpk = acca.getDpk();
+        EXPECT_EQ(DERIVE_JOINT, dpk.derivation);
+        EXPECT_NE(Authenticator(sk, w, 0, suite).getDpk().rootDigest, dpk.rootDigest);
+
+        // verification does not depend on the derivation mode, but the rootDigest does
+        Authenticator::token_t t, t1, t2;
+        acca.authenticate(t, ct, m1, 0);
+        Authenticator verifier(dpk, w);
+        EXPECT_TRUE(verifier.verify(t, ct, m1, 0));
+        EXPECT_FALSE(verifier.verify(t, ct, m2, 0));
+
+        acca.authenticate(t1, ct, m1, 1);
+        acca.authenticate(t2, ct, m2, 2);
+        acca.extract(t1, t2, ct, m1, m2, 1, 2);
+        EXPECT_EQ(sk, acca.getDsk());
+    }
+
+    Authenticator::dpk_t dpk = Authenticator(sk, w, 0).getDpk();
+    dpk.derivation = (Derivation) 0xff;
+    EXPECT_THROW(Authenticator(dpk, w), std::invalid_argument);
+}
+
+TEST_F(AuthenticatorTest, NodeWideEncoding) {
+    // The original encoding drops the high byte of every limb; the wide one keeps all of ct.
+    Node<8>::ct_t a = {{ 0x01, 2, 3, 4, 5, 6, 7, 8 }}, b = a;
+    b[0] = 0x02;
+    Node<8> na(a), nb(b);
+    EXPECT_EQ(na.bytes(), nb.bytes());
+    Node<8>::wide_t wa, wb;
+    na.wideBytes(wa);
+    nb.wideBytes(wb);
+    EXPECT_NE(wa, wb);
+    const Node<8>::wide_t expected = {{ 0, 64, 0x01, 2, 3, 4, 5, 6, 7, 8 }};
+    EXPECT_EQ(expected, wa);
+}
+
+static std::array<unsigned char, 32> feBytes(const secp256k1_fe_t& a)
+{
+    secp256k1_fe_t n = a;
+    std::array<unsigned char, 32> b;
+    secp256k1_fe_normalize(&n);
+    secp256k1_fe_get_b32(b.data(), &n);
+    return b;
+}
+
+static std::array<unsigned char, 64> gejBytes(const secp256k1_gej_t& a)
+{
+    secp256k1_gej_t aj = a;
+    secp256k1_ge_t ge;
+    secp256k1_ge_set_gej(&ge, &aj);
+    std::array<unsigned char, 32> x = feBytes(ge.x), y = feBytes(ge.y);
+    std::array<unsigned char, 64> b;
+    std::copy(x.begin(), x.end(), b.begin());
+    std::copy(y.begin(), y.end(), b.begin() + 32);
+    return b;
+}
+
+TEST_F(AuthenticatorTest, EcmultLanesFieldOps) {
+    const size_t L = EcmultLanes::LANES;
+    secp256k1_fe_t a[L], b[L], r[L], expected;
+    unsigned char bytes[32];
+    for (size_t i = 0; i < L; i++) {
+        for (size_t j = 0; j < 32; j++) {
+            bytes[j] = gen();
+        }
+        // lane 0 is p - 1 and lane 1 is 2^256 - 2^224, close to the reduction boundaries
+        if (i < 2) {
+            memset(bytes, 0xff, 32);
+            if (i == 0) {
+                bytes[27] = 0xfe;
+                bytes[30] = 0xfc;
+                bytes[31] = 0x2e;
+            }
+            else {
+                memset(bytes + 4, 0, 28);
+            }
+        }
+        secp256k1_fe_set_b32(&a[i], bytes);
+        secp256k1_fe_set_b32(&b[i], rs[i].data());
+    }
+
+    EcmultLanes::feMul(r, a, b);
+    for (size_t i = 0; i < L; i++) {
+        secp256k1_fe_mul(&expected, &a[i], &b[i]);
+        EXPECT_EQ(feBytes(expected), feBytes(r[i]));
+    }
+    EcmultLanes::feSqr(r, a);
+    for (size_t i = 0; i < L; i++) {
+        secp256k1_fe_sqr(&expected, &a[i]);
+        EXPECT_EQ(feBytes(expected), feBytes(r[i]));
+    }
+}
+
+TEST_F(AuthenticatorTest, EcmultLanesGroupOps) {
+    const size_t L = EcmultLanes::LANES;
+    secp256k1_gej_t a[L], r[L], expected;
+    secp256k1_ge_t b[L];
+    ChameleonHash ch(pk, w);
+    for (size_t i = 0; i < L; i++) {
+        secp256k1_scalar_t s;
+        secp256k1_scalar_set_b32(&s, rs[i].data(), nullptr);
+        secp256k1_ecmult_gen(&a[i], &s);
+        // a Jacobian point with z != 1, and an affine one
+        secp256k1_gej_double_var(&a[i], &a[i]);
+        secp256k1_scalar_set_b32(&s, rs[L + i].data(), nullptr);
+        secp256k1_gej_t bj;
+        secp256k1_ecmult_gen(&bj, &s);
+        secp256k1_ge_set_gej(&b[i], &bj);
+    }
+
+    EcmultLanes::gejDouble(r, a);
+    for (size_t i = 0; i < L; i++) {
+        secp256k1_gej_double_var(&expected, &a[i]);
+        EXPECT_EQ(gejBytes(expected), gejBytes(r[i]));
+    }
+    EcmultLanes::gejAddGe(r, a, b);
+    for (size_t i = 0; i < L; i++) {
+        secp256k1_gej_add_ge_var(&expected, &a[i], &b[i]);
+        EXPECT_EQ(gejBytes(expected), gejBytes(r[i]));
+    }
+}
+
+TEST_F(AuthenticatorTest, ChBatch) {
+    const size_t cnt = 2 * EcmultLanes::LANES + 3;
+    ChameleonHash::digest_t m[cnt];
+    const ChameleonHash::rand_t* r[cnt];
+    ChameleonHash::rand_t zero = {};
+    int ns[cnt];
+    for (size_t i = 0; i < cnt; i++) {
+        ChameleonHash::digest(m[i], xs[i]);
+        r[i] = &rs[i];
+        ns[i] = 0;
+    }
+    // ch(m, 0) = m * G, and ch(0, r) = r * pk
+    r[1] = &zero;
+    m[2] = ChameleonHash::digest_t();
+
+    bool enabled = EcmultLanes::enabled();
+    for (int pass = 0; pass < 2; pass++) {
+        ChameleonHash ch(pk, w);
+        ChameleonHash::hash_t res[cnt], expected;
+        ch.ch(res, m, r, ns, cnt);
+        for (size_t i = 0; i < cnt; i++) {
+            ch.ch(expected, m[i], *r[i], ns[i]);
+            EXPECT_EQ(expected, res[i]);
+        }
+        EXPECT_TRUE(EcmultLanes::setEnabled(false));
+    }
+    EcmultLanes::setEnabled(enabled);
+
+    ChameleonHash::rand_t overflow;
+    overflow.fill(0xff);
+    r[3] = &overflow;
+    ChameleonHash ch(pk, w);
+    ChameleonHash::hash_t res[cnt];
+    EXPECT_THROW(ch.ch(res, m, r, ns, cnt), std::invalid_argument);
+}
+
+TEST_F(AuthenticatorTest, HugePagesAllocation) {
+    const size_t len = HugePages::PAGE_LEN + 1;
+    bool enabled = HugePages::enabled();
+    for (bool enable : { false, true }) {
+        HugePages::setEnabled(enable);
+        unsigned char* p = static_cast<unsigned char*>(HugePages::allocate(len));
+        memset(p, 0xab, len);
+        EXPECT_EQ(0xab, p[len - 1]);
+        if (!enable) {
+            EXPECT_EQ(HugePages::NONE, HugePages::kind(p));
+        }
+        HugePages::deallocate(p, len);
+    }
+    HugePages::setEnabled(enabled);
+
+    std::vector<uint64_t, HugePageAllocator<uint64_t>> small(3, 7), large(HugePages::MIN_LEN, 7);
+    small.resize(HugePages::MIN_LEN);
+    EXPECT_EQ(7u, small[2]);
+    EXPECT_EQ(small.size(), large.size());
+    EXPECT_EQ(7u, large[HugePages::MIN_LEN - 1]);
+}
+
+TEST_F(AuthenticatorTest, InstrumentSnapshot) {
+    Authenticator acca(sk, w, 0);
+    Authenticator verifier(acca.getDpk(), w);
+    Authenticator::token_t t;
+    Instrument::reset();
+    acca.authenticate(t, ct, m1, 0);
+    EXPECT_TRUE(verifier.verify(t, ct, m1, 0));
+
+    Instrument::stats_t stats;
+    Instrument::snapshot(stats);
+    if (!Instrument::ENABLED) {
+        for (size_t i = 0; i < Instrument::PHASE_COUNT; i++) {
+            EXPECT_EQ(0u, stats.calls[i]);
+        }
+        return;
+    }
+    EXPECT_EQ(1u, stats.calls[Instrument::PHASE_AUTHENTICATE]);
+    EXPECT_EQ(1u, stats.calls[Instrument::PHASE_VERIFY]);
+    EXPECT_EQ(Authenticator::DEPTH, stats.calls[Instrument::PHASE_ECMULT]);
+    EXPECT_LE(Authenticator::DEPTH, stats.calls[Instrument::PHASE_ECMULT_GEN]);
+    EXPECT_LT(0u, stats.calls[Instrument::PHASE_HMAC]);
+    EXPECT_LT(stats.ticks[Instrument::PHASE_ECMULT], stats.ticks[Instrument::PHASE_VERIFY]);
+
+    // counts of exited threads are kept
+    std::thread([&]() { verifier.verify(t, ct, m1, 0); }).join();
+    Instrument::snapshot(stats);
+    EXPECT_EQ(2u, stats.calls[Instrument::PHASE_VERIFY]);
+    Instrument::reset();
+    Instrument::snapshot(stats);
+    EXPECT_EQ(0u, stats.calls[Instrument::PHASE_VERIFY]);
+}
+
+TEST_F(AuthenticatorTest, AuthenticatorAggregateProof) {
+    Authenticator acca(sk, w, 0);
+    ChameleonHash::hash_t hash;
+    Authenticator::altMessage t;
+    vector<ChameleonHash::pk_t> pks;
+    int n[3] = { 1, 2, 1 };
+    for (int i = 0; i < 3; i++) {
+        t.token.push_back(Authenticator::token_t());
+        t.ms.push_back(xs[i]);
+        ChameleonHash chsk(sk, w, n[i]);
+        pks.push_back(chsk.getPk(true));
+    }
+    acca.authenticates(t, 3, ct, n, hash);
+
+    AggregateProof proof;
+    Authenticator::aggregate(proof, t, 3, pks, hash);
+    EXPECT_EQ(2u, proof.pks.size());
+
+    vector<unsigned char> bytes;
+    proof.serialize(bytes);
+    EXPECT_LT(bytes.size(), sizeof(Authenticator::token_t));
+
+    Authenticator verifier(acca.getDpk(), w);
+    AggregateProof parsed = AggregateProof::parse(bytes);
+    EXPECT_TRUE(verifier.verifys(parsed));
+
+    parsed.digests[1][0] ^= 1;
+    EXPECT_FALSE(verifier.verifys(parsed));
+
+    bytes.pop_back();
+    EXPECT_THROW(AggregateProof::parse(bytes), std::invalid_argument);
+}
+
+TEST_F(AuthenticatorTest, AggregateProofBatchVerify) {
+    Authenticator acca(sk, w, 0);
+    AggregateProof proofs[4];
+    const AggregateProof* ptrs[4];
+    for (int k = 0; k < 4; k++) {
+        Authenticator::altMessage t;
+        vector<ChameleonHash::pk_t> pks;
+        int n[3] = { k, 1, k };
+        for (int i = 0; i < 3; i++) {
+            t.token.push_back(Authenticator::token_t());
+            t.ms.push_back(xs[3 * k + i]);
+            pks.push_back(ChameleonHash(sk, w, n[i]).getPk(true));
+        }
+        ChameleonHash::hash_t hash;
+        acca.authenticates(t, 3, ct, n, hash);
+        Authenticator::aggregate(proofs[k], t, 3, pks, hash);
+        ptrs[k] = &proofs[k];
+    }
+
+    bool results[4];
+    AggregateProof::verify(ptrs, 4, results);
+    for (int k = 0; k < 4; k++) {
+        EXPECT_TRUE(results[k]);
+    }
+    AggregateProof::verify(ptrs + 2, 1, results);
+    EXPECT_TRUE(results[0]);
+
+    proofs[1].rs[2][31] ^= 1;
+    proofs[3].hash[0] = 0x05;
+    AggregateProof::verify(ptrs, 4, results);
+    EXPECT_TRUE(results[0]);
+    EXPECT_FALSE(results[1]);
+    EXPECT_TRUE(results[2]);
+    EXPECT_FALSE(results[3]);
+    AggregateProof::verify(ptrs + 1, 1, results);
+    EXPECT_FALSE(results[0]);
+
+    // the batch check agrees with verifys on every proof
+    Authenticator verifier(acca.getDpk(), w);
+    EXPECT_TRUE(verifier.verifys(proofs[0]));
+    EXPECT_FALSE(verifier.verifys(proofs[1]));
+}
+
+TEST_F(AuthenticatorTest, AsyncAuthenticator) {
+    Authenticator acca(sk, w, 0);
+    const size_t cnt = 16;
+    vector<Authenticator::token_t> ts(cnt);
+    bool results[cnt];
+    std::atomic<size_t> verified(0);
+    std::atomic<size_t> authenticated(0);
+
+    AggregateProof proof;
+    {
+        Authenticator::altMessage t;
+        vector<ChameleonHash::pk_t> pks;
+        int n[2] = { 0, 0 };
+        for (int i = 0; i < 2; i++) {
+            t.token.push_back(Authenticator::token_t());
+            t.ms.push_back(xs[i]);
+            pks.push_back(ChameleonHash(sk, w, 0).getPk(true));
+        }
+        ChameleonHash::hash_t hash;
+        acca.authenticates(t, 2, ct, n, hash);
+        Authenticator::aggregate(proof, t, 2, pks, hash);
+    }
+    AggregateProof bad = proof;
+    bad.rs[1][0] ^= 1;
+    bool proofResults[2] = { false, true };
+
+    {
+        AsyncAuthenticator async(acca);
+        for (size_t i = 0; i < cnt; i++) {
+            async.authenticate(ts[i], cts[i], xs[i], 0, [&](bool result, std::exception_ptr error) {
+                EXPECT_TRUE(result);
+                EXPECT_FALSE(error);
+                authenticated++;
+            });
+        }
+        while (authenticated < cnt) {
+            std::this_thread::yield();
+        }
+
+        for (size_t i = 0; i < cnt; i += 3) {
+            ts[i].rs[i % Authenticator::DEPTH][0] ^= 1;
+        }
+        for (size_t i = 0; i < cnt; i++) {
+            async.verify(ts[i], cts[i], xs[i], 0, [&, i](bool result, std::exception_ptr error) {
+                EXPECT_FALSE(error);
+                results[i] = result;
+                verified++;
+            });
+        }
+        async.verifys(proof, [&](bool result, std::exception_ptr) { proofResults[0] = result; });
+        async.verifys(bad, [&](bool result, std::exception_ptr) { proofResults[1] = result; });
+    }
+
+    EXPECT_EQ(cnt, verified);
+    for (size_t i = 0; i < cnt; i++) {
+        EXPECT_EQ(i % 3 != 0, results[i]) << i;
+    }
+    EXPECT_TRUE(proofResults[0]);
+    EXPECT_FALSE(proofResults[1]);
+}
+
+TEST_F(AuthenticatorTest, AsyncAuthenticatorMalformedToken) {
+    Authenticator acca(sk, w, 0);
+    const size_t cnt = 16;
+    vector<Authenticator::token_t> ts(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+        acca.authenticate(ts[i], cts[i], xs[i], 0);
+    }
+    // randomness out of range makes the batch verification throw
+    const size_t bad = 5;
+    ts[bad].rs[0].fill(0xff);
+
+    bool results[cnt];
+    bool errors[cnt];
+    std::atomic<size_t> verified(0);
+    {
+        AsyncAuthenticator async(acca);
+        for (size_t i = 0; i < cnt; i++) {
+            async.verify(ts[i], cts[i], xs[i], 0, [&, i](bool result, std::exception_ptr error) {
+                results[i] = result;
+                errors[i] = (bool) error;
+                verified++;
+            });
+        }
+    }
+    EXPECT_EQ(cnt, verified);
+    for (size_t i = 0; i < cnt; i++) {
+        EXPECT_EQ(i == bad, errors[i]) << i;
+        EXPECT_EQ(i != bad, results[i]) << i;
+    }
+}
+
+TEST_F(AuthenticatorTest, AsyncAuthenticatorOrder) {
+    Authenticator acca(sk, w, 0);
+    const size_t cnt = 16;
+    vector<Authenticator::token_t> ts(cnt);
+    bool results[cnt];
+    std::atomic<size_t> verified(0);
+    {
+        AsyncAuthenticator async(acca);
+        // Each verify is submitted right after the authenticate that produces its token.
+        for (size_t i = 0; i < cnt; i++) {
+            async.authenticate(ts[i], cts[i], xs[i], 0, [](bool, std::exception_ptr error) { EXPECT_FALSE(error); });
+            async.verify(ts[i], cts[i], xs[i], 0, [&, i](bool result, std::exception_ptr error) {
+                EXPECT_FALSE(error);
+                results[i] = result;
+                verified++;
+            });
+        }
+    }
+    EXPECT_EQ(cnt, verified);
+    for (size_t i = 0; i < cnt; i++) {
+        EXPECT_TRUE(results[i]) << i;
+    }
+}
+
+#ifdef ACCA_HAVE_COROUTINES
+// A coroutine that starts right away and is never awaited.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() {
+            return DetachedTask();
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return std::suspend_never();
+        }
+        std::suspend_never final_suspend() noexcept {
+            return std::suspend_never();
+        }
+        void return_void() {
+        }
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+DetachedTask authenticateAndVerify(AsyncAuthenticator& async, const Authenticator::ct_t& ct, const Authenticator::st_t& st,
+                                   std::atomic<int>& valid, std::atomic<int>& invalid)
+{
+    Authenticator::token_t t;
+    co_await async.asyncAuthenticate(t, ct, st, 0);
+    if (co_await async.asyncVerify(t, ct, st, 0)) {
+        valid++;
+    }
+    Authenticator::st_t other = st;
+    other.push_back(0);
+    if (!co_await async.asyncVerify(t, ct, other, 0)) {
+        invalid++;
+    }
+}
+
+TEST_F(AuthenticatorTest, AsyncAuthenticatorCoroutines) {
+    Authenticator acca(sk, w, 0);
+    std::atomic<int> valid(0), invalid(0);
+    {
+        AsyncAuthenticator async(acca);
+        for (size_t i = 0; i < 8; i++) {
+            authenticateAndVerify(async, cts[i], xs[i], valid, invalid);
+        }
+    }
+    EXPECT_EQ(8, valid);
+    EXPECT_EQ(8, invalid);
+}
+#endif
+
+TEST_F(AuthenticatorTest, VerifyPipeline) {
+    Authenticator acca(sk, w, 0);
+    const size_t cnt = 3 * Authenticator::BATCH_CHUNK + 5;
+    TokenBatch batch;
+    for (size_t i = 0; i < cnt; i++) {
+        batch.add(xs[i], 0);
+    }
+    ChameleonHash::hash_t h;
+    acca.authenticates(batch, ct, h);
+    for (size_t i = 0; i < cnt; i += 7) {
+        batch.rs(i)[(i % Authenticator::DEPTH) * batch.stride()][0] ^= 1;
+    }
+    vector<Authenticator::ct_t> cts(cnt, ct);
+    std::unique_ptr<bool[]> results(new bool[cnt]);
+
+    // the default layout, and two walkers that share a CPU with the other stages
+    std::unique_ptr<VerifyPipeline> pipelines[2];
+    pipelines[0].reset(new VerifyPipeline(acca.getDpk(), w));
+    pipelines[1].reset(new VerifyPipeline(acca.getDpk(), w, vector<int>(4, 0)));
+    EXPECT_EQ(4u, pipelines[1]->cpus().size());
+    for (auto& pipeline : pipelines) {
+        for (int round = 0; round < 2; round++) {
+            std::fill(results.get(), results.get() + cnt, round == 0);
+            pipeline->verifyBatch(batch, cts.data(), results.get());
+            for (size_t i = 0; i < cnt; i++) {
+                EXPECT_EQ(i % 7 != 0, results[i]) << i;
+            }
+        }
+    }
+    EXPECT_THROW(VerifyPipeline(acca.getDpk(), w, vector<int>(2, 0)), std::invalid_argument);
+}
+
+TEST_F(AuthenticatorTest, Numa) {
+    int nodes = Numa::nodes();
+    ASSERT_GE(nodes, 1);
+    int node = Numa::currentNode();
+    EXPECT_GE(node, 0);
+    EXPECT_LT(node, nodes);
+    for (int cpu : Numa::cpus(node)) {
+        EXPECT_EQ(node, Numa::nodeOfCpu(cpu));
+    }
+
+    for (int n = -1; n < nodes; n++) {
+        vector<uint64_t, NodeAllocator<uint64_t>> v(100000, 7, NodeAllocator<uint64_t>(n));
+        v[99999] = 8;
+        vector<uint64_t, NodeAllocator<uint64_t>> w;
+        w = std::move(v);
+        EXPECT_EQ(n, w.get_allocator().node);
+        EXPECT_EQ(7u, w[0]);
+        EXPECT_EQ(8u, w[99999]);
+    }
+
+    // A bound thread stays on the CPUs of its node.
+    std::thread t([node] {
+        if (Numa::bindThread(node)) {
+            EXPECT_EQ(node, Numa::currentNode());
+            vector<int> cpus = Numa::cpus(node);
+            EXPECT_TRUE(std::find(cpus.begin(), cpus.end(), sched_getcpu()) != cpus.end());
+            // unbound, the thread may move to any node
+            Numa::unbindThread();
+        }
+    });
+    t.join();
+    EXPECT_FALSE(Numa::bindThread(nodes));
+}
+
+TEST_F(AuthenticatorTest, MultiExp) {
+    auto serialize = [](secp256k1_gej_t& gej) {
+        secp256k1_ge_t ge;
+        secp256k1_ge_set_gej(&ge, &gej);
+        ChameleonHash::hash_t h;
+        int len;
+        EXPECT_TRUE(secp256k1_eckey_pubkey_serialize(&ge, h.data(), &len, 1));
+        return h;
+    };
+    auto randomScalar = [](secp256k1_scalar_t& sc) {
+        unsigned char b[32];
+        for (auto& c : b) {
+            c = gen();
+        }
+        secp256k1_scalar_set_b32(&sc, b, nullptr);
+    };
+
+    const size_t maxCnt = 100;
+    vector<secp256k1_ge_t> points(maxCnt);
+    vector<secp256k1_scalar_t> coefs(maxCnt);
+    for (size_t i = 0; i < maxCnt; i++) {
+        secp256k1_scalar_t k, zero;
+        secp256k1_gej_t pj, inf;
+        randomScalar(k);
+        secp256k1_scalar_clear(&zero);
+        secp256k1_gej_set_infinity(&inf);
+        secp256k1_ecmult(&pj, &inf, &zero, &k);
+        secp256k1_ge_set_gej(&points[i], &pj);
+        randomScalar(coefs[i]);
+    }
+    // the same point twice, which the items of one public key would give
+    points[1] = points[0];
+
+    secp256k1_scalar_t g;
+    randomScalar(g);
+    for (size_t cnt : { 0, 1, 2, 5, 40, 100 }) {
+        secp256k1_gej_t res;
+        ChameleonHash::multiExp(res, g, points.data(), coefs.data(), cnt, Plan::MULTIEXP_SIMPLE);
+        ChameleonHash::hash_t expected = serialize(res);
+        for (Plan::MultiExp a : { Plan::MULTIEXP_STRAUSS, Plan::MULTIEXP_PIPPENGER }) {
+            ChameleonHash::multiExp(res, g, points.data(), coefs.data(), cnt, a);
+            EXPECT_EQ(expected, serialize(res)) << cnt << " points, algorithm " << a;
+        }
+        ChameleonHash::multiExp(res, g, points.data(), coefs.data(), cnt);
+        EXPECT_EQ(expected, serialize(res)) << cnt << " points, planned";
+    }
+}
+
+TEST_F(AuthenticatorTest, PlanSaveLoad) {
+    Plan plan;
+    EXPECT_EQ(Plan::thisCpu(), plan.cpu);
+    plan.verifyChunk = 16;
+    plan.straussThreshold = 3;
+    plan.pippengerThreshold = 200;
+    plan.lanes = false;
+    plan.threads = 5;
+    EXPECT_EQ(Plan::MULTIEXP_SIMPLE, plan.multiExp(2));
+    EXPECT_EQ(Plan::MULTIEXP_STRAUSS, plan.multiExp(3));
+    EXPECT_EQ(Plan::MULTIEXP_STRAUSS, plan.multiExp(199));
+    EXPECT_EQ(Plan::MULTIEXP_PIPPENGER, plan.multiExp(200));
+
+    char path[] = "/tmp/acca-plan-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    plan.save(path);
+    Plan loaded = Plan::load(path);
+    EXPECT_EQ(plan.cpu, loaded.cpu);
+    EXPECT_EQ(16u, loaded.verifyChunk);
+    EXPECT_EQ(3u, loaded.straussThreshold);
+    EXPECT_EQ(200u, loaded.pippengerThreshold);
+    EXPECT_FALSE(loaded.lanes);
+    EXPECT_EQ(5u, loaded.threads);
+
+    for (const char* bad : { "verify_chunk = 8\n", "# acca plan\nthreads = many\n", "# acca plan\nverify_chunk\n",
+                             "# acca plan\nverify_chunk = 0\n" }) {
+        FILE* f = fopen(path, "w");
+        ASSERT_TRUE(f != nullptr);
+        fputs(bad, f);
+        fclose(f);
+        EXPECT_THROW(Plan::load(path), std::invalid_argument) << bad;
+    }
+    unlink(path);
+    EXPECT_THROW(Plan::load(path), std::runtime_error);
+}
+
+TEST_F(AuthenticatorTest, PlanInUse) {
+    const Plan previous = Plan::current();
+    Authenticator acca(sk, w, 0);
+    Authenticator verifier(acca.getDpk(), w);
+    const size_t cnt = 2 * Authenticator::BATCH_CHUNK + 5;
+    TokenBatch batch;
+    for (size_t i = 0; i < cnt; i++) {
+        batch.add(xs[i], 0);
+    }
+    ChameleonHash::hash_t h;
+    acca.authenticates(batch, ct, h);
+    for (size_t i = 0; i < cnt; i += 7) {
+        batch.rs(i)[(i % Authenticator::DEPTH) * batch.stride()][0] ^= 1;
+    }
+    vector<Authenticator::ct_t> cts(cnt, ct);
+    std::unique_ptr<bool[]> results(new bool[cnt]);
+
+    const ChameleonHash::pk_t pk1 = ChameleonHash(sk, w, 1).getPk(true);
+    Authenticator::altMessage alt;
+    alt.token.resize(10);
+    alt.ms.assign(xs.begin(), xs.begin() + 10);
+    vector<int> ns(10, 1);
+    ChameleonHash::hash_t aggregateHash;
+    acca.authenticates(alt, 10, ct, ns.data(), aggregateHash);
+    AggregateProof proof;
+    Authenticator::aggregate(proof, alt, 10, vector<ChameleonHash::pk_t>(10, pk1), aggregateHash);
+
+    for (size_t chunk : { 5, 8, 1000 }) {
+        Plan plan = previous;
+        plan.verifyChunk = chunk;
+        // every algorithm for the multi-exponentiation of the aggregate proof
+        plan.straussThreshold = chunk == 5 ? 1 : 100;
+        plan.pippengerThreshold = chunk == 8 ? 1 : 100;
+        Plan::setCurrent(plan);
+        verifier.verifyBatch(batch, cts.data(), results.get());
+        for (size_t i = 0; i < cnt; i++) {
+            EXPECT_EQ(i % 7 != 0, results[i]) << i << ", chunks of " << chunk;
+        }
+        EXPECT_TRUE(verifier.verifys(proof)) << "chunks of " << chunk;
+    }
+    Plan::setCurrent(previous);
+}
+
+TEST_F(AuthenticatorTest, AuthenticatorVerifyManyN) {
 	Authenticator acca(sk, w, 0);
 	Authenticator::token_t t;
-	clock_t start, end;
-	int total = 0;
 	for (int i = 1; i <= 100; i++) {
 		acca.authenticate(t, ct, m1, i);
-		start = clock();
 		EXPECT_TRUE(acca.verify(t, ct, m1, i));
-		end = clock();
-		total += (int)((float)(end - start) * 1000 / CLOCKS_PER_SEC);
 	}
-	printf("totile time=%d ms\n", total);
 }
 
-TEST_F(AuthenticatorTest, TestMultipleDateTime) {
+TEST_F(AuthenticatorTest, AuthenticatorVerifysManyN) {
 	Authenticator acca(sk, w, 0);
 	ChameleonHash::hash_t hash;
 	Authenticator::altMessage t;
@@ -259,10 +1222,195 @@ TEST_F(AuthenticatorTest, TestMultipleDateTime) {
 		pks.push_back(ch.getPk(true));
 	}
 	acca.authenticates(t, 100, ct, n, hash);
-	clock_t start, end;
-	start = clock();
-	acca.verifys(t, 100, ct, n, pks, w, hash);
-	end = clock();
-	printf("totile time=%d ms\n", (int)((float)(end - start) * 1000 / CLOCKS_PER_SEC));
 	EXPECT_TRUE(acca.verifys(t, 100, ct, n, pks, w, hash));
 }
+
+// Build-time limits on heap allocations on the steady-state paths, see CMakeLists.txt.
+#ifndef ACCA_ALLOC_MAX_OP
+#define ACCA_ALLOC_MAX_OP 0
+#endif
+#ifndef ACCA_ALLOC_MAX_BATCH
+#define ACCA_ALLOC_MAX_BATCH 1
+#endif
+#ifndef ACCA_ALLOC_MAX_ITEM
+#define ACCA_ALLOC_MAX_ITEM 0
+#endif
+
+// Allocations of the second of two calls of f, after lazily built tables and buffers exist.
+template <typename F>
+static AllocStats::stats_t steadyAllocs(F f)
+{
+    f();
+    AllocStats::Scope scope;
+    f();
+    return scope.get();
+}
+
+TEST_F(AuthenticatorTest, AllocStatsCounts) {
+    static void* volatile p;
+    AllocStats::Scope scope;
+    p = malloc(10);
+    free(p);
+    p = new char[20];
+    delete[] static_cast<char*>(p);
+    EXPECT_EQ(2u, scope.get().count);
+    EXPECT_EQ(30u, scope.get().bytes);
+}
+
+TEST_F(AuthenticatorTest, AllocationsPerOperation) {
+    Authenticator acca(sk, w, 0);
+    Authenticator verifier(acca.getDpk(), w);
+    Authenticator::token_t t;
+    TokenBatch batch;
+    batch.add(m1, 0);
+    ChameleonHash::hash_t hash;
+    acca.authenticates(batch, ct, hash);
+
+    AllocStats::stats_t stats = steadyAllocs([&]() { acca.authenticate(t, ct, m1, 0); });
+    EXPECT_LE(stats.count, ACCA_ALLOC_MAX_OP) << "authenticate, " << stats.bytes << " bytes";
+    stats = steadyAllocs([&]() { EXPECT_TRUE(verifier.verify(t, ct, m1, 0)); });
+    EXPECT_LE(stats.count, ACCA_ALLOC_MAX_OP) << "verify, " << stats.bytes << " bytes";
+    stats = steadyAllocs([&]() { EXPECT_TRUE(verifier.verify(batch, 0, ct)); });
+    EXPECT_LE(stats.count, ACCA_ALLOC_MAX_OP) << "verify in a TokenBatch, " << stats.bytes << " bytes";
+    // two statements under one context, so that ch.extract runs
+    Authenticator::token_t t2;
+    acca.authenticate(t2, ct, m2, 0);
+    Authenticator extractor(acca.getDpk(), w);
+    stats = steadyAllocs([&]() { extractor.extract(t, t2, ct, m1, m2, 0, 0); });
+    EXPECT_LE(stats.count, ACCA_ALLOC_MAX_OP) << "extract, " << stats.bytes << " bytes";
+    EXPECT_EQ(sk, extractor.getDsk());
+}
+
+TEST_F(AuthenticatorTest, AllocationsPerBatchItem) {
+    Authenticator acca(sk, w, 0);
+    Authenticator verifier(acca.getDpk(), w);
+    ChameleonHash chpk(acca.getDpk().chpk, w);
+    const ChameleonHash::pk_t pk1 = ChameleonHash(sk, w, 1).getPk(true);
+
+    for (size_t cnt : { 3, 20 }) {
+        const uint64_t limit = ACCA_ALLOC_MAX_BATCH + cnt * ACCA_ALLOC_MAX_ITEM;
+        vector<Authenticator::token_t> t(cnt);
+        vector<Authenticator::st_t> ms(xs.begin(), xs.begin() + cnt);
+        vector<int> n(cnt, 1);
+        vector<ChameleonHash::pk_t> pks(cnt, pk1);
+        ChameleonHash::hash_t hash;
+        AllocStats::stats_t stats;
+
+        stats = steadyAllocs([&]() { acca.authenticates(t.data(), ms.data(), n.data(), cnt, ct, hash); });
+        EXPECT_LE(stats.count, limit) << "authenticates of " << cnt << ", " << stats.bytes << " bytes";
+        stats = steadyAllocs([&]() { EXPECT_TRUE(verifier.verifys(t.data(), ms.data(), pks.data(), cnt, hash)); });
+        EXPECT_LE(stats.count, limit) << "verifys of " << cnt << ", " << stats.bytes << " bytes";
+
+        Authenticator::altMessage alt;
+        alt.token = t;
+        alt.ms = ms;
+        stats = steadyAllocs([&]() { acca.authenticates(alt, cnt, ct, n.data(), hash); });
+        EXPECT_LE(stats.count, limit) << "authenticates of " << cnt << " (altMessage), " << stats.bytes << " bytes";
+        stats = steadyAllocs([&]() { EXPECT_TRUE(verifier.verifys(alt, cnt, ct, n.data(), pks, w, hash)); });
+        EXPECT_LE(stats.count, limit) << "verifys of " << cnt << " (altMessage), " << stats.bytes << " bytes";
+
+        AggregateProof proof;
+        Authenticator::aggregate(proof, alt, cnt, pks, hash);
+        stats = steadyAllocs([&]() { EXPECT_TRUE(verifier.verifys(proof)); });
+        EXPECT_LE(stats.count, limit) << "verifys of " << cnt << " (AggregateProof), " << stats.bytes << " bytes";
+
+        TokenBatch batch;
+        for (size_t i = 0; i < cnt; i++) {
+            batch.add(ms[i], 0);
+        }
+        vector<Authenticator::ct_t> cts(cnt, ct);
+        bool results[20];
+        acca.authenticates(batch, ct, hash);
+        stats = steadyAllocs([&]() { verifier.verifyBatch(batch, cts.data(), results); });
+        EXPECT_LE(stats.count, limit) << "verifyBatch of " << cnt << ", " << stats.bytes << " bytes";
+
+        vector<ChameleonHash::digest_t> ds(cnt);
+        vector<ChameleonHash::rand_t> rs(cnt, r1);
+        vector<const ChameleonHash::rand_t*> r(cnt, &r1);
+        vector<ChameleonHash::hash_t> chs(cnt);
+        for (size_t i = 0; i < cnt; i++) {
+            ChameleonHash::digest(ds[i], ms[i]);
+        }
+        stats = steadyAllocs([&]() { ChameleonHash::mergeV(hash, ds.data(), rs.data(), pks.data(), cnt); });
+        EXPECT_LE(stats.count, limit) << "mergeV of " << cnt << ", " << stats.bytes << " bytes";
+        stats = steadyAllocs([&]() { chpk.ch(chs.data(), ds.data(), r.data(), n.data(), cnt); });
+        EXPECT_LE(stats.count, limit) << "ch of " << cnt << ", " << stats.bytes << " bytes";
+    }
+}
+
+TEST_F(AuthenticatorTest, Coalescer) {
+    typedef Coalescer::Clock Clock;
+    Coalescer c(std::chrono::microseconds(200), 4);
+    std::vector<Coalescer::group_t> out;
+    Clock::time_point t = Clock::now();
+
+    // Sparse requests are released right away.
+    c.add("a", 1, t);
+    t += std::chrono::milliseconds(1);
+    c.add("a", 2, t);
+    EXPECT_EQ(0, c.window().count());
+    EXPECT_TRUE(c.deadline() <= t);
+    c.release(out, t);
+    ASSERT_EQ(1u, out.size());
+    EXPECT_EQ(2u, out[0].items.size());
+    EXPECT_EQ(Clock::time_point::max(), c.deadline());
+
+    // Dense requests open the window, up to three gaps for batches of four, once the average
+    // gap has caught up.
+    for (uint64_t i = 0; i < 32; i++) {
+        t += std::chrono::microseconds(10);
+        c.add("w", i, t);
+    }
+    c.release(out, t, true);
+    out.clear();
+    for (uint64_t i = 0; i < 64; i++) {
+        t += std::chrono::microseconds(10);
+        c.add("a", i, t);
+        c.release(out, t);
+    }
+    EXPECT_GT(c.window(), std::chrono::microseconds(25));
+    EXPECT_LE(c.window(), std::chrono::microseconds(35));
+    // Full batches are released without waiting for the window.
+    ASSERT_EQ(16u, out.size());
+    for (const auto& g : out) {
+        EXPECT_EQ("a", g.key);
+        EXPECT_EQ(4u, g.items.size());
+    }
+
+    // A partial batch waits for the window, but not longer.
+    out.clear();
+    t += std::chrono::microseconds(10);
+    c.add("a", 100, t);
+    c.release(out, t);
+    EXPECT_TRUE(out.empty());
+    EXPECT_EQ(t + c.window(), c.deadline());
+    c.release(out, c.deadline());
+    ASSERT_EQ(1u, out.size());
+    EXPECT_EQ(std::vector<uint64_t>(1, 100), out[0].items);
+
+    // What remains after a full batch waits for the window of its own oldest item.
+    out.clear();
+    for (uint64_t i = 0; i < 5; i++) {
+        t += std::chrono::microseconds(10);
+        c.add("a", i, t);
+    }
+    c.release(out, t);
+    ASSERT_EQ(1u, out.size());
+    EXPECT_EQ(4u, out[0].items.size());
+    EXPECT_EQ(t + c.window(), c.deadline());
+    c.release(out, c.deadline());
+    ASSERT_EQ(2u, out.size());
+    EXPECT_EQ(std::vector<uint64_t>(1, 4), out[1].items);
+
+    // The window never exceeds the maximum.
+    Coalescer d(std::chrono::microseconds(200), 1000);
+    for (uint64_t i = 0; i < 16; i++) {
+        t += std::chrono::microseconds(10);
+        d.add("a", i, t);
+    }
+    EXPECT_EQ(std::chrono::microseconds(200), d.window());
+    out.clear();
+    d.release(out, t, true);
+    ASSERT_EQ(1u, out.size());
+    EXPECT_EQ(16u, out[0].items.size());
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "tokenbatch.h"
+#include "node.h"
+
+#include <algorithm>
+#include <string.h>
+
+template <size_t CT_LEN>
+BasicTokenBatch<CT_LEN>::BasicTokenBatch(size_t items, size_t statementBytes) : size_(0), capacity(0)
+{
+    stOffsets.push_back(0);
+    reserve(items, statementBytes);
+}
+
+template <size_t CT_LEN>
+void BasicTokenBatch<CT_LEN>::reserve(size_t items, size_t statementBytes)
+{
+    slab.reserve(statementBytes);
+    stOffsets.reserve(items + 1);
+    ns.reserve(items);
+    if (items <= capacity) {
+        return;
+    }
+
+    // Growing changes the stride, so the existing levels have to be moved apart.
+    std::vector<ChameleonHash::rand_t, HugePageAllocator<ChameleonHash::rand_t>> rsNew(items * DEPTH);
+    std::vector<ChameleonHash::hash_t, HugePageAllocator<ChameleonHash::hash_t>> chsNew(items * DEPTH);
+    for (size_t l = 0; l < DEPTH; l++) {
+        std::copy(rs_.begin() + l * capacity, rs_.begin() + l * capacity + size_, rsNew.begin() + l * items);
+        std::copy(chs_.begin() + l * capacity, chs_.begin() + l * capacity + size_, chsNew.begin() + l * items);
+    }
+    rs_.swap(rsNew);
+    chs_.swap(chsNew);
+    capacity = items;
+}
+
+template <size_t CT_LEN>
+void BasicTokenBatch<CT_LEN>::reset()
+{
+    size_ = 0;
+    ns.clear();
+    slab.clear();
+    stOffsets.resize(1);
+}
+
+template <size_t CT_LEN>
+size_t BasicTokenBatch<CT_LEN>::add(const unsigned char* st, size_t len, int n)
+{
+    if (size_ == capacity) {
+        reserve(std::max<size_t>(2 * capacity, 16), 0);
+    }
+
+    // bump allocation in the statement slab
+    size_t offset = slab.size();
+    slab.resize(offset + len);
+    if (len) {
+        memcpy(slab.data() + offset, st, len);
+    }
+    stOffsets.push_back(offset + len);
+    ns.push_back(n);
+    return size_++;
+}
+
+template <size_t CT_LEN>
+size_t BasicTokenBatch<CT_LEN>::add(const std::vector<unsigned char>& st, int n)
+{
+    return add(st.data(), st.size(), n);
+}
+
+#define ACCA_INSTANTIATE_TOKENBATCH(CT_LEN) template class BasicTokenBatch<CT_LEN>;
+ACCA_FOR_EACH_CT_LEN(ACCA_INSTANTIATE_TOKENBATCH)
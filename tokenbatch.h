@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef TOKENBATCH_H
+#define TOKENBATCH_H
+
+#include "chameleonhash.h"
+#include "hugepages.h"
+
+#include <array>
+#include <vector>
+
+// A batch of tokens and statements in structure-of-arrays layout.
+//
+// The randomness and the sibling hashes of all tokens are stored level-major, i.e., the values
+// of all items on one level are contiguous, which is what aggregate verification (level 0 only)
+// and level-synchronous kernels read. Statements are bump-allocated from a single slab.
+// reset() drops the items but keeps all storage, so a batch that is reused for batches of
+// similar size does not allocate in steady state. The per-level arrays of large batches are
+// backed by huge pages.
+template <size_t CT_LEN>
+class BasicTokenBatch
+{
+public:
+    static constexpr size_t DEPTH = CT_LEN * 8;
+
+    BasicTokenBatch(size_t items = 0, size_t statementBytes = 0);
+
+    void reserve(size_t items, size_t statementBytes);
+    void reset();
+
+    // Appends an item with an empty token and a copy of the statement, and returns its index.
+    size_t add(const unsigned char* st, size_t len, int n);
+    size_t add(const std::vector<unsigned char>& st, int n);
+
+    size_t size() const {
+        return size_;
+    }
+
+    // Distance between the values of the same item on consecutive levels.
+    size_t stride() const {
+        return capacity;
+    }
+
+    // Values of item i on level 0; the value on level l is at index l * stride().
+    ChameleonHash::rand_t* rs(size_t i) {
+        return &rs_[i];
+    }
+    const ChameleonHash::rand_t* rs(size_t i) const {
+        return &rs_[i];
+    }
+    ChameleonHash::hash_t* chs(size_t i) {
+        return &chs_[i];
+    }
+    const ChameleonHash::hash_t* chs(size_t i) const {
+        return &chs_[i];
+    }
+
+    const unsigned char* statement(size_t i) const {
+        return slab.data() + stOffsets[i];
+    }
+    size_t statementLen(size_t i) const {
+        return stOffsets[i + 1] - stOffsets[i];
+    }
+    int n(size_t i) const {
+        return ns[i];
+    }
+
+private:
+    size_t size_;
+    size_t capacity;
+    std::vector<ChameleonHash::rand_t, HugePageAllocator<ChameleonHash::rand_t>> rs_;
+    std::vector<ChameleonHash::hash_t, HugePageAllocator<ChameleonHash::hash_t>> chs_;
+    std::vector<int> ns;
+
+    // Statement i occupies slab[stOffsets[i], stOffsets[i + 1]).
+    std::vector<unsigned char> slab;
+    std::vector<size_t> stOffsets;
+};
+
+template <size_t CT_LEN> constexpr size_t BasicTokenBatch<CT_LEN>::DEPTH;
+
+typedef BasicTokenBatch<ACCA_CT_LEN> TokenBatch;
+
+#endif // TOKENBATCH_H
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "verifypipeline.h"
+#include "node.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+// Waits for another stage: spins first, then yields, and then sleeps.
+class Backoff
+{
+public:
+    explicit Backoff(unsigned sleepUs) : sleepUs(sleepUs), spins(0) {
+    }
+    void reset() {
+        spins = 0;
+    }
+    void wait() {
+        if (spins < 64) {
+            spins++;
+        } else if (spins < 128) {
+            spins++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(sleepUs));
+        }
+    }
+
+private:
+    unsigned sleepUs;
+    unsigned spins;
+};
+
+std::vector<int> defaultCpus()
+{
+    std::vector<int> allowed;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof set, &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                allowed.push_back(cpu);
+            }
+        }
+    }
+    if (allowed.empty()) {
+        return std::vector<int>(3, -1);
+    }
+    std::vector<int> cpus(2, allowed[0]);
+    if (allowed.size() == 1) {
+        cpus.push_back(allowed[0]);
+    } else {
+        size_t walkers = std::min<size_t>(allowed.size() - 1, std::max(1u, Plan::current().threads));
+        cpus.insert(cpus.end(), allowed.begin() + 1, allowed.begin() + 1 + walkers);
+    }
+    return cpus;
+}
+
+}
+
+template <size_t CT_LEN>
+BasicVerifyPipeline<CT_LEN>::BasicVerifyPipeline(const typename Authenticator_::dpk_t& dpk, const typename Authenticator_::dw_t& dw,
+                                                 const std::vector<int>& cpus)
+    : dpk(dpk), dw(dw), root(dpk, dw), stopping(false), started(0)
+{
+    std::vector<int> c = cpus.empty() ? defaultCpus() : cpus;
+    if (c.size() < 3) {
+        throw std::invalid_argument("the pipeline needs at least three CPUs, one per stage");
+    }
+    size_t walkers = c.size() - 2;
+    // two chunks per walker, one in progress and one waiting, and one for each other stage
+    size_t cnt = 2 * walkers + 2;
+    slots.resize(cnt);
+    for (size_t s = 0; s < cnt; s++) {
+        free.push_back(s);
+    }
+    in.reset(new ring_t(cnt));
+    out.reset(new ring_t(cnt));
+    for (size_t w = 0; w < walkers; w++) {
+        toWalker.emplace_back(new ring_t(cnt));
+        fromWalker.emplace_back(new ring_t(cnt));
+    }
+
+    pinned.reset(new std::atomic<int>[c.size()]);
+    try {
+        threads.emplace_back([this, c] { pin(0, c[0]); digestStage(); });
+        threads.emplace_back([this, c] { pin(1, c[1]); rootStage(); });
+        for (size_t w = 0; w < walkers; w++) {
+            threads.emplace_back([this, c, w] { pin(2 + w, c[2 + w]); walkStage(w); });
+        }
+    } catch (...) {
+        stopping = true;
+        for (auto& t : threads) {
+            t.join();
+        }
+        throw;
+    }
+    while (started < threads.size()) {
+        std::this_thread::yield();
+    }
+}
+
+template <size_t CT_LEN>
+BasicVerifyPipeline<CT_LEN>::~BasicVerifyPipeline()
+{
+    stopping = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+template <size_t CT_LEN>
+void BasicVerifyPipeline<CT_LEN>::pin(size_t i, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &set);
+    }
+    bool ok = cpu >= 0 && cpu < CPU_SETSIZE && pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+    pinned[i] = ok ? cpu : -1;
+    started++;
+}
+
+template <size_t CT_LEN>
+std::vector<int> BasicVerifyPipeline<CT_LEN>::cpus() const
+{
+    std::vector<int> c;
+    for (size_t i = 0; i < threads.size(); i++) {
+        c.push_back(pinned[i]);
+    }
+    return c;
+}
+
+template <size_t CT_LEN>
+void BasicVerifyPipeline<CT_LEN>::verifyBatch(const BasicTokenBatch<CT_LEN>& batch, const typename Authenticator_::ct_t* ct, bool* results)
+{
+    std::lock_guard<std::mutex> l(callLock);
+    size_t inFlight = 0;
+    std::exception_ptr error;
+    Backoff backoff(BACKOFF_US);
+    // Takes back a slot that went through the pipeline, if there is one.
+    auto collect = [&]() {
+        uint32_t s;
+        if (!out->tryPop(s)) {
+            backoff.wait();
+            return;
+        }
+        backoff.reset();
+        if (slots[s].error && !error) {
+            error = slots[s].error;
+        }
+        slots[s].error = nullptr;
+        free.push_back(s);
+        inFlight--;
+    };
+
+    const size_t chunkLen = std::min(Authenticator_::BATCH_CHUNK, std::max<size_t>(1, Plan::current().verifyChunk));
+    for (size_t first = 0; first < batch.size(); first += chunkLen) {
+        while (free.empty()) {
+            collect();
+        }
+        uint32_t s = free.back();
+        free.pop_back();
+        slot_t& slot = slots[s];
+        slot.chunk.first = first;
+        slot.chunk.cnt = std::min(chunkLen, batch.size() - first);
+        slot.batch = &batch;
+        slot.ct = ct;
+        slot.results = results;
+        // cannot fail, as every ring holds all slots
+        in->tryPush(s);
+        inFlight++;
+    }
+    while (inFlight > 0) {
+        collect();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template <size_t CT_LEN>
+void BasicVerifyPipeline<CT_LEN>::digestStage()
+{
+    Backoff backoff(BACKOFF_US);
+    size_t next = 0;
+    uint32_t s;
+    while (!stopping) {
+        if (!in->tryPop(s)) {
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+        slot_t& slot = slots[s];
+        try {
+            Authenticator_::verifyChunkStatements(slot.chunk, *slot.batch, slot.ct);
+        } catch (...) {
+            slot.error = std::current_exception();
+        }
+        toWalker[next]->tryPush(s);
+        next = (next + 1) % toWalker.size();
+    }
+}
+
+template <size_t CT_LEN>
+void BasicVerifyPipeline<CT_LEN>::walkStage(size_t w)
+{
+    // built on this thread, so that its memory is local to the core
+    Authenticator_ verifier(dpk, dw);
+    Backoff backoff(BACKOFF_US);
+    uint32_t s;
+    while (!stopping) {
+        if (!toWalker[w]->tryPop(s)) {
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+        slot_t& slot = slots[s];
+        if (!slot.error) {
+            try {
+                verifier.verifyChunkLevels(slot.chunk, *slot.batch);
+            } catch (...) {
+                slot.error = std::current_exception();
+            }
+        }
+        fromWalker[w]->tryPush(s);
+    }
+}
+
+template <size_t CT_LEN>
+void BasicVerifyPipeline<CT_LEN>::rootStage()
+{
+    Backoff backoff(BACKOFF_US);
+    uint32_t s;
+    while (!stopping) {
+        bool any = false;
+        for (auto& ring : fromWalker) {
+            if (!ring->tryPop(s)) {
+                continue;
+            }
+            any = true;
+            slot_t& slot = slots[s];
+            if (!slot.error) {
+                root.verifyChunkRoot(slot.chunk, slot.results);
+            }
+            out->tryPush(s);
+        }
+        if (any) {
+            backoff.reset();
+        } else {
+            backoff.wait();
+        }
+    }
+}
+
+#define ACCA_INSTANTIATE_VERIFYPIPELINE(CT_LEN) template class BasicVerifyPipeline<CT_LEN>;
+ACCA_FOR_EACH_CT_LEN(ACCA_INSTANTIATE_VERIFYPIPELINE)
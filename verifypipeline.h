@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2015 Tim Ruffing <tim.ruffing@mmci.uni-saarland.de>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef VERIFYPIPELINE_H
+#define VERIFYPIPELINE_H
+
+#include "authenticator.h"
+#include "spscring.h"
+#include "tokenbatch.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Verifies batches in a pipeline of threads pinned to cores. The batch is cut into chunks of
+// Plan::current().verifyChunk items, which move through three stages:
+//   1. digest the statements and read the paths from the contexts (verifyChunkStatements),
+//   2. walk the chunk up the tree (verifyChunkLevels), on one of several walker threads,
+//   3. compare with the root digest (verifyChunkRoot),
+// handed on by single-producer single-consumer rings. Each walker has its own verifier, which
+// it builds on its core, so that its tables are allocated on the local NUMA node.
+// Idle stages spin briefly and then sleep for up to BACKOFF_US microseconds.
+template <size_t CT_LEN>
+class BasicVerifyPipeline
+{
+public:
+    typedef BasicAuthenticator<CT_LEN> Authenticator_;
+    static const unsigned BACKOFF_US = 50;
+
+    // Runs stage 1 on cpus[0], stage 3 on cpus[1], and a walker on each of the other CPUs; a
+    // CPU may be named more than once, and -1 does not pin. The default puts stages 1 and 3
+    // on the first CPU the process may run on, and a walker on each of the others, up to
+    // Plan::current().threads walkers (or on the first CPU, if there is no other).
+    BasicVerifyPipeline(const typename Authenticator_::dpk_t& dpk, const typename Authenticator_::dw_t& dw,
+                        const std::vector<int>& cpus = std::vector<int>());
+    ~BasicVerifyPipeline();
+
+    // Like verifyBatch of a verifier for dpk and dw. Calls from several threads are serialized.
+    void verifyBatch(const BasicTokenBatch<CT_LEN>& batch, const typename Authenticator_::ct_t* ct, bool* results);
+
+    // The CPUs the threads run on, stage 1, stage 3 and then the walkers, with -1 for threads
+    // that could not be pinned.
+    std::vector<int> cpus() const;
+
+private:
+    typedef typename Authenticator_::chunk_t chunk_t;
+    typedef SpscRing<uint32_t> ring_t;
+
+    struct slot_t {
+        chunk_t chunk;
+        const BasicTokenBatch<CT_LEN>* batch;
+        const typename Authenticator_::ct_t* ct;
+        bool* results;
+        std::exception_ptr error;
+    };
+
+    typename Authenticator_::dpk_t dpk;
+    typename Authenticator_::dw_t dw;
+    // used by stage 3 only, which does not change it
+    Authenticator_ root;
+    std::vector<slot_t> slots;
+    // Slot indices go from the caller to stage 1 (in), to a walker (toWalker), to stage 3
+    // (fromWalker), and back to the caller (out).
+    std::unique_ptr<ring_t> in;
+    std::vector<std::unique_ptr<ring_t>> toWalker;
+    std::vector<std::unique_ptr<ring_t>> fromWalker;
+    std::unique_ptr<ring_t> out;
+    // slots that are not in the pipeline, owned by the caller
+    std::vector<uint32_t> free;
+    std::mutex callLock;
+    std::atomic<bool> stopping;
+    std::vector<std::thread> threads;
+    // CPU of each thread, once it has started
+    std::unique_ptr<std::atomic<int>[]> pinned;
+    std::atomic<size_t> started;
+
+    void digestStage();
+    void walkStage(size_t w);
+    void rootStage();
+    // Pins the calling thread, which is thread i, to cpu.
+    void pin(size_t i, int cpu);
+
+    BasicVerifyPipeline(const BasicVerifyPipeline&);
+    BasicVerifyPipeline& operator=(const BasicVerifyPipeline&);
+};
+
+typedef BasicVerifyPipeline<ACCA_CT_LEN> VerifyPipeline;
+
+#endif // VERIFYPIPELINE_H